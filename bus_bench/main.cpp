@@ -0,0 +1,187 @@
+/**
+ * @file	main.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ *
+ * Host benchmark of the interconnects. Traffic generators send 2-phase
+ * transactions back to back through a SimpleBusAT or a CrossbarAT to sinks
+ * that answer after one bus cycle, and the host time is measured.
+ *
+ * Two versions of the interconnects are compared by building the benchmark
+ * against each of them, e.g. against a checkout of an older revision:
+ *
+ *     make clean_all && make PATH_COMMON=/path/to/old/npu_common
+ *
+ * usage: bus_bench.x [number of masters] [transactions per master] [crossbar]
+ */
+
+#include <tlm.h>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <tlm_utils/peq_with_get.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+#define REPORT_DEFINE_GLOBALS		// no memory.cpp here, which defines them otherwise
+#include "reporting.h"
+#include "globaldefs.h"
+#include "SimpleBusAT.h"
+#include "CrossbarAT.h"
+
+using namespace std;
+using namespace sc_core;
+using namespace tlm;
+
+/// wall clock time in seconds
+static double now() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/// sends transactions back to back, one at a time
+SC_MODULE(Generator) {
+	tlm_utils::simple_initiator_socket<Generator> socket;
+
+	SC_HAS_PROCESS(Generator);
+	Generator(sc_module_name name, unsigned int n_transactions, unsigned int n_slaves) :
+		sc_module(name), socket("socket"), m_n_transactions(n_transactions),
+				m_n_slaves(n_slaves) {
+		socket.register_nb_transport_bw(this, &Generator::nb_transport_bw);
+		SC_THREAD(thread);
+	}
+
+	static unsigned long completed;
+
+private:
+	void thread() {
+		unsigned char data[64];
+		memset(data, 0, sizeof(data));
+		for (unsigned int i = 0; i < m_n_transactions; i++) {
+			m_payload.set_command(i % 2 ? TLM_READ_COMMAND : TLM_WRITE_COMMAND);
+			m_payload.set_address((sc_dt::uint64) (i % m_n_slaves) << address_port_shift);
+			m_payload.set_data_ptr(data);
+			m_payload.set_data_length(sizeof(data));
+			m_payload.set_response_status(TLM_INCOMPLETE_RESPONSE);
+			tlm_phase phase = BEGIN_REQ;
+			sc_time delay = SC_ZERO_TIME;
+			socket->nb_transport_fw(m_payload, phase, delay);
+			wait(delay);
+			wait(m_done);
+			completed++;
+		}
+	}
+
+	tlm_sync_enum nb_transport_bw(tlm_generic_payload& /* payload */, tlm_phase& /* phase */,
+			sc_time& delay) {
+		m_done.notify(delay);
+		return TLM_COMPLETED;
+	}
+
+	const unsigned int m_n_transactions;
+	const unsigned int m_n_slaves;
+	tlm_generic_payload m_payload;
+	sc_event m_done;
+};
+
+unsigned long Generator::completed = 0;
+
+/// answers every transaction after one bus cycle
+SC_MODULE(Sink) {
+	tlm_utils::simple_target_socket<Sink> socket;
+
+	SC_HAS_PROCESS(Sink);
+	Sink(sc_module_name name) :
+		sc_module(name), socket("socket"), m_peq("peq") {
+		socket.register_nb_transport_fw(this, &Sink::nb_transport_fw);
+		SC_THREAD(thread);
+	}
+
+private:
+	tlm_sync_enum nb_transport_fw(tlm_generic_payload& payload, tlm_phase& phase,
+			sc_time& delay) {
+		m_peq.notify(payload, delay + CLK_CYCLE_BUS);
+		phase = END_REQ;
+		return TLM_UPDATED;
+	}
+
+	void thread() {
+		while (true) {
+			wait(m_peq.get_event());
+			tlm_generic_payload* payload;
+			while ((payload = m_peq.get_next_transaction()) != 0) {
+				payload->set_response_status(TLM_OK_RESPONSE);
+				tlm_phase phase = BEGIN_RESP;
+				sc_time delay = SC_ZERO_TIME;
+				socket->nb_transport_bw(*payload, phase, delay);
+			}
+		}
+	}
+
+	tlm_utils::peq_with_get<tlm_generic_payload> m_peq;
+};
+
+int sc_main(int argc, char *argv[]) {
+	unsigned int n_masters = argc > 1 ? atoi(argv[1]) : 8;
+	unsigned int n_transactions = argc > 2 ? atoi(argv[2]) : 100000;
+	bool use_crossbar = argc > 3 && strcmp(argv[3], "crossbar") == 0;
+	const unsigned int n_slaves = 4;
+
+	init_address_map(n_slaves);
+	SimpleBusAT* bus = 0;
+	CrossbarAT* crossbar = 0;
+	std::vector<tlm_target_socket<> *> master_socket;
+	std::vector<tlm_initiator_socket<> *> slave_socket;
+	if (use_crossbar) {
+		crossbar = new CrossbarAT("crossbar", n_masters, n_slaves, bus_width);
+		for (unsigned int i = 0; i < n_masters; i++)
+			master_socket.push_back(&crossbar->target_socket[i]);
+		for (unsigned int i = 0; i < n_slaves; i++)
+			slave_socket.push_back(&crossbar->initiator_socket[i]);
+	} else {
+		bus = new SimpleBusAT("bus", n_masters, n_slaves, bus_width);
+		for (unsigned int i = 0; i < n_masters; i++)
+			master_socket.push_back(&bus->target_socket[i]);
+		for (unsigned int i = 0; i < n_slaves; i++)
+			slave_socket.push_back(&bus->initiator_socket[i]);
+	}
+
+	std::vector<Generator*> generators;
+	for (unsigned int i = 0; i < n_masters; i++) {
+		std::ostringstream name;
+		name << "generator" << i;
+		generators.push_back(new Generator(name.str().c_str(), n_transactions, n_slaves));
+		generators[i]->socket(*master_socket[i]);
+	}
+	std::vector<Sink*> sinks;
+	for (unsigned int i = 0; i < n_slaves; i++) {
+		std::ostringstream name;
+		name << "sink" << i;
+		sinks.push_back(new Sink(name.str().c_str()));
+		(*slave_socket[i])(sinks[i]->socket);
+	}
+
+	double start = now();
+	sc_start();
+	double elapsed = now() - start;
+
+	cout << (use_crossbar ? "crossbar" : "bus") << ", " << n_masters << " masters: "
+			<< Generator::completed << " transactions in " << fixed << setprecision(3) << elapsed
+			<< " s, " << setprecision(1) << Generator::completed / elapsed / 1e3
+			<< " k transactions/s host time, " << sc_time_stamp() << " simulated" << endl;
+
+	for (unsigned int i = 0; i < n_masters; i++) {
+		delete generators[i];
+	}
+	for (unsigned int i = 0; i < n_slaves; i++) {
+		delete sinks[i];
+	}
+	delete bus;
+	delete crossbar;
+	return 0;
+}
@@ -34,6 +34,8 @@ public:
 
 	/// Interrupt line that is used by the DMA when it
 	/// finishes the transfer of a received packet into the RAM.
+	/// It is the line of the receive queue rx_queue_of_cpu(m_id), read the
+	/// descriptors at rx_queue_address() of that queue.
 	sc_in<bool> packetReceived_interrupt;
 
 
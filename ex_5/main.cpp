@@ -35,7 +35,7 @@ int sc_main(int argc, char *argv[]) {
 	SimpleBusAT bus("bus", nMasters, nSlaves, 8/*bus width in bytes*/);
 
 	// system memory (RAM)
-	RAM target("memory_target", n_memory_slots * IpPacket::PACKET_MAX_SIZE, 4);
+	RAM target("memory_target", ram_size(), 4);
 
 	// Ethernet MAC + DMA
 	IoModule mac_io_module("io_module");
@@ -51,21 +51,20 @@ int sc_main(int argc, char *argv[]) {
 	/**********************************************************************/
 
 	// interrupt lines
-	sc_signal<bool> dma_irq;
+	sc_signal<bool> dma_irq[n_rx_queues]; // one per receive queue
 
 	// --------------- BUS MASTERS -------------------
 	// DMA engine to bus
-	mac_io_module.dma_ch_0.initiator_socket(bus.target_socket[0]);
-	mac_io_module.dma_ch_1.initiator_socket(bus.target_socket[1]);
-	mac_io_module.dma_ch_2.initiator_socket(bus.target_socket[2]);
-	mac_io_module.dma_ch_3.initiator_socket(bus.target_socket[3]);
+	for (unsigned int i = 0; i < nMacs; i++) {
+		mac_io_module.dma_ch[i]->initiator_socket(bus.target_socket[i]);
+	}
 
 	// processors to bus and interrupt
 	for (unsigned int i = 0; i < n_cpus; i++) {
 		// connect master socket to the bus
 		cpus[i]->initiator_socket(bus.target_socket[i + nMacs]);
 		// connect IRQ lines
-		cpus[i]->packetReceived_interrupt(dma_irq);
+		cpus[i]->packetReceived_interrupt(dma_irq[rx_queue_of_cpu(i)]);
 	}
 
 	// --------------- BUS SLAVES --------------------
@@ -73,13 +72,14 @@ int sc_main(int argc, char *argv[]) {
 	bus.initiator_socket[0](target.m_memory_socket);
 	// DMA to bus
 	bus.initiator_socket[1](mac_io_module.memory_manager.target_socket);
-	bus.initiator_socket[2](mac_io_module.dma_ch_0.target_socket);
-	bus.initiator_socket[3](mac_io_module.dma_ch_1.target_socket);
-	bus.initiator_socket[4](mac_io_module.dma_ch_2.target_socket);
-	bus.initiator_socket[5](mac_io_module.dma_ch_3.target_socket);
+	for (unsigned int i = 0; i < nMacs; i++) {
+		bus.initiator_socket[2 + i](mac_io_module.dma_ch[i]->target_socket);
+	}
 
 	// DMA to interrupt line
-	mac_io_module.dma_irq(dma_irq);
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		mac_io_module.dma_irq[i](dma_irq[i]);
+	}
 
 	initialize_statistics();
 	/**********************************************************************/
@@ -12,10 +12,12 @@
 #include <tlm.h>
 #include <string>
 #include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
 
 #include "globaldefs.h"
 #include "IpPacket.h"
 #include "packet_descriptor.h"
+#include "DmiCache.h"
 #include "RoutingTable.h"
 
 using namespace tlm;
@@ -34,6 +36,8 @@ public:
 
 	/// Interrupt line that is used by the DMA when it
 	/// finishes the transfer of a received packet into the RAM.
+	/// It is the line of the receive queue rx_queue_of_cpu(m_id), read the
+	/// descriptors at rx_queue_address() of that queue.
 	sc_in<bool> packetReceived_interrupt;
 
 
@@ -57,17 +61,29 @@ private:
 	/// event to signal when the return path returns the read data
 	sc_event transactionFinished_event;
 
+	/// DMI regions of the RAM. With use_dmi, startTransaction() first tries
+	/// m_dmi.transport(initiator_socket, payload, delay), and only sends the
+	/// transaction on the bus if it returns false.
+	DmiCache m_dmi;
+
+	/// Local time of the processor in loosely_timed mode. startTransaction() then calls
+	/// initiator_socket->b_transport(payload, delay) with delay = m_qk.get_local_time(),
+	/// sets the local time to the returned delay, and calls m_qk.sync() if
+	/// m_qk.need_sync() or before waiting for an interrupt.
+	tlm_utils::tlm_quantumkeeper m_qk;
+
 
 	/////////////////////////////////////////
         // additional declarations for exercise 6
 	/////////////////////////////////////////
 
-	/// header of the IP packet that the processor works on (wrapper)
+	/// header of the IP packet that the processor works on (wrapper).
+	/// Read the header_size() bytes at m_packet_descriptor.header_address() into it.
 	IpPacket m_packet_header;
 
-	/// Routing table instance.
+	/// Routing table, shared by all Cpu instances.
 	/// Not used if the system contains accelerator(s)
-	RoutingTable m_rt;
+	RoutingTableRef m_rt;
 
 
 	/////////////////////////////////////////
@@ -101,6 +117,11 @@ private:
 			tlm_phase& phase, // transaction phase
 			sc_time& time); // elapsed time
 
+	/// a DMI region was revoked by the target
+	void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+		m_dmi.invalidate(start_range, end_range);
+	}
+
 	/**
 	 * Main thread, this does all the processing.
 	 */
@@ -114,6 +135,10 @@ private:
 	 * @param data    - pointer to the data that is written or pointer to a
 	 *                  buffer where the data is going to be stored
 	 * @param dataSize - size of the data in bytes
+	 *
+	 * With use_dmi the RAM is accessed through m_dmi, then the function only
+	 * waits the annotated delay. In loosely_timed mode the transaction is blocking,
+	 * see m_qk.
 	 */
 	void startTransaction(tlm_command command, soc_address_t address,
 		unsigned char *data, unsigned int dataSize);
@@ -191,10 +216,13 @@ public:
 	SC_CTOR(Cpu):
 		initiator_socket("initiator_socket"), 
 		m_id(Cpu::instances++), 
-		m_rt(lutConfigFile, '|')
+		m_rt(RoutingTableRef::shared(lutConfigFile, '|'))
 	{
 		SC_THREAD(processor_thread);
 		initiator_socket.register_nb_transport_bw(this, &Cpu::nb_transport_bw);
+		initiator_socket.register_invalidate_direct_mem_ptr(this,
+				&Cpu::invalidate_direct_mem_ptr);
+		m_qk.reset();
 	}
 
 private:
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# Runs the simulation in AT and in LT mode with the same options, and reports
+# how far the packet rate and the latencies of the LT run drift from the AT
+# run, and the speedup of the host time.
+#
+# usage: ./lt_drift.sh [-x simulator] [options of processing_acc.x, e.g. -n 4 -p 100000 --quantum 500]
+#
+# The simulator is ./processing_acc.x by default, -x ../solution/processing_acc.x runs
+# the reference processor.
+#
+# @date		Oct 17, 2026
+# @author	Miklos Kirilly
+
+EXE=./processing_acc.x
+if [ "$1" = "-x" ]; then
+	EXE=$2
+	shift 2
+fi
+
+# the statistics of a run in one line: packet rate [kpps], min, max, avg latency [ns], host time [s]
+summary() {
+	awk '
+		# sc_time is printed with its own unit
+		function ns(value, unit) {
+			if (unit == "s") return value * 1e9
+			if (unit == "ms") return value * 1e6
+			if (unit == "us") return value * 1e3
+			if (unit == "ps") return value * 1e-3
+			if (unit == "fs") return value * 1e-6
+			return value
+		}
+		/^packet rate =/ { rate = $4 }
+		/^[ \t]*min:/ { min = ns($2, $3) }
+		/^[ \t]*max:/ { max = ns($2, $3) }
+		/^[ \t]*avg:/ { avg = ns($2, $3) }
+		/^host time:/ { host = $3 }
+		END { print rate, min, max, avg, host }
+	'
+}
+
+OUT=`mktemp` || exit 1
+trap 'rm -f "$OUT"' EXIT
+
+# a failed run has no statistics to compare
+"$EXE" "$@" > "$OUT" || { echo "$EXE $* failed" >&2; exit 1; }
+AT=`summary < "$OUT"`
+"$EXE" --lt "$@" > "$OUT" || { echo "$EXE --lt $* failed" >&2; exit 1; }
+LT=`summary < "$OUT"`
+
+echo "$AT $LT" | awk '
+	function drift(at, lt) {
+		return at == 0 ? 0 : (lt - at) / at * 100
+	}
+	{
+		printf("%-16s %14s %14s %10s\n", "", "AT", "LT", "drift")
+		printf("%-16s %14.2f %14.2f %+9.2f%%\n", "rate [kpps]", $1, $6, drift($1, $6))
+		printf("%-16s %14.1f %14.1f %+9.2f%%\n", "min latency [ns]", $2, $7, drift($2, $7))
+		printf("%-16s %14.1f %14.1f %+9.2f%%\n", "max latency [ns]", $3, $8, drift($3, $8))
+		printf("%-16s %14.1f %14.1f %+9.2f%%\n", "avg latency [ns]", $4, $9, drift($4, $9))
+		printf("%-16s %14.2f %14.2f %9.1fx\n", "host time [s]", $5, $10, $10 > 0 ? $5 / $10 : 0)
+	}'
@@ -0,0 +1,159 @@
+/**
+ * @file	main.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ *
+ * Writes a PCAP file of IMIX traffic for the simulators: the simple IMIX of
+ * 7 : 4 : 1 IP packets of 40, 576 and 1500 bytes, in random order, back to back
+ * at the given line rate. The packets are UDP datagrams with valid IPv4 headers,
+ * TTL 64, random source addresses and ports, so that they spread over the
+ * receive queues, and destination addresses of the routes of config/lut_entries.
+ *
+ * usage: imix_gen.x [-n packets] [-r Mbit/s] [-s seed] output.pcap
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace std;
+
+/// IP packet sizes of the simple IMIX, each 1/12 of the packets
+static const unsigned int imix_sizes[12] = { 40, 40, 40, 40, 40, 40, 40, 576, 576, 576, 576,
+		1500 };
+
+/// destinations of the routes of config/lut_entries, one of them is the default route
+static const uint32_t destinations[] = { 0x7f000001, 0xc0a80001, 0xc0a80003, 0xc0a8000b,
+		0xc0a80064, 0x8b850a0a, 0x08080808 };
+
+static const unsigned int ETHERNET_HEADER_LENGTH = 14;
+/// shortest Ethernet frame without the frame check sequence
+static const unsigned int MIN_FRAME_LENGTH = 60;
+/// preamble, start of frame, frame check sequence and interframe gap on the wire
+static const unsigned int WIRE_OVERHEAD = 8 + 4 + 12;
+
+static void put16(unsigned char* p, unsigned int value) {
+	p[0] = value >> 8;
+	p[1] = value;
+}
+
+static void put32(unsigned char* p, uint32_t value) {
+	put16(p, value >> 16);
+	put16(p + 2, value);
+}
+
+/// Internet checksum of the IPv4 header
+static unsigned int checksum(const unsigned char* header, unsigned int length) {
+	uint32_t sum = 0;
+	for (unsigned int i = 0; i < length; i += 2) {
+		sum += (header[i] << 8) | header[i + 1];
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return ~sum & 0xffff;
+}
+
+/// writes a value in host byte order, the readers accept both
+template<typename T>
+static void write(ofstream& out, T value) {
+	out.write(reinterpret_cast<const char*> (&value), sizeof(T));
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int n_packets = 10000;
+	double rate = 1000;
+	unsigned int seed = 1;
+	int option;
+	while ((option = getopt(argc, argv, "n:r:s:")) != -1) {
+		switch (option) {
+		case 'n':
+			n_packets = atoi(optarg);
+			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			cerr << "usage: " << argv[0] << " [-n packets] [-r Mbit/s] [-s seed] output.pcap"
+					<< endl;
+			return 1;
+		}
+	}
+	if (optind != argc - 1 || rate <= 0) {
+		cerr << "usage: " << argv[0] << " [-n packets] [-r Mbit/s] [-s seed] output.pcap"
+				<< endl;
+		return 1;
+	}
+	ofstream out(argv[optind], ios::binary);
+	if (!out) {
+		cerr << "unable to write " << argv[optind] << endl;
+		return 1;
+	}
+	srand(seed);
+
+	// global header: microsecond resolution, Ethernet
+	write(out, (uint32_t) 0xa1b2c3d4);
+	write(out, (uint16_t) 2);
+	write(out, (uint16_t) 4);
+	write(out, (int32_t) 0);
+	write(out, (uint32_t) 0);
+	write(out, (uint32_t) 65535);
+	write(out, (uint32_t) 1);
+
+	unsigned char frame[ETHERNET_HEADER_LENGTH + 1500];
+	double time_us = 0;
+	unsigned long long n_bytes = 0;
+	for (unsigned int i = 0; i < n_packets; i++) {
+		unsigned int ip_length = imix_sizes[rand() % 12];
+		unsigned int length = ETHERNET_HEADER_LENGTH + ip_length;
+		if (length < MIN_FRAME_LENGTH) {
+			length = MIN_FRAME_LENGTH;
+		}
+		memset(frame, 0, length);
+
+		// Ethernet: locally administered addresses, IPv4
+		frame[0] = 0x02;
+		frame[6] = 0x02;
+		frame[11] = 1;
+		put16(frame + 12, 0x0800);
+
+		// IPv4 header
+		unsigned char* ip = frame + ETHERNET_HEADER_LENGTH;
+		ip[0] = 0x45;
+		put16(ip + 2, ip_length);
+		put16(ip + 4, i);
+		ip[8] = 64;
+		ip[9] = 17;
+		put32(ip + 12, 0x0a000000 | (rand() & 0xffffff));
+		put32(ip + 16, destinations[rand() % (sizeof(destinations) / sizeof(destinations[0]))]);
+		put16(ip + 10, checksum(ip, 20));
+
+		// UDP header, without checksum
+		put16(ip + 20, 1024 + rand() % 60000);
+		put16(ip + 22, 1024 + rand() % 60000);
+		put16(ip + 24, ip_length - 20);
+
+		write(out, (uint32_t) (time_us / 1e6));
+		write(out, (uint32_t) ((unsigned long long) time_us % 1000000));
+		write(out, (uint32_t) length);
+		write(out, (uint32_t) length);
+		out.write(reinterpret_cast<const char*> (frame), length);
+
+		time_us += (length + WIRE_OVERHEAD) * 8 / rate;
+		n_bytes += ip_length;
+	}
+	if (!out) {
+		cerr << "unable to write " << argv[optind] << endl;
+		return 1;
+	}
+	cout << n_packets << " packets, " << (double) n_bytes / n_packets
+			<< " bytes on average, " << time_us / 1e6 << " s at " << rate << " Mbit/s" << endl;
+	return 0;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file	main.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ *
+ * Host benchmark of the RoutingTable lookup structures, no SystemC needed.
+ * It loads random prefixes from a text and from a binary file, loads them
+ * one by one, withdraws and announces routes, and looks up random
+ * addresses, then prints the throughput of each.
+ *
+ * First it checks that the structures agree: the same routes and updates go
+ * into each, and they must return the same next hops, one by one and in a
+ * batch, before and after the updates. It exits with 1 if they do not.
+ *
+ * usage: lut_bench.x [number of prefixes] [number of updates]
+ *        lut_bench.x -c <text LUT file> <binary LUT file>
+ *
+ * The second form converts a configuration file to the binary format.
+ */
+
+#include "RoutingTable.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+using namespace std;
+
+/// wall clock time in seconds
+static double now() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/// random 32-bit number
+static unsigned int random32() {
+	return ((unsigned int) rand() << 16) ^ (unsigned int) rand();
+}
+
+/// random prefix with a length mix similar to Internet tables: half of them
+/// /24, most of the rest /16 to /23, a few shorter or longer ones
+static void randomPrefix(unsigned int& netAddress, unsigned int& subnetMask) {
+	unsigned int r = rand() % 100;
+	unsigned int length = r < 50 ? 24 : r < 95 ? 16 + rand() % 8
+			: r < 98 ? 8 + rand() % 8 : 25 + rand() % 8;
+	subnetMask = 0xFFFFFFFFu << (32 - length);
+	netAddress = random32() & subnetMask;
+}
+
+/// times loading a configuration file of random prefixes, as text and as binary
+static void benchLoad(unsigned int nPrefixes) {
+	const char* textFile = "/tmp/lut_bench_routes.txt";
+	const char* binaryFile = "/tmp/lut_bench_routes.bin";
+	srand(1);
+	{
+		ofstream oFile(textFile);
+		for (unsigned int i = 0; i < nPrefixes; i++) {
+			unsigned int netAddress, subnetMask;
+			randomPrefix(netAddress, subnetMask);
+			oFile << (netAddress >> 24) << '.' << ((netAddress >> 16) & 0xFF) << '.'
+					<< ((netAddress >> 8) & 0xFF) << '.' << (netAddress & 0xFF) << " | "
+					<< (subnetMask >> 24) << '.' << ((subnetMask >> 16) & 0xFF) << '.'
+					<< ((subnetMask >> 8) & 0xFF) << '.' << (subnetMask & 0xFF) << " | "
+					<< rand() % 4 << '\n';
+		}
+	}
+
+	cout << "loading " << nPrefixes << " routes" << endl << fixed << setprecision(1);
+	double start = now();
+	RoutingTable text(textFile, '|', RoutingTable::LINEAR_SCAN);
+	cout << "\ttext, parsing only:   " << (now() - start) * 1e3 << " ms" << endl;
+	text.save(binaryFile);
+	start = now();
+	RoutingTable binary(binaryFile, '|', RoutingTable::LINEAR_SCAN);
+	cout << "\tbinary, loading only: " << (now() - start) * 1e3 << " ms" << endl;
+	start = now();
+	RoutingTable textTrie(textFile);
+	cout << "\ttext, Poptrie:        " << (now() - start) * 1e3 << " ms" << endl;
+	start = now();
+	RoutingTable binaryTrie(binaryFile);
+	cout << "\tbinary, Poptrie:      " << (now() - start) * 1e3 << " ms" << endl;
+
+	remove(textFile);
+	remove(binaryFile);
+}
+
+/**
+ * Looks up the addresses in each table, one by one and with getNextHops(), and
+ * compares the next hops with the scalar lookups of the first table.
+ * @param when - the state of the tables, for the report of a mismatch
+ * @return false on the first mismatch
+ */
+static bool compareLookups(const vector<RoutingTable*>& tables, const char* names[],
+		const vector<unsigned int>& addresses, const char* when) {
+	vector<unsigned int> expected(addresses.size());
+	vector<unsigned int> nextHops(addresses.size());
+	for (unsigned int i = 0; i < addresses.size(); i++) {
+		expected[i] = tables[0]->getNextHop(addresses[i]);
+	}
+	for (unsigned int t = 0; t < tables.size(); t++) {
+		tables[t]->getNextHops(&addresses[0], &nextHops[0], addresses.size());
+		for (unsigned int i = 0; i < addresses.size(); i++) {
+			unsigned int nextHop = tables[t]->getNextHop(addresses[i]);
+			if (nextHop != expected[i] || nextHops[i] != expected[i]) {
+				cerr << "mismatch " << when << ": " << names[t] << " looks up "
+						<< ((addresses[i] >> 24) & 0xFF) << '.' << ((addresses[i] >> 16) & 0xFF)
+						<< '.' << ((addresses[i] >> 8) & 0xFF) << '.' << (addresses[i] & 0xFF)
+						<< " as " << nextHop << ", batch " << nextHops[i] << ", "
+						<< names[0] << " as " << expected[i] << endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/// the first and last address of each route and the ones around them, and random ones
+static void testAddresses(const vector<pair<unsigned int, unsigned int> >& routes,
+		vector<unsigned int>& addresses) {
+	addresses.clear();
+	for (unsigned int i = 0; i < routes.size(); i++) {
+		unsigned int first = routes[i].first;
+		unsigned int last = routes[i].first | ~routes[i].second;
+		addresses.push_back(first - 1);
+		addresses.push_back(first);
+		addresses.push_back(last);
+		addresses.push_back(last + 1);
+	}
+	for (unsigned int i = 0; i < 100000; i++) {
+		addresses.push_back(random32());
+	}
+}
+
+/**
+ * Differential check of the lookup structures: loads the same random routes into
+ * each, and compares their lookups before and after the same withdrawals and
+ * announcements.
+ * @return false if a lookup differs
+ */
+static bool verify(unsigned int nPrefixes, unsigned int nUpdates) {
+	const char* names[] = { "linear scan", "Poptrie", "DIR-24-8" };
+	const RoutingTable::Algorithm algorithms[] = { RoutingTable::LINEAR_SCAN,
+			RoutingTable::POPTRIE, RoutingTable::DIR_24_8 };
+	vector<RoutingTable*> tables;
+	for (unsigned int t = 0; t < 3; t++) {
+		tables.push_back(new RoutingTable("/dev/null", '|', algorithms[t]));
+	}
+	vector<pair<unsigned int, unsigned int> > routes;
+	vector<unsigned int> addresses;
+	unsigned int memoryWrites;
+	srand(2);
+
+	for (unsigned int i = 0; i < nPrefixes; i++) {
+		unsigned int netAddress, subnetMask;
+		randomPrefix(netAddress, subnetMask);
+		unsigned int nextHop = rand() % 4;
+		for (unsigned int t = 0; t < tables.size(); t++) {
+			tables[t]->addRoute(netAddress, subnetMask, nextHop, memoryWrites);
+		}
+		routes.push_back(make_pair(netAddress, subnetMask));
+	}
+	testAddresses(routes, addresses);
+	bool ok = compareLookups(tables, names, addresses, "after loading");
+
+	for (unsigned int i = 0; ok && i < nUpdates; i++) {
+		if (i % 2 == 0) {
+			unsigned int k = random32() % routes.size();
+			for (unsigned int t = 0; t < tables.size(); t++) {
+				tables[t]->removeRoute(routes[k].first, routes[k].second, memoryWrites);
+			}
+			routes[k] = routes.back();
+			routes.pop_back();
+		} else {
+			unsigned int netAddress, subnetMask;
+			randomPrefix(netAddress, subnetMask);
+			unsigned int nextHop = rand() % 4;
+			for (unsigned int t = 0; t < tables.size(); t++) {
+				tables[t]->addRoute(netAddress, subnetMask, nextHop, memoryWrites);
+			}
+			routes.push_back(make_pair(netAddress, subnetMask));
+		}
+	}
+	if (ok) {
+		// the withdrawn routes are among the test addresses too
+		vector<unsigned int> loaded(addresses);
+		testAddresses(routes, addresses);
+		addresses.insert(addresses.end(), loaded.begin(), loaded.end());
+		ok = compareLookups(tables, names, addresses, "after the updates");
+	}
+
+	for (unsigned int t = 0; t < tables.size(); t++) {
+		delete tables[t];
+	}
+	if (ok) {
+		cout << "lookups agree, " << nPrefixes << " routes, " << nUpdates << " updates, "
+				<< addresses.size() << " addresses" << endl;
+	}
+	return ok;
+}
+
+/// runs the benchmark on one lookup structure
+static void bench(RoutingTable::Algorithm algorithm, const char* name,
+		unsigned int nPrefixes, unsigned int nUpdates) {
+	// an empty file, the routes are added one by one
+	RoutingTable rt("/dev/null", '|', algorithm);
+	vector<pair<unsigned int, unsigned int> > routes;
+	unsigned long long writes = 0;
+	unsigned int memoryWrites;
+	srand(1);
+
+	double start = now();
+	for (unsigned int i = 0; i < nPrefixes; i++) {
+		unsigned int netAddress, subnetMask;
+		randomPrefix(netAddress, subnetMask);
+		rt.addRoute(netAddress, subnetMask, rand() % 4, memoryWrites);
+		routes.push_back(make_pair(netAddress, subnetMask));
+	}
+	double loadTime = now() - start;
+
+	// churn: withdraw a random route, announce a new one
+	start = now();
+	for (unsigned int i = 0; i < nUpdates; i++) {
+		if (i % 2 == 0) {
+			unsigned int k = random32() % routes.size();
+			rt.removeRoute(routes[k].first, routes[k].second, memoryWrites);
+			routes[k] = routes.back();
+			routes.pop_back();
+		} else {
+			unsigned int netAddress, subnetMask;
+			randomPrefix(netAddress, subnetMask);
+			rt.addRoute(netAddress, subnetMask, rand() % 4, memoryWrites);
+			routes.push_back(make_pair(netAddress, subnetMask));
+		}
+		writes += memoryWrites;
+	}
+	double updateTime = now() - start;
+
+	const unsigned int nLookups = 1000000;
+	vector<unsigned int> addresses(nLookups);
+	vector<unsigned int> nextHops(nLookups);
+	for (unsigned int i = 0; i < nLookups; i++) {
+		addresses[i] = random32();
+	}
+	unsigned int checksum = 0;
+	start = now();
+	for (unsigned int i = 0; i < nLookups; i++) {
+		checksum += rt.getNextHop(addresses[i]);
+	}
+	double lookupTime = now() - start;
+	start = now();
+	rt.getNextHops(&addresses[0], &nextHops[0], nLookups);
+	double batchTime = now() - start;
+
+	cout << name << ": " << rt.size() << " routes, " << rt.memoryUsage() / 1024
+			<< " kB" << endl << fixed << setprecision(2)
+			<< "\tload:    " << nPrefixes / loadTime / 1e6 << " M routes/s" << endl
+			<< "\tupdates: " << nUpdates / updateTime / 1e6 << " M updates/s, "
+			<< (double) writes / nUpdates << " writes/update" << endl
+			<< "\tlookups: " << nLookups / lookupTime / 1e6 << " M lookups/s, batch "
+			<< nLookups / batchTime / 1e6 << " M lookups/s (checksum "
+			<< checksum % 10 << ")" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+		RoutingTable rt(argv[2], '|', RoutingTable::LINEAR_SCAN);
+		if (!rt.save(argv[3])) {
+			cerr << "cannot write " << argv[3] << endl;
+			return 1;
+		}
+		cout << rt.size() << " routes written to " << argv[3] << endl;
+		return 0;
+	}
+
+	unsigned int nPrefixes = argc > 1 ? atoi(argv[1]) : 100000;
+	unsigned int nUpdates = argc > 2 ? atoi(argv[2]) : 100000;
+
+	// every linear lookup scans the whole table, keep it small
+	if (!verify(min(nPrefixes, 5000u), min(nUpdates, 5000u))) {
+		return 1;
+	}
+
+	benchLoad(nPrefixes);
+
+	// every linear lookup scans the whole table, keep it small
+	bench(RoutingTable::LINEAR_SCAN, "linear scan", min(nPrefixes, 5000u),
+			min(nUpdates, 5000u));
+	bench(RoutingTable::POPTRIE, "Poptrie", nPrefixes, nUpdates);
+	bench(RoutingTable::DIR_24_8, "DIR-24-8", nPrefixes, nUpdates);
+	return 0;
+}
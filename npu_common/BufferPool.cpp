@@ -0,0 +1,109 @@
+/**
+ * @file	BufferPool.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "BufferPool.h"
+#include "Checkpoint.h"
+#include <cassert>
+
+BufferPool::BufferPool() :
+	m_classes(packet_buffer_classes()), m_free(m_classes.size()), m_n_free(0),
+			m_max_used(0), m_allocations(m_classes.size(), 0),
+			m_larger(m_classes.size(), 0), m_failures(0) {
+}
+
+void BufferPool::fill() {
+	for (unsigned int i = 0; i < n_packet_buffers(); i++) {
+		release(packet_buffer_address(i));
+	}
+}
+
+bool BufferPool::can_allocate(unsigned int size) const {
+	for (unsigned int i = 0; i < m_classes.size(); i++) {
+		if (m_classes[i].size >= size && !m_free[i].empty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BufferPool::allocate(unsigned int size, soc_address_t& address) {
+	bool fits = false;
+	for (unsigned int i = 0; i < m_classes.size(); i++) {
+		if (m_classes[i].size < size) {
+			continue;
+		}
+		if (!m_free[i].empty()) {
+			address = m_free[i].front();
+			m_free[i].pop_front();
+			m_n_free--;
+			if (n_packet_buffers() - m_n_free > m_max_used) {
+				m_max_used = n_packet_buffers() - m_n_free;
+			}
+			m_allocations[i]++;
+			if (fits) {
+				m_larger[i]++;
+			}
+			return true;
+		}
+		fits = true;
+	}
+	if (m_n_free > 0) {
+		m_failures++;
+	}
+	return false;
+}
+
+void BufferPool::release(soc_address_t address) {
+	m_free[class_of(address)].push_back(address);
+	m_n_free++;
+	m_released.notify(SC_ZERO_TIME);
+}
+
+unsigned int BufferPool::class_of(soc_address_t address) const {
+	unsigned int index = packet_buffer_index(address);
+	for (unsigned int i = 0; i < m_classes.size(); i++) {
+		if (index < m_classes[i].count) {
+			return i;
+		}
+		index -= m_classes[i].count;
+	}
+	assert(0);
+	return 0;
+}
+
+void BufferPool::save(std::ostream& out) {
+	checkpoint::write(out, m_n_free);
+	for (unsigned int i = 0; i < m_free.size(); i++) {
+		for (unsigned int j = 0; j < m_free[i].size(); j++) {
+			checkpoint::write(out, m_free[i][j]);
+		}
+		m_free[i].clear();
+	}
+	m_n_free = 0;
+}
+
+void BufferPool::restore(std::istream& in, std::vector<soc_address_t>& restored) {
+	unsigned int n = 0;
+	checkpoint::read(in, n);
+	for (unsigned int i = 0; i < n; i++) {
+		soc_address_t address;
+		checkpoint::read(in, address);
+		release(address);
+		restored.push_back(address);
+	}
+}
+
+void BufferPool::output_statistics(const char* name) const {
+	for (unsigned int i = 0; i < m_classes.size(); i++) {
+		std::cout << name << " buffers of " << m_classes[i].size << " bytes: "
+				<< m_classes[i].count << ", " << m_allocations[i] << " allocated, "
+				<< m_larger[i] << " of them for smaller packets" << std::endl;
+	}
+	std::cout << name << " max. packets buffered: " << m_max_used
+			<< " of " << n_packet_buffers() << " buffers, " << m_failures
+			<< " packets waited for a larger buffer" << std::endl;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file	BufferPool.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <iostream>
+#include "globaldefs.h"
+
+/**
+ * The free packet buffers of the RAM, see buffer_classes.
+ *
+ * Each size class has a FIFO of its free buffers, and a packet gets the smallest free
+ * buffer it fits in, a larger one if those of its own class are used up. Without buffer
+ * classes there is a single class, the memory slots of IpPacket::PACKET_MAX_SIZE bytes.
+ *
+ * Small buffers hold more packets in the same RAM when most packets are small, e.g.
+ * with an IMIX, at the cost of a packet that finds no free buffer large enough while
+ * there are smaller ones.
+ */
+class BufferPool {
+public:
+	/// an empty pool of the buffers of packet_buffer_classes()
+	BufferPool();
+
+	/// adds all the buffers of the packet memory
+	void fill();
+
+	/// number of free buffers
+	unsigned int num_available() const {
+		return m_n_free;
+	}
+
+	/// the largest buffers hold size bytes
+	bool fits(unsigned int size) const {
+		return size <= m_classes.back().size;
+	}
+
+	/// there is a free buffer that holds size bytes
+	bool can_allocate(unsigned int size) const;
+
+	/**
+	 * Takes the smallest free buffer that holds size bytes.
+	 * @return false if there is none
+	 */
+	bool allocate(unsigned int size, soc_address_t& address);
+
+	/// returns a buffer to the pool
+	void release(soc_address_t address);
+
+	/// notified when a buffer is returned
+	const sc_event& data_written_event() const {
+		return m_released;
+	}
+
+	/// write the free buffers to a checkpoint, the pool is left empty, see save_checkpoint()
+	void save(std::ostream& out);
+
+	/**
+	 * Restores the free buffers, call before the simulation starts.
+	 * @param restored - the buffers restored are appended to it
+	 */
+	void restore(std::istream& in, std::vector<soc_address_t>& restored);
+
+	/// print the buffers allocated from each class and the most buffers used at a time
+	void output_statistics(const char* name) const;
+
+private:
+	/// the class of the buffer at an address
+	unsigned int class_of(soc_address_t address) const;
+
+	/// the size classes
+	std::vector<buffer_class> m_classes;
+	/// free buffers of each class
+	std::vector<std::deque<soc_address_t> > m_free;
+	/// number of free buffers
+	unsigned int m_n_free;
+	/// the most buffers used at a time
+	unsigned int m_max_used;
+	/// buffers allocated from each class
+	std::vector<unsigned long> m_allocations;
+	/// buffers allocated from each class for a packet of a smaller class
+	std::vector<unsigned long> m_larger;
+	/// allocations that failed while smaller buffers were free
+	unsigned long m_failures;
+	sc_event m_released;
+};
+
+#endif /* BUFFERPOOL_H_ */
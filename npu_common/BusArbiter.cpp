@@ -0,0 +1,71 @@
+/**
+ * @file	BusArbiter.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "BusArbiter.h"
+#include <cassert>
+
+BusArbiter::BusArbiter(unsigned int n_masters, arbitration_policy policy,
+		const std::vector<unsigned int>& weights) :
+	m_policy(policy), m_weight(n_masters, 1), m_queue(n_masters), m_waiting(0),
+			m_last(n_masters - 1), m_credit(0) {
+	assert(n_masters > 0);
+	for (unsigned int i = 0; i < n_masters && i < weights.size(); i++) {
+		// a master with weight 0 would never get the bus in a weighted round
+		m_weight[i] = weights[i] > 0 ? weights[i] : 1;
+	}
+}
+
+tlm::tlm_generic_payload* BusArbiter::grant(unsigned int& master) {
+	assert(!empty());
+	master = pick();
+	tlm::tlm_generic_payload* trans = m_queue[master].front();
+	m_queue[master].pop_front();
+	m_waiting--;
+	return trans;
+}
+
+unsigned int BusArbiter::pick() {
+	const unsigned int n = m_queue.size();
+
+	if (m_policy == ARBITRATION_FIXED_PRIORITY) {
+		unsigned int best = n;
+		for (unsigned int i = 0; i < n; i++) {
+			if (!m_queue[i].empty() && (best == n || m_weight[i] > m_weight[best])) {
+				best = i;
+			}
+		}
+		m_last = best;
+		return best;
+	}
+
+	if (m_policy == ARBITRATION_WEIGHTED && m_credit > 0 && !m_queue[m_last].empty()) {
+		// the master keeps the bus for the rest of its round
+		m_credit--;
+		return m_last;
+	}
+
+	// the next waiting master after the last one
+	unsigned int i = m_last;
+	do {
+		i = (i + 1) % n;
+	} while (m_queue[i].empty());
+	m_last = i;
+	m_credit = m_weight[i] - 1;
+	return i;
+}
+
+const char* BusArbiter::policy_name(arbitration_policy policy) {
+	switch (policy) {
+	case ARBITRATION_ROUND_ROBIN:
+		return "round robin";
+	case ARBITRATION_FIXED_PRIORITY:
+		return "fixed priority";
+	case ARBITRATION_WEIGHTED:
+		return "weighted round robin";
+	}
+	return "unknown";
+}
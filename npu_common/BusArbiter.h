@@ -0,0 +1,82 @@
+/**
+ * @file	BusArbiter.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef BUSARBITER_H_
+#define BUSARBITER_H_
+
+#include <deque>
+#include <vector>
+#include <tlm.h>
+#include "globaldefs.h"
+
+/**
+ * Arbiter of a shared bus.
+ *
+ * Every master has a FIFO of transactions waiting for the bus. When the bus is free,
+ * grant() picks the master that gets it according to the policy:
+ * - ARBITRATION_ROUND_ROBIN: the next waiting master after the last granted one.
+ * - ARBITRATION_FIXED_PRIORITY: the waiting master with the highest weight, the lower
+ *   index on ties.
+ * - ARBITRATION_WEIGHTED: round robin, but a master keeps the bus for up to its weight
+ *   grants in a row while it has transactions waiting.
+ *
+ * A transaction that did not finish in its tenure is put back with retry(), in front
+ * of the FIFO of its master, and competes for the bus again.
+ *
+ * The arbiter only orders the transactions, the timing is up to the bus.
+ */
+class BusArbiter {
+public:
+	/**
+	 * @param n_masters - number of bus masters
+	 * @param policy - arbitration policy
+	 * @param weights - weight (priority) of each master, missing ones are 1
+	 */
+	BusArbiter(unsigned int n_masters, arbitration_policy policy,
+			const std::vector<unsigned int>& weights);
+
+	/// queues a transaction of a master
+	void request(unsigned int master, tlm::tlm_generic_payload* trans) {
+		m_queue[master].push_back(trans);
+		m_waiting++;
+	}
+
+	/// puts back a preempted transaction, it is the next one of its master
+	void retry(unsigned int master, tlm::tlm_generic_payload* trans) {
+		m_queue[master].push_front(trans);
+		m_waiting++;
+	}
+
+	/// true if no transaction is waiting
+	bool empty() const { return m_waiting == 0; }
+
+	/**
+	 * Takes the transaction that gets the bus.
+	 * @pre !empty()
+	 * @param master - set to the master of the transaction
+	 */
+	tlm::tlm_generic_payload* grant(unsigned int& master);
+
+	/// the policy as text
+	static const char* policy_name(arbitration_policy policy);
+
+private:
+	/// picks the master that gets the bus
+	unsigned int pick();
+
+	const arbitration_policy m_policy;
+	std::vector<unsigned int> m_weight;
+	std::vector<std::deque<tlm::tlm_generic_payload*> > m_queue;
+	/// number of transactions in the queues
+	unsigned int m_waiting;
+	/// the master granted last
+	unsigned int m_last;
+	/// grants left for m_last in the current round (ARBITRATION_WEIGHTED)
+	unsigned int m_credit;
+};
+
+#endif /* BUSARBITER_H_ */
@@ -0,0 +1,176 @@
+/**
+ * @file	Checkpoint.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "Checkpoint.h"
+#include "globaldefs.h"
+#include "RAM.h"
+#include "IoModule.h"
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+
+/// identifies the file and the version of its format
+static const char checkpoint_magic[8] = { 'N', 'P', 'U', 'C', 'K', 'P', 'T', '2' };
+
+/// the configuration the saved state depends on
+struct CheckpointConfig {
+	unsigned int n_macs;
+	unsigned int n_cpus;
+	unsigned int n_memory_slots;
+	unsigned int header_split;
+	unsigned int n_rx_queues;
+	unsigned int descriptor_rings;
+	/// the sizes and counts of the packet buffers, the memory slots are a single class
+	std::vector<buffer_class> packet_buffers;
+
+	CheckpointConfig() :
+		n_macs(nMacs), n_cpus(::n_cpus), n_memory_slots(::n_memory_slots),
+				header_split(dma_header_split), n_rx_queues(::n_rx_queues),
+				descriptor_rings(::descriptor_rings), packet_buffers(packet_buffer_classes()) {
+	}
+
+	bool operator==(const CheckpointConfig& other) const {
+		if (packet_buffers.size() != other.packet_buffers.size()) {
+			return false;
+		}
+		for (unsigned int i = 0; i < packet_buffers.size(); i++) {
+			if (packet_buffers[i].size != other.packet_buffers[i].size
+					|| packet_buffers[i].count != other.packet_buffers[i].count) {
+				return false;
+			}
+		}
+		return n_macs == other.n_macs && n_cpus == other.n_cpus
+				&& n_memory_slots == other.n_memory_slots
+				&& header_split == other.header_split && n_rx_queues == other.n_rx_queues
+				&& descriptor_rings == other.descriptor_rings;
+	}
+
+	void save(ostream& out) const {
+		checkpoint::write(out, n_macs);
+		checkpoint::write(out, n_cpus);
+		checkpoint::write(out, n_memory_slots);
+		checkpoint::write(out, header_split);
+		checkpoint::write(out, n_rx_queues);
+		checkpoint::write(out, descriptor_rings);
+		checkpoint::write(out, (unsigned int) packet_buffers.size());
+		for (unsigned int i = 0; i < packet_buffers.size(); i++) {
+			checkpoint::write(out, packet_buffers[i]);
+		}
+	}
+
+	void restore(istream& in) {
+		checkpoint::read(in, n_macs);
+		checkpoint::read(in, n_cpus);
+		checkpoint::read(in, n_memory_slots);
+		checkpoint::read(in, header_split);
+		checkpoint::read(in, n_rx_queues);
+		checkpoint::read(in, descriptor_rings);
+		unsigned int n = 0;
+		checkpoint::read(in, n);
+		packet_buffers.clear();
+		// a truncated file stops the loop, not a huge count
+		for (unsigned int i = 0; i < n && in; i++) {
+			buffer_class c;
+			checkpoint::read(in, c);
+			packet_buffers.push_back(c);
+		}
+	}
+};
+
+inline ostream& operator<<(ostream& o, const CheckpointConfig& config) {
+	o << config.n_macs << " ports, " << config.n_cpus << " CPUs, " << config.n_memory_slots
+			<< " memory slots" << (config.header_split ? ", header split" : "") << ", "
+			<< config.n_rx_queues << " receive queues"
+			<< (config.descriptor_rings ? ", descriptor rings" : "") << ", packet buffers";
+	for (unsigned int i = 0; i < config.packet_buffers.size(); i++) {
+		o << (i == 0 ? " " : ",") << config.packet_buffers[i].size << ":"
+				<< config.packet_buffers[i].count;
+	}
+	return o;
+}
+
+bool save_checkpoint(const char* file, RAM& ram, IoModule& io) {
+	if (descriptor_rings) {
+		cerr << "checkpoints are not supported with descriptor rings" << endl;
+		return false;
+	}
+	ofstream out(file, ios::binary);
+	if (!out) {
+		cerr << "unable to write checkpoint " << file << endl;
+		return false;
+	}
+	out.write(checkpoint_magic, sizeof(checkpoint_magic));
+	CheckpointConfig().save(out);
+
+	checkpoint::write(out, simulation_time());
+	checkpoint::write(out, n_packets_received);
+	checkpoint::write(out, n_packets_dropped_input_mac);
+	checkpoint::write(out, n_packets_dropped_output_mac);
+	checkpoint::write(out, n_packets_dropped_header);
+	checkpoint::write(out, n_packets_sent);
+	checkpoint::write(out, max_latency);
+	checkpoint::write(out, min_latency);
+	checkpoint::write(out, total_latency);
+
+	ram.save(out);
+	io.save(out);
+
+	if (!out) {
+		cerr << "unable to write checkpoint " << file << endl;
+		return false;
+	}
+	cout << "checkpoint saved to " << file << " at " << simulation_time() << endl;
+	return true;
+}
+
+bool restore_checkpoint(const char* file, RAM& ram, IoModule& io) {
+	if (descriptor_rings) {
+		cerr << "checkpoints are not supported with descriptor rings" << endl;
+		return false;
+	}
+	ifstream in(file, ios::binary);
+	char magic[sizeof(checkpoint_magic)];
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, checkpoint_magic, sizeof(magic)) != 0) {
+		cerr << "not a checkpoint: " << file << endl;
+		return false;
+	}
+	CheckpointConfig config;
+	config.restore(in);
+	if (!(config == CheckpointConfig())) {
+		cerr << "checkpoint " << file << " was taken with a different configuration: "
+				<< config << endl;
+		return false;
+	}
+
+	sc_time saved_time;
+	checkpoint::read(in, saved_time);
+	checkpoint::read(in, n_packets_received);
+	checkpoint::read(in, n_packets_dropped_input_mac);
+	checkpoint::read(in, n_packets_dropped_output_mac);
+	checkpoint::read(in, n_packets_dropped_header);
+	checkpoint::read(in, n_packets_sent);
+	checkpoint::read(in, max_latency);
+	checkpoint::read(in, min_latency);
+	checkpoint::read(in, total_latency);
+
+	if (!ram.restore(in)) {
+		cerr << "checkpoint " << file << " has a different RAM size" << endl;
+		return false;
+	}
+	unsigned int n_freed = io.restore(in);
+	if (!in) {
+		cerr << "checkpoint " << file << " is truncated" << endl;
+		return false;
+	}
+
+	simulation_time_offset = saved_time;
+	cout << "checkpoint restored from " << file << " at " << saved_time << ", "
+			<< n_packets_received << " packets received, " << n_freed
+			<< " memory slots freed" << endl;
+	return true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file	Checkpoint.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <systemc>
+#include <iostream>
+#include <vector>
+
+using namespace sc_core;
+
+struct RAM;
+struct IoModule;
+
+/**
+ * Saves the state of the system at the end of a run, so that a later run can continue
+ * from it instead of simulating the warm-up again, e.g. to run several experiments
+ * from the same filled up queues.
+ *
+ * Saved are the RAM contents, the free memory slots and the packet descriptor queue
+ * of the memory manager, the transfer commands queued at the DMA channels, the replay
+ * position of the PCAP importers, the packet statistics and the simulation time.
+ * The restored run goes on with simulation_time() from that time, so the latencies of
+ * the restored packets are right; MAX_PACKETS counts the packets of both runs.
+ *
+ * Not saved are the packets in the MAC FIFOs and the transactions in flight: their
+ * memory slots are freed on restore. The CPUs and the accelerator are restarted,
+ * the routing table updates up to the restored time are applied at once.
+ *
+ * @note The FIFOs are drained when they are saved, so save at the end of the run only.
+ * @note Not supported with descriptor_rings, it returns false.
+ */
+bool save_checkpoint(const char* file, RAM& ram, IoModule& io);
+
+/**
+ * Restores a checkpoint written by save_checkpoint(). Call after the modules are created
+ * and initialize_statistics(), before sc_start(). The checkpoint must be taken with the
+ * same number of ports, CPUs, memory slots, receive queues, the same size classes of
+ * packet buffers, dma_header_split and descriptor_rings, and the same PCAP files.
+ * @return false if the file cannot be read or its configuration does not match
+ */
+bool restore_checkpoint(const char* file, RAM& ram, IoModule& io);
+
+/// binary serialization of the module states
+namespace checkpoint {
+
+/// writes a plain value as is, the checkpoint is only read on the same host
+template<typename T>
+inline void write(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*> (&value), sizeof(T));
+}
+
+template<typename T>
+inline void read(std::istream& in, T& value) {
+	in.read(reinterpret_cast<char*> (&value), sizeof(T));
+}
+
+inline void write(std::ostream& out, const sc_time& time) {
+	write(out, time.value());
+}
+
+inline void read(std::istream& in, sc_time& time) {
+	sc_dt::uint64 value = 0;
+	read(in, value);
+	time = sc_time::from_value(value);
+}
+
+/// writes the number of elements, then the elements; the FIFO is left empty
+template<typename T>
+void write_fifo(std::ostream& out, sc_fifo<T>& fifo) {
+	write(out, (unsigned int) fifo.num_available());
+	T value;
+	while (fifo.nb_read(value)) {
+		write(out, value);
+	}
+}
+
+/// reads the elements of write_fifo() into an empty FIFO, they are readable when the
+/// simulation starts
+/// @param restored - if given, the elements written to the FIFO are appended to it
+/// @return the number of elements that did not fit
+template<typename T>
+unsigned int read_fifo(std::istream& in, sc_fifo<T>& fifo, std::vector<T>* restored = 0) {
+	unsigned int n = 0, lost = 0;
+	read(in, n);
+	for (unsigned int i = 0; i < n; i++) {
+		T value;
+		read(in, value);
+		if (!fifo.nb_write(value)) {
+			lost++;
+		} else if (restored != 0) {
+			restored->push_back(value);
+		}
+	}
+	return lost;
+}
+
+} // namespace checkpoint
+
+#endif /* CHECKPOINT_H_ */
@@ -31,7 +31,7 @@ bool Cpu::verifyHeaderIntegrity(const IpPacket& header) const {
 }
 
 unsigned int Cpu::makeNHLookup( const IpPacket& header) {
-	return m_rt.getNextHop(m_packet_header.getDestAddress());
+	return m_rt.getNextHop(header.getDestAddress());
 }
 
 void Cpu::decrementTTL(IpPacket& header) {
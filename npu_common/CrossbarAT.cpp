@@ -0,0 +1,358 @@
+/**
+ * @file	CrossbarAT.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+#include "CrossbarAT.h"
+#include "reporting.h"
+
+using namespace std;
+using namespace sc_core;
+using namespace tlm;
+
+SC_HAS_PROCESS(CrossbarAT);
+CrossbarAT::CrossbarAT(sc_module_name name, unsigned int n_initiators,
+		unsigned int n_targets, unsigned int bus_width) :
+	sc_module(name), nr_of_initiators(n_initiators), nr_of_targets(n_targets),
+			arbitration_time(CLK_CYCLE_BUS), m_bus_width(bus_width), m_max_burst(bus_max_burst) {
+
+	target_socket
+			= new tlm_utils::simple_target_socket_tagged<CrossbarAT>[nr_of_initiators];
+	initiator_socket
+			= new tlm_utils::simple_initiator_socket_tagged<CrossbarAT>[nr_of_targets];
+	for (unsigned int i = 0; i < nr_of_initiators; ++i) {
+		target_socket[i].register_nb_transport_fw(this,
+				&CrossbarAT::nb_transport_fw_tagged, i);
+		target_socket[i].register_b_transport(this,
+				&CrossbarAT::b_transport_tagged, i);
+		target_socket[i].register_get_direct_mem_ptr(this,
+				&CrossbarAT::get_direct_mem_ptr_tagged, i);
+	}
+	for (unsigned int i = 0; i < nr_of_targets; ++i) {
+		initiator_socket[i].register_nb_transport_bw(this,
+				&CrossbarAT::nb_transport_bw_tagged, i);
+		initiator_socket[i].register_invalidate_direct_mem_ptr(this,
+				&CrossbarAT::invalidate_direct_mem_ptr_tagged, i);
+	}
+
+	// the masters compete for the request layers with their weights,
+	// the slaves for the response layers in round robin
+	for (unsigned int i = 0; i < nr_of_targets; ++i) {
+		std::ostringstream peq_name;
+		peq_name << "request_PEQ_" << i;
+		m_request_layer.push_back(new Layer(peq_name.str().c_str(), nr_of_initiators,
+				bus_arbitration, bus_weights));
+		sc_spawn(sc_bind(&CrossbarAT::request_layer_thread, this, i));
+	}
+	for (unsigned int i = 0; i < nr_of_initiators; ++i) {
+		std::ostringstream peq_name;
+		peq_name << "response_PEQ_" << i;
+		m_response_layer.push_back(new Layer(peq_name.str().c_str(), nr_of_targets,
+				ARBITRATION_ROUND_ROBIN, std::vector<unsigned int>()));
+		sc_spawn(sc_bind(&CrossbarAT::response_layer_thread, this, i));
+	}
+}
+
+CrossbarAT::~CrossbarAT() {
+	for (unsigned int i = 0; i < m_request_layer.size(); i++) {
+		delete m_request_layer[i];
+	}
+	for (unsigned int i = 0; i < m_response_layer.size(); i++) {
+		delete m_response_layer[i];
+	}
+	delete[] target_socket;
+	delete[] initiator_socket;
+}
+
+void CrossbarAT::request_layer_thread(unsigned int target) {
+	while (true) {
+		tlm_generic_payload* trans = transfer(*m_request_layer[target]);
+		if (trans != 0) {
+			// request transferred, the crossbar now forwards it to the target
+			sendToTarget(trans);
+		}
+	}
+}
+
+void CrossbarAT::response_layer_thread(unsigned int initiator) {
+	while (true) {
+		tlm_generic_payload* trans = transfer(*m_response_layer[initiator]);
+		if (trans != 0) {
+			// response transferred
+			sendToInitiator(trans);
+		}
+	}
+}
+
+tlm_generic_payload* CrossbarAT::transfer(Layer& layer) {
+	// pass the transactions that arrived to the arbiter,
+	// requests compete by master, responses by slave
+	tlm_generic_payload* trans;
+	while ((trans = layer.peq.get_next_transaction()) != 0) {
+		ConnectionInfo& info = connection(*trans);
+		info.queued = sc_time_stamp();
+		layer.arbiter.request(info.phase == BEGIN_REQ ? info.initiator : info.target, trans);
+	}
+	if (layer.arbiter.empty()) {
+		wait(layer.peq.get_event());
+		return 0;
+	}
+
+	unsigned int source;
+	trans = layer.arbiter.grant(source);
+	ConnectionInfo& info = connection(*trans);
+	layer.grants++;
+	layer.wait_time += sc_time_stamp() - info.queued;
+
+	// the tenure, at most m_max_burst cycles of the phase
+	unsigned int cycles = info.cycles_left;
+	if (m_max_burst > 0 && cycles > m_max_burst) {
+		cycles = m_max_burst;
+	}
+	sc_time tenure = arbitration_time + CLK_CYCLE_BUS * cycles;
+	wait(tenure);
+	layer.busy_time += tenure;
+
+	info.cycles_left -= cycles;
+	if (info.cycles_left > 0) {
+		// split, the rest has to win the arbitration again
+		layer.splits++;
+		info.queued = sc_time_stamp();
+		layer.arbiter.retry(source, trans);
+		return 0;
+	}
+	return trans;
+}
+
+tlm_sync_enum CrossbarAT::nb_transport_fw_tagged(int initiator_id,
+		tlm_generic_payload& payload, tlm_phase& phase, sc_time& delay_time) {
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << &payload << " received, phase: " << phase
+			<< endl;
+
+	if (phase == BEGIN_REQ) {
+		unsigned int portId = decode(payload.get_address());
+		assert(portId < nr_of_targets);
+		ConnectionInfo& info = connection(payload);
+		assert(!info.pending);
+		info.from = &target_socket[initiator_id];
+		info.to = &initiator_socket[portId];
+		info.phase = phase;
+		info.initiator = initiator_id;
+		info.target = portId;
+		info.cycles_left = payload.is_write() ? get_transfer_cycles(payload.get_data_length()) : 1;
+		info.queued = SC_ZERO_TIME;
+		info.pending = true;
+
+		// the request competes for the layer of the slave after the annotated delay
+		m_request_layer[portId]->peq.notify(payload, delay_time);
+		phase = END_REQ;
+	} else {
+		cout << "ERROR: '" << name() << "': Illegal phase received from initiator."
+				<< endl;
+		assert(false);
+		exit(1);
+	}
+
+	return TLM_UPDATED;
+}
+
+tlm_sync_enum CrossbarAT::nb_transport_bw_tagged(int /* portId */,
+		tlm_generic_payload& payload, tlm_phase& phase, sc_time& delay_time) {
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << &payload << " sent by target, phase: " << phase
+			<< endl;
+
+	if (phase != END_REQ && phase != BEGIN_RESP) {
+		cerr << sc_time_stamp()<<" "<<name()<<": ERROR: Illegal phase received from target."
+				<< endl;
+		assert(false);
+		exit(1);
+	}
+	// Update transaction phase in the routing state.
+	ConnectionInfo& info = connection(payload);
+	assert(info.pending);
+	info.phase = phase;
+
+	if (phase == BEGIN_RESP) {
+		// the response carries the data of a read
+		info.cycles_left = payload.is_read() ? get_transfer_cycles(payload.get_data_length()) : 1;
+		// the response competes for the layer of the master
+		m_response_layer[info.initiator]->peq.notify(payload, delay_time);
+		// END_RESP is not saved, the transaction only ended for the target
+		phase = END_RESP;
+	}
+
+	return TLM_COMPLETED;
+}
+
+void CrossbarAT::b_transport_tagged(int initiator_id, tlm_generic_payload& payload,
+		sc_time& delay_time) {
+	sc_dt::uint64 address = payload.get_address();
+	unsigned int portId = decode(address);
+	assert(portId < nr_of_targets);
+
+	// a tenure on the request layer of the target and one on the response
+	// layer of the initiator, one of them carries the data
+	unsigned int data_cycles = get_transfer_cycles(payload.get_data_length());
+	sc_time request = arbitration_time + CLK_CYCLE_BUS * (payload.is_write() ? data_cycles : 1);
+	sc_time response = arbitration_time + CLK_CYCLE_BUS * (payload.is_read() ? data_cycles : 1);
+	m_request_layer[portId]->busy_time += request;
+	m_request_layer[portId]->grants++;
+	m_response_layer[initiator_id]->busy_time += response;
+	m_response_layer[initiator_id]->grants++;
+	delay_time += request + response;
+
+	// address translation for the target side, back-translation for the initiator
+	payload.set_address(address & getAddressMask(portId));
+	initiator_socket[portId]->b_transport(payload, delay_time);
+	payload.set_address(address);
+}
+
+bool CrossbarAT::get_direct_mem_ptr_tagged(int /* initiator_id */,
+		tlm_generic_payload& payload, tlm_dmi& dmi_data) {
+	sc_dt::uint64 address = payload.get_address();
+	unsigned int portId = decode(address);
+	assert(portId < nr_of_targets);
+
+	// address translation for the target side, restored for the initiator
+	payload.set_address(address & getAddressMask(portId));
+	bool granted = initiator_socket[portId]->get_direct_mem_ptr(payload, dmi_data);
+	payload.set_address(address);
+
+	// address back-translation of the region, it may not reach out of the target
+	if (dmi_data.get_end_address() > getAddressMask(portId)) {
+		dmi_data.set_end_address(getAddressMask(portId));
+	}
+	dmi_data.set_start_address(dmi_data.get_start_address() | getAddressOffset(portId));
+	dmi_data.set_end_address(dmi_data.get_end_address() | getAddressOffset(portId));
+	// a request and a response layer tenure
+	dmi_data.set_read_latency(dmi_data.get_read_latency() + 2 * arbitration_time
+			+ CLK_CYCLE_BUS);
+	dmi_data.set_write_latency(dmi_data.get_write_latency() + 2 * arbitration_time
+			+ CLK_CYCLE_BUS);
+	return granted;
+}
+
+void CrossbarAT::invalidate_direct_mem_ptr_tagged(int portId, sc_dt::uint64 start_range,
+		sc_dt::uint64 end_range) {
+	if (end_range > getAddressMask(portId)) {
+		end_range = getAddressMask(portId);
+	}
+	for (unsigned int i = 0; i < nr_of_initiators; i++) {
+		target_socket[i]->invalidate_direct_mem_ptr(start_range | getAddressOffset(portId),
+				end_range | getAddressOffset(portId));
+	}
+}
+
+void CrossbarAT::sendToTarget(tlm_generic_payload* payload_ptr) {
+	ConnectionInfo& info = connection(*payload_ptr);
+	assert(info.pending);
+
+	// address translation for the target side
+	unsigned int portId = info.target;
+	payload_ptr->set_address(payload_ptr->get_address() & getAddressMask(portId));
+
+	// Use reference for phase, so that it is automatically
+	// updated in the routing state as well.
+	tlm_phase& phase = info.phase;
+	sc_time t = SC_ZERO_TIME;
+
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << payload_ptr << " sent to target " << portId
+			<< ", phase: " << report::print(phase) << endl;
+
+	tlm_sync_enum sync = (*info.to)->nb_transport_fw(*payload_ptr, phase, t);
+	switch (sync) {
+	case TLM_ACCEPTED:
+	case TLM_UPDATED:
+		// Transaction not yet finished
+		if (phase == END_REQ) {
+			// Request phase finished, but response phase not yet started
+			wait(t); // wait the required time
+		} else { // END_RESP
+			assert(0);
+			exit(1);
+		}
+		break;
+
+	case TLM_COMPLETED:
+		// Transaction finished - early completion
+		// send to initiator
+		info.phase = BEGIN_RESP;
+		info.cycles_left = payload_ptr->is_read() ? get_transfer_cycles(
+				payload_ptr->get_data_length()) : 1;
+		m_response_layer[info.initiator]->peq.notify(*payload_ptr, t);
+		wait(t);
+		break;
+
+	default:
+		assert(0);
+		exit(1);
+	};
+}
+
+void CrossbarAT::sendToInitiator(tlm_generic_payload* payload_ptr) {
+	// find the connection info for the transaction
+	ConnectionInfo& info = connection(*payload_ptr);
+	assert(info.pending);
+
+	// address back-translation for the initiator side
+	payload_ptr->set_address(payload_ptr->get_address() | getAddressOffset(info.target));
+
+	// the data was transferred in the tenure of the response
+	tlm_phase phase = BEGIN_RESP;
+	sc_time t = SC_ZERO_TIME;
+
+	simple_target_socket_tagged<CrossbarAT>* initiatorSocket = info.from;
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << payload_ptr << " sent to initiator "
+			<< info.initiator << ", phase: " << phase << endl;
+
+	tlm_sync_enum sync = (*initiatorSocket)->nb_transport_bw(*payload_ptr, phase, t);
+	switch (sync) {
+	case TLM_COMPLETED:
+		// Transaction finished
+		info.pending = false;
+		wait(t);
+		break;
+
+	case TLM_ACCEPTED:
+	case TLM_UPDATED:
+		// Transaction not yet finished
+		// Error, 2-phase implementation shouldn't contain it
+		cerr << sc_time_stamp()<<" "<<name()<<":ERROR: Illegal phase received from initiator."
+				<< endl;
+		assert(false);
+		break;
+
+	default:
+		assert(0);
+		exit(1);
+	};
+}
+
+void CrossbarAT::output_load() {
+	cout << name() << " arbitration: " << BusArbiter::policy_name(bus_arbitration)
+			<< ", max. burst: ";
+	if (m_max_burst > 0) {
+		cout << m_max_burst << " cycles" << endl;
+	} else {
+		cout << "unlimited" << endl;
+	}
+	for (unsigned int i = 0; i < nr_of_targets; i++) {
+		const Layer& layer = *m_request_layer[i];
+		cout << name() << fixed << setprecision(1) << " request layer of target " << i
+				<< ": load " << layer.busy_time / sc_time_stamp() * 100 << "%, "
+				<< layer.grants << " grants, " << layer.splits << " splits, waited "
+				<< layer.wait_time << endl;
+	}
+	for (unsigned int i = 0; i < nr_of_initiators; i++) {
+		const Layer& layer = *m_response_layer[i];
+		cout << name() << fixed << setprecision(1) << " response layer of initiator " << i
+				<< ": load " << layer.busy_time / sc_time_stamp() * 100 << "%, "
+				<< layer.grants << " grants, " << layer.splits << " splits, waited "
+				<< layer.wait_time << endl;
+	}
+}
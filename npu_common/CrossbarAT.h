@@ -0,0 +1,205 @@
+/**
+ * @file	CrossbarAT.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef CROSSBARAT_H_
+#define CROSSBARAT_H_
+
+#include <vector>
+#include <sstream>
+#include <tlm.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/peq_with_get.h>
+
+#include "globaldefs.h"
+#include "BusArbiter.h"
+using namespace tlm;
+using namespace sc_core;
+using namespace tlm_utils;
+
+/**
+ * @class CrossbarAT
+ * Multi-layer crossbar interconnect for approximately timed simulations, an
+ * alternative to SimpleBusAT with the same sockets and address decoding.
+ *
+ * Every slave has its own request layer and every master its own response layer,
+ * each with a BusArbiter and the timing of a SimpleBusAT tenure (arbitration_time
+ * plus bytes / bus width + 1 cycles for the phase that carries the data, split after
+ * bus_max_burst cycles). Transfers to different slaves, and responses to different
+ * masters, proceed in parallel; masters only contend when they address the same slave.
+ */
+SC_MODULE(CrossbarAT) {
+private:
+	/// Routing state of a transaction, attached to its payload as an extension,
+	/// see SimpleBusAT::ConnectionInfo
+	struct ConnectionInfo : public tlm_extension<ConnectionInfo> {
+		simple_target_socket_tagged<CrossbarAT>* from;
+		simple_initiator_socket_tagged<CrossbarAT>* to;
+		tlm::tlm_phase phase;
+		/// index of the initiator socket (master)
+		unsigned int initiator;
+		/// index of the target port (slave)
+		unsigned int target;
+		/// bus cycles left of the current phase
+		unsigned int cycles_left;
+		/// time when the transaction started waiting for its layer
+		sc_time queued;
+		/// true from the request until the response is delivered
+		bool pending;
+
+		tlm_extension_base* clone() const {
+			return new ConnectionInfo(*this);
+		}
+		void copy_from(const tlm_extension_base& ext) {
+			*this = static_cast<const ConnectionInfo&> (ext);
+		}
+	};
+
+	/// a layer of the crossbar, it carries one transfer at a time
+	struct Layer {
+		Layer(const char* name, unsigned int n_sources, arbitration_policy policy,
+				const std::vector<unsigned int>& weights) :
+			peq(name), arbiter(n_sources, policy, weights),
+					busy_time(SC_ZERO_TIME), wait_time(SC_ZERO_TIME), grants(0), splits(0) {
+		}
+		/// transactions that will compete for the layer
+		tlm_utils::peq_with_get<tlm_generic_payload> peq;
+		BusArbiter arbiter;
+		sc_time busy_time;
+		sc_time wait_time;
+		unsigned long grants;
+		unsigned long splits;
+	};
+
+	// *******===============================================================******* //
+	// *******                            sockets                            ******* //
+	// *******===============================================================******* //
+public:
+	simple_target_socket_tagged<CrossbarAT> *target_socket;
+	simple_initiator_socket_tagged<CrossbarAT> *initiator_socket;
+
+	// *******===============================================================******* //
+	// *******                  member objects, variables                    ******* //
+	// *******===============================================================******* //
+private:
+	const unsigned int nr_of_initiators;
+	const unsigned int nr_of_targets;
+	const sc_time arbitration_time;
+	const unsigned int m_bus_width;
+	/// max. bus cycles of a tenure, 0: no limit
+	const unsigned int m_max_burst;
+
+	/// request layers, one per slave, arbitrating between the masters
+	std::vector<Layer*> m_request_layer;
+	/// response layers, one per master, arbitrating between the slaves
+	std::vector<Layer*> m_response_layer;
+
+	// *******===============================================================******* //
+	// *******                   member functions, processes                 ******* //
+	// *******===============================================================******* //
+public:
+
+	/**
+	 * Crossbar constructor.
+	 * @param name - the name of the module
+	 * @param n_initiators - number of masters
+	 * @param n_targets - number of slaves
+	 * @param bus_width - data width of a layer in bytes
+	 */
+	CrossbarAT(sc_core::sc_module_name name, unsigned int n_initiators,
+			unsigned int n_targets, unsigned int bus_width);
+	/// destructor
+	~CrossbarAT();
+
+	//
+	// socket callback methods
+	//
+
+	tlm_sync_enum nb_transport_fw_tagged(int initiator_id, tlm_generic_payload& payload,
+			tlm_phase& phase, sc_time& delay_time);
+
+	tlm_sync_enum nb_transport_bw_tagged(int portId, tlm_generic_payload& payload,
+			tlm_phase& phase, sc_time& delay_time);
+
+	/// blocking transport, see SimpleBusAT::b_transport_tagged
+	void b_transport_tagged(int initiator_id, tlm_generic_payload& payload,
+			sc_time& delay_time);
+
+	/// DMI requests and invalidations, see SimpleBusAT::get_direct_mem_ptr_tagged
+	bool get_direct_mem_ptr_tagged(int initiator_id, tlm_generic_payload& payload,
+			tlm_dmi& dmi_data);
+
+	void invalidate_direct_mem_ptr_tagged(int portId, sc_dt::uint64 start_range,
+			sc_dt::uint64 end_range);
+
+	//
+	// Dummy decoder, the same as the one of SimpleBusAT
+	//
+
+	unsigned int getPortId(const sc_dt::uint64& address) {
+		return (unsigned int) address >> address_port_shift;
+	}
+
+	sc_dt::uint64 getAddressOffset(unsigned int portId) {
+		return (sc_dt::uint64) portId << address_port_shift;
+	}
+
+	sc_dt::uint64 getAddressMask(unsigned int /* portId */) {
+		return ((sc_dt::uint64) 1 << address_port_shift) - 1;
+	}
+
+	unsigned int decode(const sc_dt::uint64& address) {
+		return getPortId(address);
+	}
+
+	/**
+	 * print the load of the module
+	 */
+	void output_load();
+
+private:
+	/**
+	 * Gives a request layer to the requests of the masters, and forwards
+	 * a request to the slave when it is transferred.
+	 * @param target - index of the slave
+	 */
+	void request_layer_thread(unsigned int target);
+
+	/**
+	 * Gives a response layer to the responses of the slaves, and forwards
+	 * a response to the master when it is transferred.
+	 * @param initiator - index of the master
+	 */
+	void response_layer_thread(unsigned int initiator);
+
+	/**
+	 * Grants the layer to a waiting transaction and waits for its tenure.
+	 * @return the transaction if its phase was transferred, 0 if it was split
+	 * 			or no transaction was waiting
+	 */
+	tlm_generic_payload* transfer(Layer& layer);
+
+	/// the routing state of a transaction, it is created on the first use of the payload
+	ConnectionInfo& connection(tlm_generic_payload& trans) {
+		ConnectionInfo* info = trans.get_extension<ConnectionInfo> ();
+		if (info == 0) {
+			info = new ConnectionInfo;
+			info->pending = false;
+			trans.set_extension(info);
+		}
+		return *info;
+	}
+
+	inline unsigned int get_transfer_cycles(unsigned int bytes) {
+		return bytes / m_bus_width + 1;
+	}
+
+	void sendToTarget(tlm_generic_payload* payload_ptr);
+	void sendToInitiator(tlm_generic_payload* payload_ptr);
+};
+
+#endif /* CROSSBARAT_H_ */
@@ -0,0 +1,131 @@
+/**
+ * @file	DescriptorRing.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef DESCRIPTORRING_H_
+#define DESCRIPTORRING_H_
+
+#include <vector>
+#include <algorithm>
+#include "globaldefs.h"
+#include "packet_descriptor.h"
+
+/**
+ * Indices of a ring of ring_entries() packet_descriptors in the RAM, see descriptor_rings.
+ * The descriptors themselves are only in the RAM, they are written and read with bus
+ * transactions, this class keeps the registers of the device that owns the ring.
+ *
+ * The indices run freely, an index is taken modulo ring_entries() for its entry.
+ * A producer either reserves entries, writes them and completes them (the DMA channels
+ * on a receive ring, out of order), or writes them and publishes the index after them
+ * with a doorbell (a processor on a transmit ring). The consumer takes the published
+ * entries in order, and reads them from the RAM at once.
+ *
+ * A ring has an entry per memory slot and every unconsumed entry holds a packet, so it
+ * cannot overflow.
+ *
+ * receive ring:  DMA channel: reserve(), write to RAM, complete()
+ *                processor:   claim at rx_queue_address() (consume()), read from RAM
+ * transmit ring: processor:   write to RAM at tx_ring_address(), doorbell (publish())
+ *                DMA channel: consume(), read from RAM
+ */
+class DescriptorRing {
+public:
+	DescriptorRing() :
+		m_base(0), m_reserved(0), m_published(0), m_consumed(0) {
+	}
+
+	/// sets the RAM address of the ring, call before the simulation starts
+	void init(soc_address_t base) {
+		m_base = base;
+		m_completed.assign(ring_entries(), false);
+	}
+
+	/// RAM address of the entry of an index
+	soc_address_t entry_address(unsigned int index) const {
+		return m_base + (index % ring_entries()) * sizeof(packet_descriptor);
+	}
+
+	/// number of published entries not yet consumed
+	unsigned int available() const {
+		return m_published - m_consumed;
+	}
+
+	/// number of entries that can be reserved
+	unsigned int space() const {
+		return ring_entries() - (m_reserved - m_consumed);
+	}
+
+	/**
+	 * Reserves contiguous entries for the producer, they are not wrapped around the end
+	 * of the ring.
+	 * @param n - the number of entries wanted, set to the number reserved
+	 * @return the index of the first entry
+	 */
+	unsigned int reserve(unsigned int& n) {
+		n = std::min(n, std::min(space(), ring_entries() - m_reserved % ring_entries()));
+		unsigned int first = m_reserved;
+		m_reserved += n;
+		return first;
+	}
+
+	/// the reserved entries from first on are written, publishes the entries written in order
+	void complete(unsigned int first, unsigned int n) {
+		for (unsigned int i = 0; i < n; i++) {
+			m_completed[(first + i) % ring_entries()] = true;
+		}
+		unsigned int published = m_published;
+		while (published != m_reserved && m_completed[published % ring_entries()]) {
+			m_completed[published % ring_entries()] = false;
+			published++;
+		}
+		publish(published);
+	}
+
+	/// the entries before the index are written, the doorbell of the ring
+	void publish(unsigned int index) {
+		if (index != m_published) {
+			m_published = index;
+			m_changed.notify(SC_ZERO_TIME);
+		}
+	}
+
+	/**
+	 * Consumes contiguous published entries, they are not wrapped around the end of the
+	 * ring.
+	 * @param n - the max. number of entries to take, set to the number taken
+	 * @return the index of the first entry
+	 */
+	unsigned int consume(unsigned int& n) {
+		n = std::min(n, std::min(available(), ring_entries() - m_consumed % ring_entries()));
+		unsigned int first = m_consumed;
+		m_consumed += n;
+		if (n > 0) {
+			m_changed.notify(SC_ZERO_TIME);
+		}
+		return first;
+	}
+
+	/// notified when entries are published or consumed
+	const sc_event& changed_event() const {
+		return m_changed;
+	}
+
+private:
+	/// RAM address of the first entry
+	soc_address_t m_base;
+	/// the index after the last entry reserved by the producer
+	unsigned int m_reserved;
+	/// the index after the last entry the consumer may take
+	unsigned int m_published;
+	/// the index after the last entry taken by the consumer
+	unsigned int m_consumed;
+	/// the reserved entries written, but not yet published because an earlier one is not
+	std::vector<bool> m_completed;
+	sc_event m_changed;
+};
+
+#endif /* DESCRIPTORRING_H_ */
@@ -0,0 +1,281 @@
+/**
+ * @file	Dir24_8.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "Dir24_8.h"
+#include <algorithm>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// the AVX2 batch lookup is compiled for AVX2 and selected at run time
+#define DIR24_8_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#ifdef DIR24_8_AVX2
+/**
+ * Looks up groups of eight addresses with two AVX2 gathers.
+ * @return number of addresses looked up, a multiple of eight
+ */
+__attribute__((target("avx2")))
+static size_t lookupAvx2(const uint16_t* tbl24, const uint16_t* tblLong,
+		const unsigned int* addresses, unsigned int* nextHops, size_t count) {
+	const __m256i lowByte = _mm256_set1_epi32(0xFF);
+	const __m256i entryMask = _mm256_set1_epi32(0xFFFF);
+	const __m256i longFlag = _mm256_set1_epi32(Dir24_8::LONG_FLAG);
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i address = _mm256_loadu_si256((const __m256i*) (addresses + i));
+
+		// 32-bit gather at 16-bit offsets, the upper half belongs to the next entry
+		__m256i entry = _mm256_and_si256(entryMask, _mm256_i32gather_epi32(
+				(const int*) tbl24, _mm256_srli_epi32(address, 8), 2));
+		__m256i isLong = _mm256_cmpeq_epi32(_mm256_and_si256(entry, longFlag), longFlag);
+
+		if (!_mm256_testz_si256(isLong, isLong)) {
+			// second read only for the lanes pointing to a TBLlong chunk
+			__m256i index = _mm256_or_si256(
+					_mm256_slli_epi32(_mm256_andnot_si256(longFlag, entry), 8),
+					_mm256_and_si256(address, lowByte));
+			__m256i second = _mm256_mask_i32gather_epi32(zero,
+					(const int*) tblLong, index, isLong, 2);
+			entry = _mm256_blendv_epi8(entry, _mm256_and_si256(entryMask, second),
+					isLong);
+		}
+		_mm256_storeu_si256((__m256i*) (nextHops + i), entry);
+	}
+	return i;
+}
+#endif
+
+Dir24_8::Dir24_8() {
+}
+
+bool Dir24_8::prefixLength(unsigned int subnetMask, unsigned int& length) {
+	// count the leading ones of the mask, the rest of it has to be zero
+	length = 0;
+	while (length < 32 && (subnetMask & (0x80000000u >> length))) {
+		length++;
+	}
+	return length == 32 || (subnetMask << length) == 0;
+}
+
+bool Dir24_8::add(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int nextHop) {
+	unsigned int length;
+	if (!prefixLength(subnetMask, length) || nextHop >= MAX_VALUE) {
+		return false;
+	}
+
+	// an identical prefix added earlier is kept, prefixes in key order are appended
+	prefixes.insert(prefixes.end(),
+			make_pair(key(length, netAddress & subnetMask), nextHop));
+	return true;
+}
+
+bool Dir24_8::build() {
+	bool complete = true;
+
+	// both tables end with a padding entry for the 32-bit gathers of the batch lookup
+	tbl24.assign(TBL24_SIZE + 1, 0);
+	tblLong.assign(1, 0);
+	freeChunks.clear();
+
+	// Shorter prefixes come first in the map and are overwritten by longer ones.
+	for (PrefixMap::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+		unsigned int length = (unsigned int) (it->first >> 32);
+		unsigned int netAddress = (unsigned int) it->first;
+		uint16_t nextHop = (uint16_t) it->second;
+
+		if (length <= 24) {
+			// No chunk exists yet, since longer prefixes come later.
+			unsigned int first = netAddress >> 8;
+			unsigned int count = 1u << (24 - length);
+			fill(tbl24.begin() + first, tbl24.begin() + first + count, nextHop);
+		} else {
+			uint16_t& entry = tbl24[netAddress >> 8];
+			if (!(entry & LONG_FLAG)) {
+				uint16_t chunk;
+				if (!allocateChunk(chunk)) {
+					complete = false;
+					continue;
+				}
+				// new chunk inherits the /24 (or shorter) route of the entry
+				fill(tblLong.begin() + (chunk << 8),
+						tblLong.begin() + ((chunk + 1) << 8), entry);
+				entry = LONG_FLAG | chunk;
+			}
+			unsigned int first = ((entry & ~LONG_FLAG) << 8) | (netAddress & 0xFF);
+			unsigned int count = 1u << (32 - length);
+			fill(tblLong.begin() + first, tblLong.begin() + first + count, nextHop);
+		}
+	}
+	return complete;
+}
+
+bool Dir24_8::insert(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int nextHop, unsigned int& memoryWrites) {
+	unsigned int length;
+	memoryWrites = 0;
+	if (!prefixLength(subnetMask, length) || nextHop >= MAX_VALUE) {
+		return false;
+	}
+	if (tbl24.empty()) {
+		build();
+	}
+
+	netAddress &= subnetMask;
+	prefixes[key(length, netAddress)] = nextHop;
+	if (!update(netAddress, length, memoryWrites)) {
+		// out of chunks, so the prefix was new in its /24: forget it again
+		prefixes.erase(key(length, netAddress));
+		return false;
+	}
+	return true;
+}
+
+bool Dir24_8::remove(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int& memoryWrites) {
+	unsigned int length;
+	memoryWrites = 0;
+	if (!prefixLength(subnetMask, length)
+			|| prefixes.erase(key(length, netAddress & subnetMask)) == 0) {
+		return false;
+	}
+	if (!tbl24.empty()) {
+		// removing never needs a new chunk
+		update(netAddress & subnetMask, length, memoryWrites);
+	}
+	return true;
+}
+
+unsigned int Dir24_8::cover(unsigned int netAddress, unsigned int length) const {
+	for (int l = (int) length - 1; l >= 0; l--) {
+		PrefixMap::const_iterator it = prefixes.find(key(l, netAddress & mask(l)));
+		if (it != prefixes.end()) {
+			return it->second;
+		}
+	}
+	return 0;
+}
+
+bool Dir24_8::update(unsigned int netAddress, unsigned int length,
+		unsigned int& memoryWrites) {
+	if (length <= 24) {
+		// Repaint the TBL24 range of the prefix: start with the covering
+		// route, then apply the prefixes inside the range, shortest first.
+		unsigned int first = netAddress >> 8;
+		unsigned int count = 1u << (24 - length);
+		vector<uint16_t> values(count, (uint16_t) cover(netAddress, length));
+
+		for (unsigned int l = length; l <= 24; l++) {
+			PrefixMap::const_iterator it = prefixes.lower_bound(key(l, netAddress));
+			PrefixMap::const_iterator end = prefixes.upper_bound(
+					key(l, netAddress | ~mask(length)));
+			for (; it != end; ++it) {
+				unsigned int begin = ((unsigned int) it->first >> 8) - first;
+				fill(values.begin() + begin, values.begin() + begin + (1u << (24 - l)),
+						(uint16_t) it->second);
+			}
+		}
+
+		// entries pointing to a chunk keep it, the chunk inherits the new value
+		for (unsigned int i = 0; i < count; i++) {
+			uint16_t& entry = tbl24[first + i];
+			if (entry & LONG_FLAG) {
+				memoryWrites += fillChunk(entry & ~LONG_FLAG, first + i, values[i]);
+			} else {
+				entry = values[i];
+				memoryWrites++;
+			}
+		}
+		return true;
+	}
+
+	// prefix longer than /24: only the chunk of one TBL24 entry changes
+	unsigned int slot = netAddress >> 8;
+	uint16_t base = (uint16_t) cover(slot << 8, 25);
+	bool haveLong = false;
+	for (unsigned int l = 25; l <= 32 && !haveLong; l++) {
+		PrefixMap::const_iterator it = prefixes.lower_bound(key(l, slot << 8));
+		haveLong = it != prefixes.end() && it->first <= key(l, (slot << 8) | 0xFF);
+	}
+
+	uint16_t& entry = tbl24[slot];
+	if (!haveLong) {
+		// last long prefix of the slot withdrawn, the chunk is released
+		if (entry & LONG_FLAG) {
+			freeChunks.push_back(entry & ~LONG_FLAG);
+		}
+		entry = base;
+		memoryWrites++;
+		return true;
+	}
+	if (!(entry & LONG_FLAG)) {
+		uint16_t chunk;
+		if (!allocateChunk(chunk)) {
+			return false;
+		}
+		entry = LONG_FLAG | chunk;
+		memoryWrites++;
+	}
+	memoryWrites += fillChunk(entry & ~LONG_FLAG, slot, base);
+	return true;
+}
+
+bool Dir24_8::allocateChunk(uint16_t& chunk) {
+	if (!freeChunks.empty()) {
+		chunk = freeChunks.back();
+		freeChunks.pop_back();
+		return true;
+	}
+	if (tblLong.size() / CHUNK_SIZE == MAX_VALUE) {
+		return false;
+	}
+	chunk = (uint16_t) (tblLong.size() / CHUNK_SIZE);
+	// the padding entry stays at the end
+	tblLong.insert(tblLong.end() - 1, CHUNK_SIZE, 0);
+	return true;
+}
+
+unsigned int Dir24_8::fillChunk(uint16_t chunk, unsigned int slot, uint16_t base) {
+	unsigned int writes = CHUNK_SIZE;
+	vector<uint16_t>::iterator begin = tblLong.begin() + (chunk << 8);
+	fill(begin, begin + CHUNK_SIZE, base);
+
+	for (unsigned int l = 25; l <= 32; l++) {
+		PrefixMap::const_iterator it = prefixes.lower_bound(key(l, slot << 8));
+		PrefixMap::const_iterator end = prefixes.upper_bound(key(l, (slot << 8) | 0xFF));
+		for (; it != end; ++it) {
+			unsigned int first = (unsigned int) it->first & 0xFF;
+			unsigned int count = 1u << (32 - l);
+			fill(begin + first, begin + first + count, (uint16_t) it->second);
+			writes += count;
+		}
+	}
+	return writes;
+}
+
+void Dir24_8::lookup(const unsigned int* addresses, unsigned int* nextHops,
+		size_t count) const {
+	assert(!tbl24.empty());
+	size_t i = 0;
+#ifdef DIR24_8_AVX2
+	static const bool haveAvx2 = __builtin_cpu_supports("avx2");
+	if (haveAvx2) {
+		i = lookupAvx2(&tbl24[0], &tblLong[0], addresses, nextHops, count);
+	}
+#endif
+	for (; i < count; i++) {
+		nextHops[i] = lookup(addresses[i]);
+	}
+}
+
+size_t Dir24_8::memoryUsage() const {
+	return (tbl24.size() + tblLong.size()) * sizeof(uint16_t);
+}
@@ -0,0 +1,189 @@
+/**
+ * @file	Dir24_8.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef DIR24_8_H_
+#define DIR24_8_H_
+
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <cassert>
+#include <stdint.h>
+
+/**
+ * Direct indexed longest prefix match table (DIR-24-8-BASIC).
+ *
+ * The first table (TBL24) has an entry for every /24 network, it is indexed
+ * with the upper 24 bits of the address. An entry either holds the next hop
+ * directly, or, if a prefix longer than /24 exists in its range, the index
+ * of a 256-entry chunk of the second table (TBLlong), indexed with the lower
+ * 8 bits of the address. A lookup takes one or two memory reads, independent
+ * of the number of prefixes.
+ *
+ * Entries are 16 bits wide: the MSB flags a TBLlong chunk, the remaining 15
+ * bits hold the next hop or the chunk index. TBL24 alone occupies 32 MB.
+ * Both tables have one padding entry at the end, so that a 32-bit gather
+ * of their last entry stays within the array.
+ *
+ * Usage: call add() for every routing entry, then build() once. Entries
+ * with the same prefix and prefix length are resolved in favour of the
+ * first one added. Addresses not covered by any prefix are routed to 0.
+ * Afterwards insert() and remove() update the tables in place, they only
+ * rewrite the entries covered by the changed prefix. The tables are not
+ * allocated before the first build() or insert(), so that an unused
+ * instance does not take 32 MB; lookup() must not be called before that.
+ *
+ * @see RoutingTable
+ */
+class Dir24_8 {
+public:
+	/// number of TBL24 entries
+	static const unsigned int TBL24_SIZE = 1 << 24;
+
+	/// number of TBLlong entries in one chunk
+	static const unsigned int CHUNK_SIZE = 1 << 8;
+
+	/// an entry with this bit set points to a TBLlong chunk
+	static const uint16_t LONG_FLAG = 0x8000;
+
+	/// max. number of TBLlong chunks, and max. value of a next hop + 1
+	static const unsigned int MAX_VALUE = 0x8000;
+
+	Dir24_8();
+
+	/**
+	 * Registers a prefix, it only becomes visible to lookup() after build().
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - contiguous subnet mask (host byte order)
+	 * @param nextHop - value returned by lookup() for matching addresses
+	 * @retval false if the mask is not contiguous or the next hop does not
+	 * 			fit into an entry, the entry is ignored then
+	 */
+	bool add(unsigned int netAddress, unsigned int subnetMask, unsigned int nextHop);
+
+	/**
+	 * Builds the tables from the prefixes registered so far.
+	 * @retval false if TBLlong ran out of chunks, prefixes longer than /24
+	 * 			that did not fit are ignored then
+	 */
+	bool build();
+
+	/**
+	 * Adds a prefix or replaces the next hop of an existing one, and
+	 * updates the tables incrementally.
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - contiguous subnet mask (host byte order)
+	 * @param nextHop - value returned by lookup() for matching addresses
+	 * @param memoryWrites - number of table entries written
+	 * @retval false if the mask is not contiguous, the next hop does not fit
+	 * 			into an entry or TBLlong ran out of chunks, the prefix is
+	 * 			ignored then
+	 */
+	bool insert(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int nextHop, unsigned int& memoryWrites);
+
+	/**
+	 * Withdraws a prefix, and updates the tables incrementally. The addresses
+	 * it covered fall back to the next shorter matching prefix.
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - subnet mask (host byte order)
+	 * @param memoryWrites - number of table entries written
+	 * @retval false if the prefix is not in the table
+	 */
+	bool remove(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int& memoryWrites);
+
+	/**
+	 * Longest prefix match.
+	 * @param address - destination address (host byte order)
+	 * @return next hop of the longest matching prefix, 0 if nothing matches
+	 */
+	inline unsigned int lookup(unsigned int address) const {
+		assert(!tbl24.empty());
+		uint16_t entry = tbl24[address >> 8];
+		if (!(entry & LONG_FLAG)) {
+			return entry;
+		}
+		return tblLong[((entry & ~LONG_FLAG) << 8) | (address & 0xFF)];
+	}
+
+	/**
+	 * Longest prefix match that also reports its cost.
+	 * @param address - destination address (host byte order)
+	 * @param memoryReads - number of table reads made (1 or 2)
+	 */
+	inline unsigned int lookup(unsigned int address, unsigned int& memoryReads) const {
+		memoryReads = (tbl24[address >> 8] & LONG_FLAG) ? 2 : 1;
+		return lookup(address);
+	}
+
+	/**
+	 * Longest prefix match of several addresses at once. Eight addresses
+	 * are looked up with two AVX2 gathers if the host CPU supports AVX2,
+	 * which is checked at run time.
+	 * @param addresses - destination addresses (host byte order)
+	 * @param nextHops - receives the next hop of each address
+	 * @param count - number of addresses
+	 */
+	void lookup(const unsigned int* addresses, unsigned int* nextHops,
+			size_t count) const;
+
+	/// number of TBLlong chunks in use
+	size_t chunkCount() const { return tblLong.size() / CHUNK_SIZE - freeChunks.size(); }
+	/// memory used by the lookup structure in bytes
+	size_t memoryUsage() const;
+
+private:
+	/// prefixes ordered by length, then by network address, see key()
+	typedef std::map<uint64_t, unsigned int> PrefixMap;
+
+	/// key of a prefix in PrefixMap
+	static uint64_t key(unsigned int length, unsigned int netAddress) {
+		return ((uint64_t) length << 32) | netAddress;
+	}
+
+	/// subnet mask of a prefix length
+	static unsigned int mask(unsigned int length) {
+		return length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+	}
+
+	/// converts a contiguous subnet mask to a prefix length
+	static bool prefixLength(unsigned int subnetMask, unsigned int& length);
+
+	/// next hop of the longest prefix shorter than length that covers netAddress
+	unsigned int cover(unsigned int netAddress, unsigned int length) const;
+
+	/// rewrites the entries covered by a prefix after it was inserted or removed
+	bool update(unsigned int netAddress, unsigned int length,
+			unsigned int& memoryWrites);
+
+	/// takes a free TBLlong chunk or appends a new one
+	bool allocateChunk(uint16_t& chunk);
+
+	/**
+	 * Writes a TBLlong chunk from scratch.
+	 * @param chunk - index of the chunk
+	 * @param slot - TBL24 index the chunk belongs to
+	 * @param base - next hop of the /24 or shorter prefix covering the slot
+	 * @return number of entries written
+	 */
+	unsigned int fillChunk(uint16_t chunk, unsigned int slot, uint16_t base);
+
+	/// prefixes registered with add() or insert()
+	PrefixMap prefixes;
+
+	/// first level table, indexed by the upper 24 address bits
+	std::vector<uint16_t> tbl24;
+
+	/// second level chunks, indexed by chunk index * 256 + lower 8 address bits
+	std::vector<uint16_t> tblLong;
+
+	/// chunks of TBLlong released by remove()
+	std::vector<uint16_t> freeChunks;
+};
+
+#endif /* DIR24_8_H_ */
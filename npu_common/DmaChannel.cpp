@@ -6,6 +6,8 @@
 #include "reporting.h"                                // Reporting convenience macros
 #include "DmaChannel.h"                         // Our header
 #include "tlm.h"                                      // TLM headers
+#include "Checkpoint.h"                               // save(), restore()
+#include "FlowHash.h"                                 // receive queue of a packet
 using namespace sc_core;
 
 ///  filename for reporting
@@ -22,48 +24,82 @@ void DmaChannel::initiator_thread(void) {
 	/// the DMA transfers data
 	soc_address_t transaction_address;
 
-	// utility for log messages
-	std::ostringstream msg;
-
 	while (true) {
 
-		unsigned int n_free_slots 				= free_memory_addresses->num_available();
-		unsigned int n_waiting_input_packets	= mac_in_port->num_available();
+		bool receive								= receive_ready();
 		unsigned int n_waiting_tasks			= task_queue.num_available();
-		// Wait until
+		// Wait until there is a free payload and
 		// 1) there is either input from the MACs with free slot in the memory to write to or
-		// 2) a command from the CPUs and the possibility to transmit packets over the output line.
-		while (!(n_waiting_input_packets && n_free_slots) && (!n_waiting_tasks && mac_out_port->num_free())) {
-			wait(task_queue.data_written_event() | mac_in_port->data_written_event()
-					| free_memory_addresses->data_written_event() | mac_out_port->data_read_event());
+		// 2) a command from the CPUs and room in the MAC output FIFO for one more packet
+		//    besides the ones being read from the memory.
+		while (m_free_transactions.empty() || (!receive
+				&& !(n_waiting_tasks && (unsigned int) mac_out_port->num_free() > m_pending_reads))) {
+			if (loosely_timed && m_qk.get_local_time() > SC_ZERO_TIME) {
+				// the local time may not run ahead while waiting for the other processes,
+				// they may have produced work until it
+				m_qk.sync();
+			} else {
+				wait(task_queue.data_written_event() | mac_in_port->data_written_event()
+						| free_memory_addresses->data_written_event() | mac_out_port->data_read_event()
+						| transaction_finished_event);
+			}
 
 			// refresh after resuming
-			n_free_slots 			= free_memory_addresses->num_available();
-			n_waiting_input_packets = mac_in_port->num_available();
+			receive					= receive_ready();
 			n_waiting_tasks			= task_queue.num_available();
 		}
 
+		// take a free transaction
+		Transaction* t = m_free_transactions.back();
+		m_free_transactions.pop_back();
+		packet_descriptor& d = t->descriptor;
+		tlm_command command;
+
 		//======================================================================
 		// Start new transaction either based on a command or using data from
 		// MAC input FIFO.
 		// MAC FIFO has priority (avoid packet drops).
 		//======================================================================
 
-		if (n_free_slots > 0 && n_waiting_input_packets
-				> 0) {
+		if (receive) {
 			/*
 			 * Packet available in input FIFO and there is a free slot in the RAM,
 			 * generate payload based on packet from MAC FIFO.
 			 */
 
-			// read a packet from the MAC FIFO
-			assert(mac_in_port->nb_read(actual_packet_ptr));
+			// read a packet from the MAC FIFO, or take the one waiting for a buffer
+			if (m_waiting_packet != 0) {
+				t->packet = m_waiting_packet;
+				m_waiting_packet = 0;
+			} else {
+				assert(mac_in_port->nb_read(t->packet));
+			}
+			d.size = IpPacket::DATA_OFFSET + t->packet->data_size;
+
+			if (!free_memory_addresses->fits(d.size)) {
+				// larger than every buffer, it would wait for one forever: the MAC drops it
+				n_packets_dropped_input_mac++;
+				PacketPool::release(t->packet);
+				t->packet = 0;
+				m_free_transactions.push_back(t);
+				continue;
+			}
 
 			// get the address of a free memory slot
-			assert(free_memory_addresses->nb_read(transaction_address));
+			if (!free_memory_addresses->allocate(d.size, transaction_address)) {
+				// only smaller buffers are free, the packet waits for a larger one
+				m_waiting_packet = t->packet;
+				t->packet = 0;
+				m_free_transactions.push_back(t);
+				continue;
+			}
+
+			// place the packet into the slot, the header into its header buffer if split
+			d.baseAddress = transaction_address;
+			split_packet(d, *t->packet);
 
 			// the transaction will be writing data to the target
-			payload.set_command(TLM_WRITE_COMMAND);
+			command = TLM_WRITE_COMMAND;
 
 		} else if (n_waiting_tasks > 0) {
 			/*
@@ -71,20 +107,17 @@ void DmaChannel::initiator_thread(void) {
 			 * Generate payload based on command.
 			 */
 
-			// get an ip packet object with sufficiently big buffer for the data array
-			// The RAM content will be transfered into this packet.
-			actual_packet_ptr = ip_packet_buffer->front();
-			ip_packet_buffer->pop();
+			// get command from the queue, it holds the segments in RAM
+			d = task_queue.read();
 
-			// get command from the queue, then get the address in RAM
-			packet_descriptor p = task_queue.read();
-			transaction_address = p.baseAddress;
-			// set packet's size parameter
-			actual_packet_ptr->data_size = p.size - sizeof(actual_packet_ptr->received)
-					- sizeof(actual_packet_ptr->data_size);
+			// get an ip packet object with sufficiently big buffer for the data array,
+			// its size parameter is set. The RAM content will be transfered into this packet.
+			t->packet = packet_pool->acquire(d.size - IpPacket::DATA_OFFSET);
+			assert(t->packet != 0); // the image came from a memory slot, it fits
+			m_pending_reads++;
 
 			// the transaction will be reading data from the target
-			payload.set_command(TLM_READ_COMMAND);
+			command = TLM_READ_COMMAND;
 
 		} else {
 			// ERROR
@@ -92,20 +125,119 @@ void DmaChannel::initiator_thread(void) {
 			assert(0);
 		}
 
-		// Set parameters that are common for both cases.
+		// Set parameters that are common for both cases, one payload per segment.
 		// Both include transfer between a MAC FIFO, just the direction is different
-		payload.set_address(transaction_address); // address was set in the specific if branches
-		payload.set_data_ptr(reinterpret_cast<unsigned char*> (actual_packet_ptr));
-		payload.set_data_length(sizeof(actual_packet_ptr->data_size)
-				+ sizeof(actual_packet_ptr->received) + actual_packet_ptr->data_size);
-		payload.set_response_status(TLM_INCOMPLETE_RESPONSE);
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < d.n_segments; i++) {
+			tlm_generic_payload& payload = t->payload[i];
+			payload.set_command(command);
+			payload.set_address(d.segment[i].address);
+			payload.set_data_ptr(reinterpret_cast<unsigned char*> (t->packet) + offset);
+			payload.set_data_length(d.segment[i].size);
+			payload.set_response_status(TLM_INCOMPLETE_RESPONSE);
+			offset += d.segment[i].size;
+		}
+		assert(offset == d.size);
+		t->n_finished = 0;
+
+		// load statistics
+		unsigned int in_flight = m_transactions.size() - m_free_transactions.size();
+		if (in_flight == 1) {
+			m_busy_since = sc_time_stamp();
+		}
+		if (in_flight > m_max_in_flight) {
+			m_max_in_flight = in_flight;
+		}
 
 		//==================================================================
-		//	start transaction
+		//	loosely timed: blocking transactions at the local time
 		//==================================================================
-		// Create phase and delay time objects
-		tlm_phase phase = BEGIN_REQ;
-		sc_time delay = SC_ZERO_TIME;
+		if (loosely_timed) {
+			for (unsigned int i = 0; i < d.n_segments; i++) {
+				sc_time delay = m_qk.get_local_time();
+				if (!(use_dmi && m_dmi.transport(initiator_socket, t->payload[i], delay))) {
+					initiator_socket->b_transport(t->payload[i], delay);
+				}
+				m_qk.set(delay);
+			}
+			for (unsigned int i = 0; i < d.n_segments; i++) {
+				segment_finished(t, t->payload[i]);
+			}
+			if (m_qk.need_sync()) {
+				m_qk.sync();
+			}
+			continue;
+		}
+
+		//==================================================================
+		//	start transactions, with use_dmi the segments in the RAM are copied
+		//==================================================================
+		bool direct[packet_descriptor::MAX_SEGMENTS];
+		sc_time dmi_delay = SC_ZERO_TIME;
+		unsigned int n_direct = 0;
+		for (unsigned int i = 0; i < d.n_segments; i++) {
+			direct[i] = use_dmi && m_dmi.transport(initiator_socket, t->payload[i], dmi_delay);
+			if (direct[i]) {
+				n_direct++;
+			} else {
+				send_request(t->payload[i]);
+			}
+		}
+		if (n_direct > 0) {
+			// the copies are done, synchronize with the time they took
+			wait(dmi_delay);
+			for (unsigned int i = 0; i < d.n_segments; i++) {
+				if (direct[i]) {
+					segment_finished(t, t->payload[i]);
+				}
+			}
+		}
+	} // end while true
+} // end initiator_thread
+
+bool DmaChannel::receive_ready() const {
+	if (m_waiting_packet != 0) {
+		return free_memory_addresses->can_allocate(IpPacket::DATA_OFFSET
+				+ m_waiting_packet->data_size);
+	}
+	return mac_in_port->num_available() > 0 && free_memory_addresses->num_available() > 0;
+}
+
+void DmaChannel::split_packet(packet_descriptor& d, const IpPacket& packet) const {
+	d.n_segments = 1;
+	d.segment[0].address = d.baseAddress;
+	d.segment[0].size = d.size;
+	if (!dma_header_split) {
+		return;
+	}
+
+	// the header segment ends with the IP header
+	unsigned int header_length = 4 * packet.getHeaderLength();
+	if (packet.data_size == 0 || header_length < IpPacket::MINIMAL_IP_HEADER_LENGTH) {
+		// not a valid IPv4 header, the processors will drop the packet
+		header_length = IpPacket::MINIMAL_IP_HEADER_LENGTH;
+	}
+	unsigned int header_size = IpPacket::DATA_OFFSET + header_length;
+
+	d.segment[0].address = header_buffer_address(d.baseAddress);
+	if (header_size < d.size) {
+		d.n_segments = 2;
+		d.segment[0].size = header_size;
+		d.segment[1].address = d.baseAddress;
+		d.segment[1].size = d.size - header_size;
+	}
+}
+
+void DmaChannel::send_request(tlm_generic_payload& payload) {
+	// utility for log messages
+	std::ostringstream msg;
+
+	//==================================================================
+	//	start transaction
+	//==================================================================
+	// Create phase and delay time objects
+	tlm_phase phase = BEGIN_REQ;
+	sc_time delay = SC_ZERO_TIME;
 
 //		msg.str("");
 //		msg << name() << " starting new transaction" << " for Addr:0x" << hex << setw(8)
@@ -114,64 +246,62 @@ void DmaChannel::initiator_thread(void) {
 //				<< delay << ")";
 //		REPORT_INFO(filename, __FUNCTION__, msg.str());
 
-		if(do_logging & LOG_DMA)
-			cout << sc_time_stamp()<<" "<<name()<<": trans " << &payload << " sent. Addr:0x" 
-				<< hex << setw(8) << setfill('0') << uppercase << payload.get_address()<<dec
-				<< ", phase: " << phase << endl;
+	if(do_logging & LOG_DMA)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << &payload << " sent. Addr:0x" 
+			<< hex << setw(8) << setfill('0') << uppercase << payload.get_address()<<dec
+			<< ", phase: " << phase << endl;
+
+	//-----------------------------------------------------------------------------
+	// Make the non-blocking call and decode returned status (tlm_sync_enum)
+	//-----------------------------------------------------------------------------
+	tlm_sync_enum return_value = initiator_socket->nb_transport_fw(payload, phase,
+			delay);
+
+	msg.str("");
+	msg << name() << " " << report::print(return_value) << " (GP, " << report::print(
+			phase) << ", " << delay << ")" << endl;
+
+	switch (return_value) {
+
+	case TLM_COMPLETED: {
+		// Early completion, not implemented in the laboratory example,
+		// omitted to keep the code simpler
+		REPORT_FATAL (filename, __FUNCTION__, "DMA: Bus completed early." );
+		break;
+	}// end case TLM_COMPLETED
+	case TLM_UPDATED: {
 
 		//-----------------------------------------------------------------------------
-		// Make the non-blocking call and decode returned status (tlm_sync_enum)
+		// Target returned UPDATED, this will be 2 phase transaction
+		//    Wait the annotated delay
 		//-----------------------------------------------------------------------------
-		tlm_sync_enum return_value = initiator_socket->nb_transport_fw(payload, phase,
-				delay);
-
-		msg.str("");
-		msg << name() << " " << report::print(return_value) << " (GP, " << report::print(
-				phase) << ", " << delay << ")" << endl;
+		if (phase == END_REQ) {
 
-		switch (return_value) {
-
-		case TLM_COMPLETED: {
-			// Early completion, not implemented in the laboratory example,
-			// omitted to keep the code simpler
-			REPORT_FATAL (filename, __FUNCTION__, "DMA: Bus completed early." );
-			break;
-		}// end case TLM_COMPLETED
-		case TLM_UPDATED: {
-
-			//-----------------------------------------------------------------------------
-			// Target returned UPDATED, this will be 2 phase transaction
-			//    Wait the annotated delay
-			//-----------------------------------------------------------------------------
-			if (phase == END_REQ) {
-
-				wait(delay); // wait the annotated delay
-				if(do_logging & LOG_DMA)
-					cout << sc_time_stamp()<<" "<<name()
-						<<": transaction waiting begin-response on backward path" << endl;
+			wait(delay); // wait the annotated delay
+			if(do_logging & LOG_DMA)
+				cout << sc_time_stamp()<<" "<<name()
+					<<": transaction waiting begin-response on backward path" << endl;
 
 //				msg << "      " << name()
 //						<< " transaction waiting begin-response on backward path";
 //				REPORT_INFO (filename, __FUNCTION__, msg.str() );
 
-			} else {
-				msg << "      " << name()
-						<< " Unexpected phase for UPDATED return from target ";
-				REPORT_FATAL (filename, __FUNCTION__, msg.str() );
-			}
-			break;
-		} // end case TLM_UPDATED
-		case TLM_ACCEPTED: {
-			// Target returned ACCEPTED -> this would be 4 phase transaction
-			// Case not implemented, to keep code simple.
-			REPORT_FATAL (filename, __FUNCTION__, "DMA: Bus returned TLM_ACCEPTED: this should not occur in 2 phase models." );
-			break;
-		} // end case TLM_ACCEPTED
-
-		} // end case
-		wait(transaction_finished_event);
-	} // end while true
-} // end initiator_thread
+		} else {
+			msg << "      " << name()
+					<< " Unexpected phase for UPDATED return from target ";
+			REPORT_FATAL (filename, __FUNCTION__, msg.str() );
+		}
+		break;
+	} // end case TLM_UPDATED
+	case TLM_ACCEPTED: {
+		// Target returned ACCEPTED -> this would be 4 phase transaction
+		// Case not implemented, to keep code simple.
+		REPORT_FATAL (filename, __FUNCTION__, "DMA: Bus returned TLM_ACCEPTED: this should not occur in 2 phase models." );
+		break;
+	} // end case TLM_ACCEPTED
+
+	} // end case
+}
 
 
 //=============================================================================
@@ -263,8 +393,9 @@ DmaChannel::nb_transport_fw(tlm_generic_payload &gp, tlm_phase &phase,
 	switch (phase) {
 	//=============================================================================
 	case BEGIN_REQ: {
-		// make as sure as possible that the data sent is a PacketDescriptor
-		assert(gp.get_data_length() == sizeof(packet_descriptor));
+		// make as sure as possible that the data sent is a PacketDescriptor or a batch of them
+		assert(is_descriptor_length(gp.get_data_length())
+				|| gp.get_address() >= TX_DOORBELL_OFFSET);
 
 		if (gp.is_write()) {
 			//-----------------------------------------------------------------------------
@@ -324,6 +455,179 @@ DmaChannel::nb_transport_fw(tlm_generic_payload &gp, tlm_phase &phase,
 	return return_status;
 } //end nb_transport_fw
 
+//=============================================================================
+//
+//  blocking transport of commands in loosely_timed mode
+//
+//=============================================================================
+void DmaChannel::b_transport(tlm_generic_payload &gp, sc_time &delay_time) {
+	// make as sure as possible that the data sent is a PacketDescriptor or a batch of them
+	assert(is_descriptor_length(gp.get_data_length())
+			|| gp.get_address() >= TX_DOORBELL_OFFSET);
+
+	delay_time += gp.is_write() ? m_accept_command_delay : m_prepare_packet_descriptor_delay;
+	execute_command(gp);
+}
+
+void DmaChannel::execute_command(tlm_generic_payload &gp) {
+	// the data of the payload, casted to represent a packet descriptor
+	packet_descriptor* descriptor_ptr = reinterpret_cast<packet_descriptor*> (gp.get_data_ptr());
+
+	if (gp.get_address() >= TX_DOORBELL_OFFSET) {
+		ring_doorbell(gp);
+		return;
+	}
+
+	if (gp.is_write()) {
+		// a write command
+		// transfer request to MAC output FIFO
+
+		// a batch of commands is accepted as a whole
+		unsigned int n = 1;
+		unsigned int capacity = descriptor_batch_capacity(gp.get_data_length());
+		if (capacity > 0) {
+			n = descriptor_batch_count(gp.get_data_ptr());
+			descriptor_ptr = descriptor_batch_entries(gp.get_data_ptr());
+			if (n > capacity) {
+				gp.set_response_status(TLM_GENERIC_ERROR_RESPONSE);
+				REPORT_ERROR(filename, __FUNCTION__, "transfer command with more descriptors than its size");
+				return;
+			}
+		}
+
+		// check if the commands fit
+		if (task_queue.num_free() < (int) n) {
+			// cannot write to FIFO -> report it
+			gp.set_response_status(TLM_INCOMPLETE_RESPONSE);
+			REPORT_INFO(filename, __FUNCTION__, "DMA engine couldn't accept DMA transfer command (FIFO full)");
+		} else {
+			// write the commands into the FIFO queue
+			for (unsigned int i = 0; i < n; i++) {
+				task_queue.nb_write(descriptor_ptr[i]);
+			}
+			m_command_writes++;
+			m_commands += n;
+			gp.set_response_status(TLM_OK_RESPONSE);
+			REPORT_INFO(filename, __FUNCTION__, "DMA accepted transfer command");
+		}
+	}// end WRITE
+	else if (gp.is_read()) {
+		// invalid address
+		gp.set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
+		stringstream msg("No readable DMA control register at ");
+		msg << name();
+		REPORT_ERROR(filename, __FUNCTION__, msg.str());
+
+	}// end READ
+	else {
+		gp.set_response_status(TLM_COMMAND_ERROR_RESPONSE);
+		REPORT_ERROR(filename, __FUNCTION__, "DMA received payload with neither read, nor write command.");
+	}
+}
+
+void DmaChannel::ring_doorbell(tlm_generic_payload &gp) {
+	unsigned int cpu = (gp.get_address() - TX_DOORBELL_OFFSET) / sizeof(unsigned int);
+	if (!descriptor_rings || !gp.is_write() || gp.get_data_length() != sizeof(unsigned int)
+			|| cpu >= n_cpus) {
+		gp.set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
+		REPORT_ERROR(filename, __FUNCTION__, "invalid access of a transmit ring doorbell.");
+		return;
+	}
+	m_tx_ring[cpu].publish(*reinterpret_cast<unsigned int*> (gp.get_data_ptr()));
+	m_doorbells++;
+	m_ring_work_event.notify(SC_ZERO_TIME);
+	gp.set_response_status(TLM_OK_RESPONSE);
+}
+
+//=============================================================================
+//
+//  descriptor rings
+//
+//=============================================================================
+void DmaChannel::ring_thread(void) {
+	if (!descriptor_rings) {
+		return;
+	}
+	while (true) {
+		// A received packet is still coming that may join the write-back. If none is,
+		// the descriptors are written back at once, the packets would wait for nothing,
+		// and the slots of the packets may be needed for the next receive.
+		bool receiving = m_transactions.size() - m_free_transactions.size() > m_pending_reads
+				|| receive_ready();
+		bool busy = false;
+
+		for (unsigned int q = 0; q < n_rx_queues; q++) {
+			std::vector<packet_descriptor>& pending = m_writeback[q];
+			if (pending.empty() || (pending.size() < ring_writeback_batch && receiving)) {
+				continue;
+			}
+			unsigned int n = std::min((unsigned int) pending.size(), ring_writeback_batch);
+			unsigned int first = rxRing[q].reserve(n);
+			// there is always room, a ring has an entry per memory slot
+			assert(n > 0);
+			std::copy(pending.begin(), pending.begin() + n, m_ring_data.begin());
+			pending.erase(pending.begin(), pending.begin() + n);
+			ring_transfer(TLM_WRITE_COMMAND, rxRing[q].entry_address(first), n);
+			rxRing[q].complete(first, n);
+			m_ring_writebacks++;
+			m_ring_descriptors_written += n;
+			busy = true;
+		}
+
+		// fetch the transfer commands of the doorbells, as many as the task queue takes
+		for (unsigned int i = 0; i < n_cpus && task_queue.num_free() > 0; i++) {
+			DescriptorRing& ring = m_tx_ring[m_next_tx_ring];
+			m_next_tx_ring = (m_next_tx_ring + 1) % n_cpus;
+			unsigned int n = task_queue.num_free();
+			unsigned int first = ring.consume(n);
+			if (n == 0) {
+				continue;
+			}
+			ring_transfer(TLM_READ_COMMAND, ring.entry_address(first), n);
+			for (unsigned int j = 0; j < n; j++) {
+				assert(task_queue.nb_write(m_ring_data[j]));
+			}
+			m_ring_fetches++;
+			m_ring_descriptors_fetched += n;
+			busy = true;
+		}
+
+		if (!busy) {
+			wait(m_ring_work_event | task_queue.data_read_event());
+		}
+	}
+}
+
+void DmaChannel::ring_transfer(tlm_command command, soc_address_t address, unsigned int n) {
+	m_ring_payload.set_command(command);
+	m_ring_payload.set_address(address);
+	m_ring_payload.set_data_ptr(reinterpret_cast<unsigned char*> (&m_ring_data[0]));
+	m_ring_payload.set_data_length(n * sizeof(packet_descriptor));
+	m_ring_payload.set_response_status(TLM_INCOMPLETE_RESPONSE);
+
+	sc_time delay = SC_ZERO_TIME;
+	if (use_dmi && m_dmi.transport(initiator_socket, m_ring_payload, delay)) {
+		wait(delay);
+	} else if (loosely_timed) {
+		initiator_socket->b_transport(m_ring_payload, delay);
+		wait(delay);
+	} else {
+		m_ring_response_pending = true;
+		send_request(m_ring_payload);
+		while (m_ring_response_pending) {
+			wait(m_ring_response_event);
+		}
+	}
+	// the ring entries lie in the RAM, a failed transfer would leave stale descriptors
+	assert(m_ring_payload.get_response_status() == TLM_OK_RESPONSE);
+}
+
+void DmaChannel::init_tx_rings(unsigned int mac) {
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		m_tx_ring[i].init(tx_ring_address(mac, i));
+	}
+}
+
 /**
  * Target socket response generator thread
  */
@@ -331,9 +635,6 @@ void DmaChannel::respond_to_command_thread(void) {
 	// payload pointer, it is set when reading from the payload event queue
 	tlm_generic_payload *payload_ptr;
 
-	// a pointer to the data of the payload, casted to represent a packet descriptor
-	packet_descriptor * descriptor_ptr;
-
 	// loop until simulation terminates
 	while (true) {
 		// wait until a new command was received
@@ -345,38 +646,7 @@ void DmaChannel::respond_to_command_thread(void) {
 		// just to make sure.
 		while ((payload_ptr = m_command_PEQ.get_next_transaction()) != 0) {
 
-			descriptor_ptr
-					= reinterpret_cast<packet_descriptor*> (payload_ptr->get_data_ptr());
-
-			if (payload_ptr->is_write()) {
-				// a write command
-				// transfer request to MAC output FIFO
-
-				// write the command into the FIFO queue
-				bool written_to_q = task_queue.nb_write(*descriptor_ptr);
-
-				// check if the command was written
-				if (written_to_q == false) {
-					// cannot write to FIFO -> report it
-					payload_ptr->set_response_status(TLM_INCOMPLETE_RESPONSE);
-					REPORT_INFO(filename, __FUNCTION__, "DMA engine couldn't accept DMA transfer command (FIFO full)");
-				} else {
-					payload_ptr->set_response_status(TLM_OK_RESPONSE);
-					REPORT_INFO(filename, __FUNCTION__, "DMA accepted transfer command");
-				}
-			}// end WRITE
-			else if (payload_ptr->is_read()) {
-				// invalid address
-				payload_ptr->set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
-				stringstream msg("No readable DMA control register at ");
-				msg << name();
-				REPORT_ERROR(filename, __FUNCTION__, msg.str());
-
-			}// end READ
-			else {
-				payload_ptr->set_response_status(TLM_COMMAND_ERROR_RESPONSE);
-				REPORT_ERROR(filename, __FUNCTION__, "DMA received payload with neither read, nor write command.");
-			}
+			execute_command(*payload_ptr);
 
 			// call backward path
 			// Create phase and delay time objects
@@ -416,44 +686,135 @@ void DmaChannel::handle_response_thread(void) {
 		REPORT_INFO(filename, __FUNCTION__, "running");
 		while ((payload_ptr = m_response_PEQ.get_next_transaction()) != 0) {
 
-			// Check that the transaction had a source/destination IP packet.
-			assert(actual_packet_ptr != 0);
-
-			// if command was read, write result to MAC FIFO
-			if (payload_ptr->is_read()) {
-				// write to MAC out port
-				bool written = mac_out_port->nb_write(actual_packet_ptr);
-				if (written == false) {
-					// FIFO full
-					REPORT_WARNING(filename, __FUNCTION__, "packet dropped at the MAC out FIFO" );
-					n_packets_dropped_output_mac++;
-				} else {
-					// signal that address is free
-					// should never block
-					assert(this->free_memory_addresses->nb_write(payload_ptr->get_address()));
-				}
-			} else {
-				// write corresponding descriptor into descriptor queue
-				packet_descriptor pd = { payload_ptr->get_address(),
-						payload_ptr->get_data_length() };
-				assert(packetQueue->nb_write(pd));
+			if (payload_ptr == &m_ring_payload) {
+				// a descriptor ring transaction, ring_thread() is waiting for it
+				m_ring_response_pending = false;
+				m_ring_response_event.notify();
+				continue;
+			}
 
-				// return the pointer into the buffer
-				ip_packet_buffer->push(actual_packet_ptr);
+			// find the transaction of the payload, there are only a few
+			Transaction* t = 0;
+			for (unsigned int i = 0; i < m_transactions.size(); i++) {
+				for (unsigned int j = 0; j < m_transactions[i]->descriptor.n_segments; j++) {
+					if (&m_transactions[i]->payload[j] == payload_ptr) {
+						t = m_transactions[i];
+					}
+				}
 			}
-			// Set pointer to zero. This shows that it does not own any object.
-			// Needed in destructor for cleanup.
-			actual_packet_ptr = 0;
-			// notify waiting process
-			transaction_finished_event.notify(SC_ZERO_TIME);
+			// Check that the transaction had a source/destination IP packet.
+			assert(t != 0 && t->packet != 0);
+
+			segment_finished(t, *payload_ptr);
 		}
 	}
 }
 
+void DmaChannel::segment_finished(Transaction* t, tlm_generic_payload& payload) {
+	if (payload.is_read()) {
+		m_bytes_read += payload.get_data_length();
+	} else {
+		m_bytes_written += payload.get_data_length();
+	}
+	// the packet is complete when all its segments are transferred
+	if (++t->n_finished < t->descriptor.n_segments) {
+		return;
+	}
+
+	// if command was read, write result to MAC FIFO
+	if (payload.is_read()) {
+		m_pending_reads--;
+		// write to MAC out port
+		bool written = mac_out_port->nb_write(t->packet);
+		if (written == false) {
+			// FIFO full
+			REPORT_WARNING(filename, __FUNCTION__, "packet dropped at the MAC out FIFO" );
+			n_packets_dropped_output_mac++;
+			PacketPool::release(t->packet);
+		} else {
+			// signal that address is free
+			free_memory_addresses->release(t->descriptor.baseAddress);
+		}
+	} else {
+		// write corresponding descriptor into the descriptor queue of the flow
+		unsigned int queue = n_rx_queues > 1 ? rx_queue_of_hash(flow_hash(*t->packet)) : 0;
+		if (descriptor_rings) {
+			// ring_thread() writes it back to the receive ring
+			m_writeback[queue].push_back(t->descriptor);
+			m_ring_work_event.notify(SC_ZERO_TIME);
+		} else {
+			assert(packetQueue[queue]->nb_write(t->descriptor));
+		}
+
+		// the packet is in the RAM now, return it to the pool
+		PacketPool::release(t->packet);
+	}
+	// Set pointer to zero. This shows that it does not own any object.
+	// Needed in end_of_simulation() for cleanup.
+	t->packet = 0;
+	m_free_transactions.push_back(t);
+	if (m_free_transactions.size() == m_transactions.size()) {
+		m_busy_time += sc_time_stamp() - m_busy_since;
+	}
+	// notify waiting process
+	transaction_finished_event.notify(SC_ZERO_TIME);
+}
+
 void DmaChannel::end_of_simulation() {
-	// delete packet (if any) held by the actual_packet_ptr
-	if (actual_packet_ptr != 0) {
-		delete actual_packet_ptr;
+	// release packets (if any) held by transactions in flight
+	for (unsigned int i = 0; i < m_transactions.size(); i++) {
+		if (m_transactions[i]->packet != 0) {
+			PacketPool::release(m_transactions[i]->packet);
+			m_transactions[i]->packet = 0;
+		}
+	}
+	if (m_waiting_packet != 0) {
+		PacketPool::release(m_waiting_packet);
+		m_waiting_packet = 0;
+	}
+}
+
+DmaChannel::~DmaChannel() {
+	for (unsigned int i = 0; i < m_transactions.size(); i++) {
+		delete m_transactions[i];
+	}
+	delete[] m_tx_ring;
+}
+
+void DmaChannel::save(std::ostream& out) {
+	checkpoint::write_fifo(out, task_queue);
+}
+
+void DmaChannel::restore(std::istream& in, std::vector<soc_address_t>& used_slots) {
+	std::vector<packet_descriptor> queued;
+	checkpoint::read_fifo(in, task_queue, &queued);
+	for (unsigned int i = 0; i < queued.size(); i++) {
+		used_slots.push_back(queued[i].baseAddress);
+	}
+}
+
+void DmaChannel::output_load() const {
+	// a busy period that has not ended yet counts until now
+	sc_time busy_time = m_busy_time;
+	if (m_free_transactions.size() < m_transactions.size()) {
+		busy_time += sc_time_stamp() - m_busy_since;
+	}
+	double seconds = sc_time_stamp().to_seconds();
+	cout << name() << fixed << setprecision(1) << " bandwidth: to RAM "
+			<< m_bytes_written * 8 / seconds / 1e6 << " Mbit/s, from RAM "
+			<< m_bytes_read * 8 / seconds / 1e6 << " Mbit/s, busy "
+			<< busy_time / sc_time_stamp() * 100 << "%, max. " << m_max_in_flight
+			<< " of " << m_transactions.size() << " transactions in flight." << endl;
+	cout << name() << " " << m_commands << " transfer commands in " << m_command_writes
+			<< " writes." << endl;
+	if (descriptor_rings) {
+		cout << name() << " descriptor rings: " << m_ring_descriptors_written
+				<< " descriptors written back in " << m_ring_writebacks << " writes, "
+				<< m_ring_descriptors_fetched << " fetched in " << m_ring_fetches
+				<< " reads after " << m_doorbells << " doorbells." << endl;
+	}
+	if (use_dmi) {
+		cout << name() << " " << m_dmi.accesses() << " segments copied through DMI." << endl;
 	}
 }
 
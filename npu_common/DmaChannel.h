@@ -33,15 +33,20 @@
 #define __SELECT_INITIATOR_H__
 
 #include <tlm.h>                                   // TLM headers
-#include <queue>
+#include <vector>
 #include "tlm_utils/peq_with_get.h"
 #include "tlm_utils/simple_target_socket.h"
 #include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
 #include "globaldefs.h"
-#include "IpPacket.h"
+#include "PacketPool.h"
 #include "packet_descriptor.h"
+#include "DmiCache.h"
+#include "DescriptorRing.h"
+#include "BufferPool.h"
 
 #include <iomanip>
+#include <iostream>
 
 using namespace sc_core;
 using namespace tlm;
@@ -50,6 +55,28 @@ using namespace tlm;
  * @class DmaChannel
  * Model of a DMA channel that serves a single MAC, transferring packets between
  * it and the memory.
+ *
+ * The channel keeps up to dma_outstanding_transactions transfers in flight on the bus,
+ * each with its own payload, so that a MAC->RAM write and a RAM->MAC read can overlap.
+ * A RAM->MAC read is only started if the MAC output FIFO has room for the packet.
+ * A received packet that only finds free buffers smaller than itself (see buffer_classes)
+ * waits in the channel until a buffer it fits in is released.
+ *
+ * A packet is transferred as the scatter-gather segments of its packet_descriptor, with one
+ * bus transaction per segment. Received packets are split into a header and a payload
+ * segment if dma_header_split is set.
+ *
+ * With use_dmi the segments are copied through DMI instead, and the channel waits the
+ * annotated time of the copies before it finishes the transfer.
+ *
+ * In loosely_timed mode the segments are sent with b_transport, and the channel runs
+ * ahead of the simulation time with a quantum keeper. It synchronizes when the quantum
+ * is used up or before it waits for work.
+ *
+ * With descriptor_rings the descriptors of the received packets are written back to the
+ * receive rings in the RAM, ring_writeback_batch at a time, and the transfer commands are
+ * fetched from the transmit rings of the processors after their doorbells, see
+ * DescriptorRing. The ring transactions are sent one at a time by ring_thread().
  */
 SC_MODULE( DmaChannel) {
 
@@ -71,42 +98,114 @@ public:
 	tlm_utils::simple_initiator_socket<DmaChannel> initiator_socket;
 	tlm_utils::simple_target_socket<DmaChannel> target_socket;
 
-	/// Buffer for managing the ip packet pointers.
-	/// Using the buffer queue we can avoid re-creation of objects, thus
+	/// Pool of the ip packets.
+	/// Using the pool we can avoid re-creation of objects, thus
 	/// speed up the simulation.
-	std::queue<IpPacket *>* ip_packet_buffer;
+	PacketPool* packet_pool;
 
 	/// RAM slots not yet occupied by packet.
 	/// @note Declared public so that it can be set directly.
-	sc_fifo<soc_address_t> *free_memory_addresses;
+	BufferPool *free_memory_addresses;
 
-	/// Queue that holds packet descriptors. Supposed to be
+	/// Queues that hold packet descriptors, n_rx_queues of them. Supposed to be
 	/// read by the CPUs after the packets are transfered to
-	/// the memory and the processors are notified.
+	/// the memory and the processors are notified. A packet goes to the queue of its
+	/// flow, see flow_hash().
 	/// @note Declared public so that it can be set directly.
-	sc_fifo<packet_descriptor> *packetQueue;
+	sc_fifo<packet_descriptor> **packetQueue;
+
+	/// With descriptor_rings the receive rings of the memory manager, n_rx_queues of them,
+	/// instead of packetQueue.
+	/// @note Declared public so that it can be set directly.
+	DescriptorRing *rxRing;
 
 	SC_CTOR(DmaChannel):
 		initiator_socket("initiator_socket") // init socket name
 		, target_socket("target_socket"),
-		m_response_PEQ("response_PEQ"), m_command_PEQ("command_PEQ") {
+		m_response_PEQ("response_PEQ"), m_command_PEQ("command_PEQ"),
+		task_queue(task_queue_depth()) {
+
+		// payloads of the transactions, none in flight
+		for (unsigned int i = 0; i < dma_outstanding_transactions; i++) {
+			Transaction* t = new Transaction;
+			t->packet = 0;
+			m_transactions.push_back(t);
+			m_free_transactions.push_back(t);
+		}
+		m_pending_reads = 0;
+		m_waiting_packet = 0;
+		m_bytes_written = 0;
+		m_bytes_read = 0;
+		m_busy_time = SC_ZERO_TIME;
+		m_max_in_flight = 0;
+		m_command_writes = 0;
+		m_commands = 0;
+		m_tx_ring = new DescriptorRing[n_cpus];
+		m_next_tx_ring = 0;
+		m_writeback.resize(n_rx_queues);
+		m_ring_data.resize(ring_entries());
+		m_ring_response_pending = false;
+		m_doorbells = 0;
+		m_ring_writebacks = 0;
+		m_ring_descriptors_written = 0;
+		m_ring_fetches = 0;
+		m_ring_descriptors_fetched = 0;
 
 		// register callback with initiator socket
 		initiator_socket.register_nb_transport_bw(this, &DmaChannel::nb_transport_bw);
+		initiator_socket.register_invalidate_direct_mem_ptr(this,
+				&DmaChannel::invalidate_direct_mem_ptr);
 		// register callback with target socket
 		target_socket.register_nb_transport_fw(this, &DmaChannel::nb_transport_fw);
+		target_socket.register_b_transport(this, &DmaChannel::b_transport);
+		m_qk.reset();
 
 		// register thread processes
 		SC_THREAD(initiator_thread);
 		SC_THREAD(respond_to_command_thread);
 		SC_THREAD(handle_response_thread);
+		SC_THREAD(ring_thread);
 	}
 	void end_of_simulation();
 
+	/// deletes the payloads and the transmit rings
+	~DmaChannel();
+
+	/// sets the RAM addresses of the transmit rings of the channel of a port
+	void init_tx_rings(unsigned int mac);
+
+	/// print the bandwidth achieved in both directions
+	void output_load() const;
+
+	/// number of transfer command writes, a batch counts once
+	unsigned long command_writes() const {
+		return m_command_writes;
+	}
+
+	/// number of descriptor ring transactions: doorbells, write-backs and fetches
+	unsigned long ring_transactions() const {
+		return m_doorbells + m_ring_writebacks + m_ring_fetches;
+	}
+
+	/// write the queued transfer commands to a checkpoint, see save_checkpoint()
+	void save(std::ostream& out);
+
+	/**
+	 * Restores the queued transfer commands, call before the simulation starts.
+	 * @param used_slots - the slots of the restored commands are appended to it
+	 */
+	void restore(std::istream& in, std::vector<soc_address_t>& used_slots);
+
 private:
 	/// initiator thread, starts DMA transfers
 	void initiator_thread(void);
 
+	/// sends a request on the bus and waits for its end
+	void send_request(tlm_generic_payload& payload);
+
+	/// sets the segments of a received packet in its memory slot, see dma_header_split
+	void split_packet(packet_descriptor& d, const IpPacket& packet) const;
+
 	/// this thread sends the response to access transactions from a CPU
 	void respond_to_command_thread(void);
 
@@ -127,6 +226,10 @@ private:
 			tlm_phase& phase, // transaction phase
 			sc_time& time); // elapsed time
 
+	/// a DMI region was revoked by the target
+	void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+		m_dmi.invalidate(start_range, end_range);
+	}
 
 	//==============================================================================
 	// target socket callback
@@ -137,22 +240,112 @@ private:
 			, sc_time &delay_time ///< time taken for transport
 			);
 
+	/// blocking target socket callback, used in loosely_timed mode
+	void b_transport(tlm_generic_payload &gp, sc_time &delay_time);
+
+	/// queues a transfer command written by a CPU, sets the response status
+	void execute_command(tlm_generic_payload &gp);
+
+	/// a CPU wrote the doorbell of its transmit ring, sets the response status
+	void ring_doorbell(tlm_generic_payload &gp);
+
+	/// thread that writes back the received descriptors and fetches the transmit ones
+	void ring_thread(void);
+
+	/// reads or writes n descriptors of m_ring_data from or to a ring, waits for the end
+	void ring_transfer(tlm_command command, soc_address_t address, unsigned int n);
+
 	//==============================================================================
 	// Private member variables and methods
 	//==============================================================================
 private:
 
-	/// payload used for DMA transactions on the system bus
-	tlm_generic_payload payload;
+	/// a DMA transfer of a packet on the system bus, one transaction per segment
+	struct Transaction {
+		/// payloads used on the bus, one per segment of the descriptor
+		tlm_generic_payload payload[packet_descriptor::MAX_SEGMENTS];
+		/// the segments of the packet in the RAM
+		packet_descriptor descriptor;
+		/// number of segments already transferred
+		unsigned int n_finished;
+		/// pointer to the IP packet used in the transaction.
+		/// It points either to a packet from the MAC FIFO (MAC->RAM transfer)
+		/// or to one that is going to be sent (RAM->MAC transfer), 0 if not in flight.
+		IpPacket* packet;
+	};
+
+	/// counts the transferred segment, and hands the packet over when it is complete
+	void segment_finished(Transaction* t, tlm_generic_payload& payload);
+
+	/// all transactions of the channel
+	std::vector<Transaction*> m_transactions;
+
+	/// transactions not in flight
+	std::vector<Transaction*> m_free_transactions;
 
-	/// pointer to the IP packet used in the current transaction.
-	/// It points either to a packet from the MAC FIFO (MAC->RAM transfer)
-	/// or to one that is going to be sent (RAM->MAC transfer).
-	IpPacket* actual_packet_ptr;
+	/// number of RAM->MAC transfers in flight, each needs room in the MAC output FIFO
+	unsigned int m_pending_reads;
+
+	/// packet read from the MAC FIFO that waits for a buffer it fits in, 0 if none. A packet
+	/// larger than the largest buffers is dropped instead.
+	IpPacket* m_waiting_packet;
+
+	/// a received packet can be transferred to a free buffer
+	bool receive_ready() const;
+
+	/// DMI regions of the RAM, used with use_dmi
+	DmiCache m_dmi;
+
+	/// local time of the channel in loosely_timed mode
+	tlm_utils::tlm_quantumkeeper m_qk;
 
 	/// event notified when a transaction finishes, so that the DMA can start a new one
 	sc_event transaction_finished_event;
 
+	// statistics
+	/// bytes written to the RAM (MAC->RAM)
+	unsigned long long m_bytes_written;
+	/// bytes read from the RAM (RAM->MAC)
+	unsigned long long m_bytes_read;
+	/// time with at least one transaction in flight
+	sc_time m_busy_time;
+	/// start of the current busy period
+	sc_time m_busy_since;
+	/// max. number of transactions in flight at the same time
+	unsigned int m_max_in_flight;
+	/// transfer command writes, a batch counts once
+	unsigned long m_command_writes;
+	/// transfer commands received
+	unsigned long m_commands;
+	/// doorbells of the transmit rings
+	unsigned long m_doorbells;
+	/// write-backs to the receive rings
+	unsigned long m_ring_writebacks;
+	/// descriptors written back to the receive rings
+	unsigned long m_ring_descriptors_written;
+	/// reads of the transmit rings
+	unsigned long m_ring_fetches;
+	/// descriptors read from the transmit rings
+	unsigned long m_ring_descriptors_fetched;
+
+	// descriptor rings
+	/// the transmit ring of each processor, array size n_cpus
+	DescriptorRing *m_tx_ring;
+	/// the transmit ring read next, they are served round robin
+	unsigned int m_next_tx_ring;
+	/// descriptors of the received packets not yet written back, per receive queue
+	std::vector<std::vector<packet_descriptor> > m_writeback;
+	/// data of the ring transactions
+	std::vector<packet_descriptor> m_ring_data;
+	/// payload of the ring transactions
+	tlm_generic_payload m_ring_payload;
+	/// the ring transaction is waiting for its response
+	bool m_ring_response_pending;
+	/// notified when the ring transaction got its response
+	sc_event m_ring_response_event;
+	/// notified when a descriptor is to be written back or a doorbell was written
+	sc_event m_ring_work_event;
+
 	tlm_utils::peq_with_get<tlm_generic_payload> m_response_PEQ;
 	/// Event queue for scheduling "free up memory" commands
 	tlm_utils::peq_with_get<tlm_generic_payload> m_command_PEQ;
@@ -164,7 +357,13 @@ private:
 	static const sc_time m_accept_command_delay;
 	static const sc_time m_prepare_packet_descriptor_delay;
 
-	/// queue that holds transfer commands received from CPUs
+	/// depth of the task_queue: the sc_fifo default, or a whole batch if that is larger
+	static int task_queue_depth() {
+		return cpu_descriptor_batch > 16 ? (int) cpu_descriptor_batch : 16;
+	}
+
+	/// Queue that holds transfer commands received from CPUs. A batch of commands is only
+	/// accepted as a whole, so it holds at least cpu_descriptor_batch of them.
 	sc_fifo<packet_descriptor> task_queue;
 
 }; // end of class DmaChannel
@@ -0,0 +1,79 @@
+/**
+ * @file	DmiCache.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "DmiCache.h"
+#include "globaldefs.h"
+#include <cstring>
+
+DmiCache::DmiCache() :
+	m_accesses(0) {
+}
+
+bool DmiCache::transport(tlm_initiator_socket<>& socket, tlm_generic_payload& payload,
+		sc_time& delay) {
+	sc_dt::uint64 address = payload.get_address();
+	unsigned int length = payload.get_data_length();
+	if (length == 0 || payload.get_byte_enable_ptr() != 0) {
+		return false;
+	}
+
+	const Region* region = find(address, length);
+	if (region == 0) {
+		// first access to the address, ask the target
+		Region r;
+		r.dmi.init();
+		r.granted = socket->get_direct_mem_ptr(payload, r.dmi);
+		m_regions.push_back(r);
+		region = find(address, length);
+		if (region == 0) {
+			// the region does not cover the payload, it is no use
+			m_regions.pop_back();
+			return false;
+		}
+	}
+	if (!region->granted) {
+		return false;
+	}
+
+	unsigned char* memory = region->dmi.get_dmi_ptr() + (address
+			- region->dmi.get_start_address());
+	if (payload.is_read() && region->dmi.is_read_allowed()) {
+		memcpy(payload.get_data_ptr(), memory, length);
+		delay += region->dmi.get_read_latency();
+	} else if (payload.is_write() && region->dmi.is_write_allowed()) {
+		memcpy(memory, payload.get_data_ptr(), length);
+		delay += region->dmi.get_write_latency();
+	} else {
+		return false;
+	}
+	// the data phase on the bus
+	delay += CLK_CYCLE_BUS * (length / bus_width + 1);
+
+	payload.set_dmi_allowed(true);
+	payload.set_response_status(TLM_OK_RESPONSE);
+	m_accesses++;
+	return true;
+}
+
+void DmiCache::invalidate(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+	for (unsigned int i = m_regions.size(); i-- > 0;) {
+		if (m_regions[i].dmi.get_start_address() <= end_range
+				&& m_regions[i].dmi.get_end_address() >= start_range) {
+			m_regions.erase(m_regions.begin() + i);
+		}
+	}
+}
+
+const DmiCache::Region* DmiCache::find(sc_dt::uint64 address, unsigned int length) const {
+	for (unsigned int i = 0; i < m_regions.size(); i++) {
+		if (m_regions[i].dmi.get_start_address() <= address
+				&& address + length - 1 <= m_regions[i].dmi.get_end_address()) {
+			return &m_regions[i];
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file	DmiCache.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef DMICACHE_H_
+#define DMICACHE_H_
+
+#include <vector>
+#include <tlm.h>
+
+using namespace sc_core;
+using namespace tlm;
+
+/**
+ * The DMI regions an initiator got through its socket, and the transport of
+ * payloads through them.
+ *
+ * A payload is copied directly from or to the memory of the target if its
+ * address range is in a region granted for its command. The first access to an
+ * address asks the target for a region, a denied one is remembered as well, so
+ * that e.g. the registers of the DMA are not asked again on every access.
+ *
+ * Instead of the time the transaction would take, the access latency of the region
+ * and the data cycles of an uncontended bus are added to a timing annotation, which
+ * the initiator waits when it synchronizes. Bus contention is not modelled.
+ */
+class DmiCache {
+public:
+	DmiCache();
+
+	/**
+	 * Transfers the data of the payload through DMI if possible.
+	 * @param socket - the initiator socket to ask for a DMI region
+	 * @param payload - read or write, without byte enables
+	 * @param delay - the timing annotation, the time of the access is added to it
+	 * @retval true - the data is transferred, the response status is set
+	 * @retval false - no DMI for the payload, it has to be sent as a transaction
+	 */
+	bool transport(tlm_initiator_socket<>& socket, tlm_generic_payload& payload,
+			sc_time& delay);
+
+	/// forgets the regions that overlap the range, call from invalidate_direct_mem_ptr
+	void invalidate(sc_dt::uint64 start_range, sc_dt::uint64 end_range);
+
+	/// number of payloads transferred through DMI
+	unsigned long accesses() const {
+		return m_accesses;
+	}
+
+private:
+	struct Region {
+		tlm_dmi dmi;
+		bool granted;
+	};
+
+	/// the region that contains the address range, 0 if none
+	const Region* find(sc_dt::uint64 address, unsigned int length) const;
+
+	std::vector<Region> m_regions;
+	unsigned long m_accesses;
+};
+
+#endif /* DMICACHE_H_ */
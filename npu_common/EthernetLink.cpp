@@ -41,23 +41,22 @@ void EthernetLink::reader_thread() {
 		bits += interframe_gap_bits;
 		sc_time wait_time = bits * time_per_bit;
 
-		// push the packet into the management queue, so that it is later reused
-		ip_packet_queue->push(packet);
-
 		// statistics
 		// packet count
 		n_packets_sent++;	// global counter
 		packets_delivered++;// local counter
 		// latency
-		sc_time latency = sc_time_stamp() - packet->received;
+		sc_time latency = simulation_time() - packet->received;
 		total_latency += latency;
 		if (latency < min_latency)
 			min_latency = latency;
 		if (latency > max_latency)
 			max_latency = latency;
 
-		// Call wait after latency was computed - otherwise packet->received
-		// might be overwritten by the time it is read.
+		// return the packet to the pool, so that it is later reused
+		PacketPool::release(packet);
+
+		// Call wait after the packet was released, it is not needed any more.
 		wait(wait_time);
 		m_total_transfer_time += wait_time;
 	}
@@ -9,8 +9,7 @@
 #define ETHERNETLINK_H_
 
 #include <systemc>
-#include <queue>
-#include "IpPacket.h"
+#include "PacketPool.h"
 #include "globaldefs.h"
 using namespace sc_core;
 
@@ -36,8 +35,8 @@ public:
 	/// port accessing the MAC output FIFO
 	sc_port<sc_fifo_in_if<IpPacket *> > in_port;
 
-	/// pointer to a packet management queue
-	std::queue<IpPacket *> *ip_packet_queue;
+	/// pool the sent packets are returned to
+	PacketPool *packet_pool;
 private:
 	unsigned int packets_delivered;
 
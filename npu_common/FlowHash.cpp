@@ -0,0 +1,64 @@
+/**
+ * @file	FlowHash.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "FlowHash.h"
+#include "globaldefs.h"
+
+/// the default RSS key of the NIC drivers
+static const unsigned char rss_key[40] = { 0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+		0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b,
+		0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b,
+		0xbe, 0xac, 0x01, 0xfa };
+
+/// IP protocol numbers with ports
+static const unsigned char PROTOCOL_TCP = 6;
+static const unsigned char PROTOCOL_UDP = 17;
+
+unsigned int toeplitz_hash(const unsigned char* key, const unsigned char* input,
+		unsigned int length) {
+	unsigned int hash = 0;
+	// the 32 bits of the key at the current input bit
+	unsigned int window = (key[0] << 24) | (key[1] << 16) | (key[2] << 8) | key[3];
+	for (unsigned int i = 0; i < length; i++) {
+		for (int bit = 7; bit >= 0; bit--) {
+			if (input[i] & (1 << bit)) {
+				hash ^= window;
+			}
+			window = (window << 1) | ((key[i + 4] >> bit) & 1);
+		}
+	}
+	return hash;
+}
+
+unsigned int flow_hash(const IpPacket& packet) {
+	if (packet.data_size < IpPacket::MINIMAL_IP_HEADER_LENGTH
+			|| packet.getHeaderLength() < 5) {
+		// not a valid IPv4 header, the addresses would be read past the data
+		return 0;
+	}
+	// source and destination address, then the ports, in network byte order
+	unsigned char input[12];
+	unsigned int length = 8;
+	for (unsigned int i = 0; i < 8; i++) {
+		input[i] = packet[12 + i];
+	}
+	unsigned int ports = packet.getHeaderLength() * 4;
+	unsigned char protocol = packet.getProtocol();
+	if ((protocol == PROTOCOL_TCP || protocol == PROTOCOL_UDP) && ports + 4
+			<= packet.data_size) {
+		for (unsigned int i = 0; i < 4; i++) {
+			input[8 + i] = packet[ports + i];
+		}
+		length = 12;
+	}
+	return toeplitz_hash(rss_key, input, length);
+}
+
+unsigned int rx_queue_of_hash(unsigned int hash) {
+	// the low bits index the indirection table of RSS, filled round robin
+	return (hash & 0x7f) % n_rx_queues;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file	FlowHash.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef FLOWHASH_H_
+#define FLOWHASH_H_
+
+#include "IpPacket.h"
+
+/**
+ * Toeplitz hash of the input with the key, as computed by receive side scaling (RSS)
+ * NICs. The key must be at least 4 bytes longer than the input.
+ */
+unsigned int toeplitz_hash(const unsigned char* key, const unsigned char* input,
+		unsigned int length);
+
+/**
+ * RSS hash of the flow of an IPv4 packet with the usual 40 byte key: the source and
+ * destination address, and for TCP and UDP the source and destination port. The
+ * protocol selects the input, like in RSS, so the packets of a flow get the same hash.
+ * A packet without a valid IPv4 header gets hash 0, so it goes to receive queue 0, and
+ * the processor drops it.
+ */
+unsigned int flow_hash(const IpPacket& packet);
+
+/// the receive queue of a flow hash, 0 .. n_rx_queues - 1
+unsigned int rx_queue_of_hash(unsigned int hash);
+
+#endif /* FLOWHASH_H_ */
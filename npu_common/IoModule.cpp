@@ -7,8 +7,8 @@
 
 #include "IoModule.h"                           // Top traffic generator & initiator
 #include "PcapImporter.h"
+#include <sstream>
 #include "reporting.h"                          // reporting macro helpers
-static const char *filename = "IoModule.cpp";	///< filename for reporting
 
 
 //-----------------------------------------------------------------
@@ -16,122 +16,118 @@ static const char *filename = "IoModule.cpp";	///< filename for reporting
 //-----------------------------------------------------------------
 IoModule::IoModule(sc_core::sc_module_name name) :
 	sc_module(name),
-		memory_manager("memory_manager"),
-		dma_ch_0("dma_ch0"),
-		dma_ch_1("dma_ch1"),
-		dma_ch_2("dma_ch2"),
-		dma_ch_3("dma_ch3"),
-		importer_0("eth0_in", pcapFile0),
-		importer_1("eth1_in", pcapFile1),
-		importer_2("eth2_in", pcapFile2),
-		importer_3("eth3_in", pcapFile3),
-		link_0("eth0_out"),
-		link_1("eth1_out"),
-		link_2("eth2_out"),
-		link_3("eth3_out"){
-
-	// fill up packet queue
-	for (unsigned int i = 0; i < 100; i++) {
-		IpPacket* p = new IpPacket();
-		packet_queue.push(p);
+		memory_manager("memory_manager"){
+
+	// the sample files are used if no file was given
+	static const char* default_files[] = { pcapFile0, pcapFile1, pcapFile2, pcapFile3 };
+
+	for (unsigned int i = 0; i < nMacs; i++) {
+		std::ostringstream dma_name, in_name, out_name;
+		dma_name << "dma_ch" << i;
+		in_name << "eth" << i << "_in";
+		out_name << "eth" << i << "_out";
+		const char* file = pcap_files.empty() ? default_files[i % 4]
+				: pcap_files[i % pcap_files.size()].c_str();
+
+		dma_ch.push_back(new DmaChannel(dma_name.str().c_str()));
+		importer.push_back(new PcapImporter(in_name.str().c_str(), file, cache_pcap_index));
+		link.push_back(new EthernetLink(out_name.str().c_str()));
+		mac_in_fifo.push_back(new sc_fifo<IpPacket *>());
+		mac_out_fifo.push_back(new sc_fifo<IpPacket *>());
+
+		//--------------------------------------------------------------
+		// bind FIFOs
+		//--------------------------------------------------------------
+		// Bind ports to the rx fifo between the DMA channel and importer
+		importer[i]->out_port(*mac_in_fifo[i]);
+		dma_ch[i]->mac_in_port(*mac_in_fifo[i]);
+
+		// Bind ports to the tx fifo between the DMA channel and link
+		dma_ch[i]->mac_out_port(*mac_out_fifo[i]);
+		link[i]->in_port(*mac_out_fifo[i]);
+
+		// bind pointers to free address registry in memory_manager
+		dma_ch[i]->free_memory_addresses = &memory_manager.free_memory_addresses;
+		dma_ch[i]->packetQueue = memory_manager.packet_queue;
+		dma_ch[i]->rxRing = memory_manager.rx_ring;
+		dma_ch[i]->init_tx_rings(i);
+
+		// bind all to packet_pool
+		importer[i]->packet_pool = &packet_pool;
+		dma_ch[i]->packet_pool = &packet_pool;
+		link[i]->packet_pool = &packet_pool;
 	}
-	//--------------------------------------------------------------
-	// bind FIFOs
-	//--------------------------------------------------------------
-	// Bind ports to mac0_in_fifo between dma_ch_0 and importer
-	importer_0.out_port(mac0_in_fifo);
-	dma_ch_0.mac_in_port(mac0_in_fifo);
-
-	// Bind ports to mac0_out_fifo between dma_ch_0 and link
-	dma_ch_0.mac_out_port(mac0_out_fifo);
-	link_0.in_port(mac0_out_fifo);
-
-	// Bind ports to mac1_in_fifo between dma_ch_1 and importer
-	importer_1.out_port(mac1_in_fifo);
-	dma_ch_1.mac_in_port(mac1_in_fifo);
-
-	// Bind ports to mac1_out_fifo between dma_ch_1 and link
-	dma_ch_1.mac_out_port(mac1_out_fifo);
-	link_1.in_port(mac1_out_fifo);
-
-	// Bind ports to mac2_in_fifo between dma_ch_2 and importer
-	importer_2.out_port(mac2_in_fifo);
-	dma_ch_2.mac_in_port(mac2_in_fifo);
-
-	// Bind ports to mac2_out_fifo between dma_ch_2 and link
-	dma_ch_2.mac_out_port(mac2_out_fifo);
-	link_2.in_port(mac2_out_fifo);
-
-	// Bind ports to mac3_in_fifo between dma_ch_3 and importer
-	importer_3.out_port(mac3_in_fifo);
-	dma_ch_3.mac_in_port(mac3_in_fifo);
-
-	// Bind ports to mac3_out_fifo between dma_ch_3 and link
-	dma_ch_3.mac_out_port(mac3_out_fifo);
-	link_3.in_port(mac3_out_fifo);
 
 	//---------------------------------------------------------
 	// other connections
 	//---------------------------------------------------------
 
-	// Bind IRQ port of submodule to IoModule IRQ port
-	memory_manager.new_packet_IT(dma_irq);
-
-	// bind pointers to free address registry in memory_manager
-	dma_ch_0.free_memory_addresses = &memory_manager.free_memory_addresses;
-	dma_ch_1.free_memory_addresses = &memory_manager.free_memory_addresses;
-	dma_ch_2.free_memory_addresses = &memory_manager.free_memory_addresses;
-	dma_ch_3.free_memory_addresses = &memory_manager.free_memory_addresses;
-	dma_ch_0.packetQueue = &memory_manager.packet_queue;
-	dma_ch_1.packetQueue = &memory_manager.packet_queue;
-	dma_ch_2.packetQueue = &memory_manager.packet_queue;
-	dma_ch_3.packetQueue = &memory_manager.packet_queue;
-	// bind all to packet_queue
-	importer_0.unused_packets_queue = &packet_queue;
-	importer_1.unused_packets_queue = &packet_queue;
-	importer_2.unused_packets_queue = &packet_queue;
-	importer_3.unused_packets_queue = &packet_queue;
-	dma_ch_0.ip_packet_buffer = &packet_queue;
-	dma_ch_1.ip_packet_buffer = &packet_queue;
-	dma_ch_2.ip_packet_buffer = &packet_queue;
-	dma_ch_3.ip_packet_buffer = &packet_queue;
-	link_0.ip_packet_queue = &packet_queue;
-	link_1.ip_packet_queue = &packet_queue;
-	link_2.ip_packet_queue = &packet_queue;
-	link_3.ip_packet_queue = &packet_queue;
+	// Bind IRQ ports of submodule to IoModule IRQ ports
+	dma_irq = new sc_out<bool>[n_rx_queues];
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		memory_manager.new_packet_IT[i](dma_irq[i]);
+	}
 }
 
 //-----------------------------------------------------------------
 // destructor
 //-----------------------------------------------------------------
 IoModule::~IoModule() {
+	// the packets in the FIFOs are freed by packet_pool
+	for (unsigned int i = 0; i < dma_ch.size(); i++) {
+		delete dma_ch[i];
+		delete importer[i];
+		delete link[i];
+		delete mac_in_fifo[i];
+		delete mac_out_fifo[i];
+	}
+	delete[] dma_irq;
+}
 
-	IpPacket * p; // pointer to packets that are deleted
-
-	// free all packets in the queue
-	while (packet_queue.empty() == false) {
-		p = packet_queue.front();
-		packet_queue.pop();
-		delete p;
+void IoModule::save(std::ostream& out) {
+	memory_manager.save(out);
+	for (unsigned int i = 0; i < dma_ch.size(); i++) {
+		dma_ch[i]->save(out);
+		importer[i]->save(out);
 	}
+}
 
-	// and the FIFOs
-	while (mac0_in_fifo.nb_read(p)) {
-		delete p;
+void IoModule::output_descriptor_statistics() const {
+	memory_manager.output_load();
+	unsigned long n_transactions = memory_manager.descriptor_transactions();
+	for (unsigned int i = 0; i < dma_ch.size(); i++) {
+		n_transactions += dma_ch[i]->command_writes() + dma_ch[i]->ring_transactions();
+	}
+	std::cout << name() << " descriptor transactions: " << n_transactions << ", "
+			<< (n_packets_sent > 0 ? (double) n_transactions / n_packets_sent : 0.0)
+			<< " per packet sent" << std::endl;
+	if (descriptor_rings) {
+		std::cout << name() << " (the writes of the transmit rings by the processors are "
+				<< "not included)" << std::endl;
 	}
-	while (mac0_out_fifo.nb_read(p)) {
-		delete p;
+}
+
+unsigned int IoModule::restore(std::istream& in) {
+	// slots referenced by a restored queue, the rest is freed
+	std::vector<soc_address_t> used_slots;
+	memory_manager.restore(in, used_slots);
+	for (unsigned int i = 0; i < dma_ch.size(); i++) {
+		dma_ch[i]->restore(in, used_slots);
+		importer[i]->restore(in);
 	}
+	return memory_manager.free_unused_slots(used_slots);
 }
 
 void IoModule::output_load() const {
-	importer_0.output_load();
-	importer_1.output_load();
-	importer_2.output_load();
-	importer_3.output_load();
-
-	link_0.output_load();
-	link_1.output_load();
-	link_2.output_load();
-	link_3.output_load();
+	for (unsigned int i = 0; i < importer.size(); i++) {
+		importer[i]->output_load();
+	}
+	for (unsigned int i = 0; i < link.size(); i++) {
+		link[i]->output_load();
+	}
+	for (unsigned int i = 0; i < dma_ch.size(); i++) {
+		dma_ch[i]->output_load();
+	}
+
+	packet_pool.output_statistics(name());
 }
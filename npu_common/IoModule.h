@@ -2,11 +2,13 @@
 #define __IO_MODULE_H__
 
 #include <tlm.h>
-#include <queue>
+#include <vector>
+#include <iostream>
 #include "DmaChannel.h"
 #include "PcapImporter.h"
 #include "EthernetLink.h"
 #include "MemoryManager.h"
+#include "PacketPool.h"
 
 using namespace sc_core;
 using namespace tlm;
@@ -15,15 +17,19 @@ using namespace tlm;
  * @class IoModule
  *
  * IO module of the SoC.
- * It contains 4 MAC units and one dedicated DMA channel for each. Its memory_manager
+ * It contains nMacs MAC units and one dedicated DMA channel for each. Its memory_manager
  * submodule keeps track of which memory slots are free in the RAM, and the DMA channels
  * can only take received packets from the MAC receive queue if there is free RAM space
  * for them.
  *
  * Also, the model of the Ethernet connections is included in this module. The received packets
- * are sent by a PcapImporter module (importer_0 through importer_3), the outbound packets are
+ * are sent by a PcapImporter module per port, the outbound packets are
  * passed on to the EthernetLink modules by the transmit FIFOs.
  *
+ * The number of ports is nMacs at construction, see init_address_map(). Port i replays
+ * the PCAP file pcap_files[i], the list is repeated if it is shorter than the number of
+ * ports.
+ *
  * @note In this model each DMA channel has an own bus socket. This was done for convenience
  * of programming, a real HW implementation would most probably not contain separate driver
  * circuitry, because if a bus is used as an interconnect (and not, for example, a crossbar)
@@ -31,8 +37,9 @@ using namespace tlm;
  */
 SC_MODULE(IoModule){
 public:
-	/// interrupt to signal when a new packet is received by any of the MAC subunits
-	sc_out<bool> dma_irq;
+	/// Interrupts to signal when a new packet is received by any of the MAC subunits, one per
+	/// receive queue of the memory_manager. Array size is n_rx_queues.
+	sc_out<bool> *dma_irq;
 
 
 	// *******===============================================================******* //
@@ -41,46 +48,46 @@ public:
 	/// central administrative part, keeps track of memory slot allocation
 	MemoryManager memory_manager;
 
-	// four DMA channels, each responsible for reading from and writing to an Ethernet MAC FIFO
-	DmaChannel dma_ch_0;
-	DmaChannel dma_ch_1;
-	DmaChannel dma_ch_2;
-	DmaChannel dma_ch_3;
+	/// DMA channels, one per port, each responsible for reading from and writing to
+	/// an Ethernet MAC FIFO
+	std::vector<DmaChannel *> dma_ch;
 
 private:
 
-	sc_fifo<IpPacket *> mac0_in_fifo; ///< rx fifo of MAC 0
-	sc_fifo<IpPacket *> mac0_out_fifo; ///< tx fifo of MAC 0
-	sc_fifo<IpPacket *> mac1_in_fifo; ///< rx fifo of MAC 1
-	sc_fifo<IpPacket *> mac1_out_fifo; ///< tx fifo of MAC 1
-	sc_fifo<IpPacket *> mac2_in_fifo; ///< rx fifo of MAC 2
-	sc_fifo<IpPacket *> mac2_out_fifo; ///< tx fifo of MAC 2
-	sc_fifo<IpPacket *> mac3_in_fifo; ///< rx fifo of MAC 3
-	sc_fifo<IpPacket *> mac3_out_fifo; ///< tx fifo of MAC 3
+	std::vector<sc_fifo<IpPacket *> *> mac_in_fifo; ///< rx fifos of the MACs
+	std::vector<sc_fifo<IpPacket *> *> mac_out_fifo; ///< tx fifos of the MACs
 
 	bool m_enable_target_tracking; ///< track target timing
 
-	// Wrapper modules to read data from PCAP dump files
-	PcapImporter importer_0;
-	PcapImporter importer_1;
-	PcapImporter importer_2;
-	PcapImporter importer_3;
+	/// Wrapper modules to read data from PCAP dump files, one per port
+	std::vector<PcapImporter *> importer;
 
-	// Ethernet lines
-	EthernetLink link_0;
-	EthernetLink link_1;
-	EthernetLink link_2;
-	EthernetLink link_3;
+	/// Ethernet lines, one per port
+	std::vector<EthernetLink *> link;
 
-	/// Manager for IpPacket objects.
+	/// Manager for IpPacket objects, shared by the importers, DMA channels and links.
 	/// @note Used to speed up simulation, not intended to model any HW.
-	std::queue<IpPacket *> packet_queue;
+	PacketPool packet_pool;
 
 	// *******===============================================================******* //
 	// *******                           member function                     ******* //
 	// *******===============================================================******* //
 public:
 	void output_load() const;
+
+	/// print the descriptor transactions of the memory manager and the DMA channels,
+	/// including the descriptor rings, per packet sent
+	void output_descriptor_statistics() const;
+
+	/// write the state of the submodules to a checkpoint, see save_checkpoint()
+	void save(std::ostream& out);
+
+	/**
+	 * Restores the state of the submodules, call before the simulation starts.
+	 * @return the number of memory slots freed, those of the packets in flight at the
+	 * 			checkpoint
+	 */
+	unsigned int restore(std::istream& in);
 	// *******===============================================================******* //
 	// *******                             constructor                       ******* //
 	// *******===============================================================******* //
@@ -92,11 +99,7 @@ public:
 	 */
 	SC_CTOR(IoModule);
 
-	/**
-	 * User defined destructor.
-	 *
-	 * Override default to free memory allocated to dynamically created IpPacket objects
-	 */
+	/// deletes the per-port submodules and FIFOs
 	~IoModule();
 
 };
@@ -21,8 +21,13 @@ using namespace sc_core;
  * 		than the size of meaningful data starting at the address of an IpPacket object.
  * 		The latter can be computed by<br>
  * 			sizeof(unsigned int) + sizeof(sc_time) + data_size
- * - received: The time when the packet was received at the receive MAC FIFO.
+ * - received: The time when the packet was received at the receive MAC FIFO
+ * 		(simulation_time(), so that it stays valid across a restored checkpoint).
  * 		Used for latency statistics.
+ *
+ * A stand-alone IpPacket (e.g. the header copy of a processor) only has room for the
+ * IP header. Whole packets are allocated by a PacketPool, in buffers where packet_data
+ * continues past the end of the object up to the capacity of the buffer.
  */
 class IpPacket {
 public:
@@ -37,6 +42,15 @@ public:
 
 	static const unsigned int MINIMAL_IP_HEADER_LENGTH = 20;
 
+	/// maximal length of an IPv4 header in bytes (15 32-bit words)
+	static const unsigned int MAX_IP_HEADER_LENGTH = 60;
+
+	/// offset of packet_data in the memory image of a packet
+	static const unsigned int DATA_OFFSET = sizeof(uint64_t) + sizeof(sc_time);
+
+	/// max. data_size, so that the memory image of a packet fits into PACKET_MAX_SIZE bytes
+	static const unsigned int MAX_DATA_SIZE = PACKET_MAX_SIZE - DATA_OFFSET;
+
 	//
 	// member variables
 	//
@@ -49,8 +63,9 @@ public:
 	/// time of reception
 	sc_time received;
 
-	/// pointer to the packet data (actually an array)
-	unsigned char packet_data[PACKET_MAX_SIZE];
+	/// the packet data, it has to be the last member.
+	/// @note Only the header fits into the object itself, see class description.
+	unsigned char packet_data[MAX_IP_HEADER_LENGTH];
 
 	//
 	// interface methods
@@ -7,7 +7,9 @@
 
 #include "MemoryManager.h"
 #include <iostream>
+#include <algorithm>
 #include "reporting.h"
+#include "Checkpoint.h"
 
 static const char *filename = "MemoryManager.cpp"; ///< filename for reporting
 
@@ -15,26 +17,98 @@ static const char *filename = "MemoryManager.cpp"; ///< filename for reporting
 // constructor
 //---------------------------------------------------------------
 MemoryManager::MemoryManager(sc_module_name name) :
-	sc_module(name), m_command_PEQ("command_PEQ") {
+	sc_module(name), m_command_PEQ("command_PEQ"), m_restored(false), m_discard_writes(0),
+			m_descriptors_discarded(0) {
 
 	// register callback
 	target_socket.register_nb_transport_fw(this,&MemoryManager::nb_transport_fw);
-	// fill free slots queue with all the addresses
-	for (unsigned int i = 0; i < n_memory_slots; i++) {
-		free_memory_addresses.nb_write(MEMORY_BASE_ADDRESS + i
-				* IpPacket::PACKET_MAX_SIZE);
-	}
+	target_socket.register_b_transport(this,&MemoryManager::b_transport);
 
 	m_accept_command_delay = CLK_CYCLE_BUS;
 	m_read_packet_descriptor_delay = CLK_CYCLE_BUS;
 
+	// a receive queue and an interrupt line per queue
+	new_packet_IT = new sc_out<bool>[n_rx_queues];
+	packet_queue = new sc_fifo<packet_descriptor>*[n_rx_queues];
+	rx_ring = new DescriptorRing[n_rx_queues];
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		packet_queue[i] = new sc_fifo<packet_descriptor>(n_packet_buffers());
+		rx_ring[i].init(rx_ring_address(i));
+	}
+	m_irq_timer = new sc_event[n_rx_queues];
+	m_irq_enabled.assign(n_rx_queues, true);
+	m_irq_level.assign(n_rx_queues, false);
+	m_irq_waiting_since.assign(n_rx_queues, SC_ZERO_TIME);
+	m_irq_waiting.assign(n_rx_queues, false);
+	m_interrupts.assign(n_rx_queues, 0);
+	m_read_transactions.assign(n_rx_queues, 0);
+	m_descriptors_read.assign(n_rx_queues, 0);
+	m_empty_reads.assign(n_rx_queues, 0);
+
 	// register processes
 	SC_THREAD(respond_to_command_thread);
 	SC_METHOD(interrupt_port_method);
-	// IT signal is modified if packet_queue is read or written.
-	sensitive << packet_queue.data_read_event()
-			<< packet_queue.data_written_event();
+	// IT signals are modified if a packet_queue is read or written, a moderation timer
+	// expires or an interrupt is enabled or disabled.
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		sensitive << packet_queue[i]->data_read_event()
+				<< packet_queue[i]->data_written_event() << rx_ring[i].changed_event()
+				<< m_irq_timer[i];
+	}
+	sensitive << m_irq_control_event;
+
+}
+
+MemoryManager::~MemoryManager() {
+	delete[] new_packet_IT;
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		delete packet_queue[i];
+	}
+	delete[] packet_queue;
+	delete[] rx_ring;
+	delete[] m_irq_timer;
+}
+
+//---------------------------------------------------------------
+// initial state, or the one restored from a checkpoint
+//---------------------------------------------------------------
+void MemoryManager::start_of_simulation() {
+	if (m_restored) {
+		return;
+	}
+	// fill free slots queue with all the addresses
+	free_memory_addresses.fill();
+}
+
+void MemoryManager::save(std::ostream& out) {
+	free_memory_addresses.save(out);
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		checkpoint::write_fifo(out, *packet_queue[i]);
+	}
+}
 
+void MemoryManager::restore(std::istream& in, std::vector<soc_address_t>& used_slots) {
+	m_restored = true;
+	free_memory_addresses.restore(in, used_slots);
+	std::vector<packet_descriptor> queued;
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		checkpoint::read_fifo(in, *packet_queue[i], &queued);
+	}
+	for (unsigned int i = 0; i < queued.size(); i++) {
+		used_slots.push_back(queued[i].baseAddress);
+	}
+}
+
+unsigned int MemoryManager::free_unused_slots(const std::vector<soc_address_t>& used_slots) {
+	unsigned int n_freed = 0;
+	for (unsigned int i = 0; i < n_packet_buffers(); i++) {
+		soc_address_t slot = packet_buffer_address(i);
+		if (std::find(used_slots.begin(), used_slots.end(), slot) == used_slots.end()) {
+			free_memory_addresses.release(slot);
+			n_freed++;
+		}
+	}
+	return n_freed;
 }
 
 //----------------------------------------------------------
@@ -47,8 +121,10 @@ tlm_sync_enum MemoryManager::nb_transport_fw(tlm_generic_payload &payload,
 	switch (phase) {
 	//=============================================================================
 	case BEGIN_REQ: {
-		// make as sure as possible that the data sent is a PacketDescriptor
-		assert(payload.get_data_length() == sizeof(packet_descriptor));
+		// make as sure as possible that the data sent is a PacketDescriptor or a batch of them
+		assert(is_descriptor_length(payload.get_data_length())
+				|| payload.get_data_length() == sizeof(ring_claim)
+				|| payload.get_address() >= RX_IRQ_CONTROL_OFFSET);
 
 		if (payload.is_write()) {
 			//-----------------------------------------------------------------------------
@@ -97,9 +173,6 @@ void MemoryManager::respond_to_command_thread() {
 	// payload pointer, it is set when reading from the payload event queue
 	tlm_generic_payload *payload_ptr;
 
-	// a pointer to the data of the payload, casted to represent a packet descriptor
-	packet_descriptor * descriptor_ptr;
-
 	// loop until simulation terminates
 	while (true) {
 		// wait until a new command was received
@@ -111,32 +184,7 @@ void MemoryManager::respond_to_command_thread() {
 		// just to make sure.
 		while ((payload_ptr = m_command_PEQ.get_next_transaction()) != 0) {
 
-			descriptor_ptr
-					= reinterpret_cast<packet_descriptor*> (payload_ptr->get_data_ptr());
-
-			if (payload_ptr->is_write()) {
-				// a write command, drop a packet and free RAM slot
-				free_memory_addresses.nb_write(descriptor_ptr->baseAddress);
-
-				payload_ptr->set_response_status(TLM_OK_RESPONSE);
-				REPORT_INFO(filename, __FUNCTION__, "DMA accepted drop command");
-				n_packets_dropped_header++;
-			}// end WRITE
-			else if (payload_ptr->is_read()) {
-				// CPU wants descriptor of new packet, containing base address in RAM and size
-				if (packet_queue.nb_read(*descriptor_ptr)) {
-					payload_ptr->set_response_status(TLM_OK_RESPONSE);
-					REPORT_INFO(filename, __FUNCTION__, "DMA supplied packet descriptor.");
-				} else {
-					// no packet found, probably because another processor was quicker
-					payload_ptr->set_response_status(TLM_GENERIC_ERROR_RESPONSE);
-					REPORT_INFO(filename, __FUNCTION__, "DMA could not supply packet descriptor.");
-				}
-			}// end READ
-			else {
-				payload_ptr->set_response_status(TLM_COMMAND_ERROR_RESPONSE);
-				REPORT_ERROR(filename, __FUNCTION__, "DMA received payload with neither read, nor write command.");
-			}
+			execute_command(*payload_ptr);
 
 			// call backward path
 			// Create phase and delay time objects
@@ -166,11 +214,183 @@ void MemoryManager::respond_to_command_thread() {
 	}
 }
 
+//---------------------------------------------------------------
+// blocking transport, the command is executed at once
+//---------------------------------------------------------------
+void MemoryManager::b_transport(tlm_generic_payload &payload, sc_time &delay_time) {
+	// make as sure as possible that the data sent is a PacketDescriptor or a batch of them
+	assert(is_descriptor_length(payload.get_data_length())
+			|| payload.get_data_length() == sizeof(ring_claim)
+			|| payload.get_address() >= RX_IRQ_CONTROL_OFFSET);
+
+	delay_time += payload.is_write() ? m_accept_command_delay : m_read_packet_descriptor_delay;
+	execute_command(payload);
+}
+
+void MemoryManager::execute_command(tlm_generic_payload &payload) {
+	// the data of the payload, casted to represent a packet descriptor
+	packet_descriptor* descriptor_ptr
+			= reinterpret_cast<packet_descriptor*> (payload.get_data_ptr());
+	// number of descriptors of a batch, 0 for a single descriptor
+	unsigned int capacity = descriptor_batch_capacity(payload.get_data_length());
+
+	if (payload.get_address() >= RX_IRQ_CONTROL_OFFSET) {
+		set_interrupt_enable(payload);
+		return;
+	}
+
+	if (payload.is_write()) {
+		// a write command, drop packets and free RAM slots
+		unsigned int n = 1;
+		if (capacity > 0) {
+			n = descriptor_batch_count(payload.get_data_ptr());
+			descriptor_ptr = descriptor_batch_entries(payload.get_data_ptr());
+			if (n > capacity) {
+				payload.set_response_status(TLM_GENERIC_ERROR_RESPONSE);
+				REPORT_ERROR(filename, __FUNCTION__, "drop command with more descriptors than its size.");
+				return;
+			}
+		}
+		for (unsigned int i = 0; i < n; i++) {
+			free_memory_addresses.release(descriptor_ptr[i].baseAddress);
+		}
+
+		payload.set_response_status(TLM_OK_RESPONSE);
+		REPORT_INFO(filename, __FUNCTION__, "DMA accepted drop command");
+		n_packets_dropped_header += n;
+		m_discard_writes++;
+		m_descriptors_discarded += n;
+	}// end WRITE
+	else if (payload.is_read()) {
+		// CPU wants descriptor of new packet, containing base address in RAM and size;
+		// the address selects the receive queue, see rx_queue_address()
+		unsigned int queue = payload.get_address() / sizeof(packet_descriptor);
+		if (queue >= n_rx_queues) {
+			payload.set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
+			REPORT_ERROR(filename, __FUNCTION__, "CPU read a receive queue that does not exist.");
+			return;
+		}
+		m_read_transactions[queue]++;
+
+		if (descriptor_rings) {
+			claim_ring_entries(payload, queue);
+		} else if (capacity > 0) {
+			// a batch, as many descriptors as there are, up to its capacity
+			packet_descriptor* entries = descriptor_batch_entries(payload.get_data_ptr());
+			unsigned int n = 0;
+			while (n < capacity && packet_queue[queue]->nb_read(entries[n])) {
+				n++;
+			}
+			descriptor_batch_count(payload.get_data_ptr()) = n;
+			payload.set_response_status(TLM_OK_RESPONSE);
+			m_descriptors_read[queue] += n;
+			if (n == 0) {
+				m_empty_reads[queue]++;
+			}
+			REPORT_INFO(filename, __FUNCTION__, "DMA supplied a batch of packet descriptors.");
+		} else if (packet_queue[queue]->nb_read(*descriptor_ptr)) {
+			payload.set_response_status(TLM_OK_RESPONSE);
+			m_descriptors_read[queue]++;
+			REPORT_INFO(filename, __FUNCTION__, "DMA supplied packet descriptor.");
+		} else {
+			// no packet found, probably because another processor was quicker
+			payload.set_response_status(TLM_GENERIC_ERROR_RESPONSE);
+			m_empty_reads[queue]++;
+			REPORT_INFO(filename, __FUNCTION__, "DMA could not supply packet descriptor.");
+		}
+	}// end READ
+	else {
+		payload.set_response_status(TLM_COMMAND_ERROR_RESPONSE);
+		REPORT_ERROR(filename, __FUNCTION__, "DMA received payload with neither read, nor write command.");
+	}
+}
+
+void MemoryManager::claim_ring_entries(tlm_generic_payload &payload, unsigned int queue) {
+	if (payload.get_data_length() != sizeof(ring_claim)) {
+		payload.set_response_status(TLM_BURST_ERROR_RESPONSE);
+		REPORT_ERROR(filename, __FUNCTION__, "receive queue read with descriptor rings is not a ring claim.");
+		return;
+	}
+	ring_claim* claim = reinterpret_cast<ring_claim*> (payload.get_data_ptr());
+	unsigned int first = rx_ring[queue].consume(claim->count);
+	claim->address = rx_ring[queue].entry_address(first);
+	payload.set_response_status(TLM_OK_RESPONSE);
+	m_descriptors_read[queue] += claim->count;
+	if (claim->count == 0) {
+		m_empty_reads[queue]++;
+	}
+	REPORT_INFO(filename, __FUNCTION__, "DMA supplied receive ring entries.");
+}
+
+unsigned int MemoryManager::packets_waiting(unsigned int queue) const {
+	return descriptor_rings ? rx_ring[queue].available() : packet_queue[queue]->num_available();
+}
+
+void MemoryManager::set_interrupt_enable(tlm_generic_payload &payload) {
+	unsigned int queue = (payload.get_address() - RX_IRQ_CONTROL_OFFSET) / sizeof(unsigned int);
+	if (!payload.is_write() || payload.get_data_length() != sizeof(unsigned int)
+			|| queue >= n_rx_queues) {
+		payload.set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
+		REPORT_ERROR(filename, __FUNCTION__, "invalid access of an interrupt enable register.");
+		return;
+	}
+	m_irq_enabled[queue] = *reinterpret_cast<unsigned int*> (payload.get_data_ptr()) != 0;
+	m_irq_control_event.notify(SC_ZERO_TIME);
+	payload.set_response_status(TLM_OK_RESPONSE);
+}
+
 void MemoryManager::interrupt_port_method() {
-	if (packet_queue.num_available() > 0) {
-		new_packet_IT.write(true);
-	} else {
-		new_packet_IT.write(false);
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		unsigned int waiting = packets_waiting(i);
+		if (!m_irq_enabled[i] || waiting == 0) {
+			// masked for polling, or nothing to do
+			m_irq_level[i] = false;
+			m_irq_waiting[i] = false;
+			m_irq_timer[i].cancel();
+		} else if (!m_irq_level[i]) {
+			// moderation: wait for enough packets, or for the time of the first one
+			if (!m_irq_waiting[i]) {
+				m_irq_waiting[i] = true;
+				m_irq_waiting_since[i] = sc_time_stamp();
+				if (rx_irq_time > SC_ZERO_TIME) {
+					m_irq_timer[i].notify(rx_irq_time);
+				}
+			}
+			if (waiting >= rx_irq_packets || sc_time_stamp() - m_irq_waiting_since[i]
+					>= rx_irq_time) {
+				m_irq_level[i] = true;
+				m_irq_waiting[i] = false;
+				m_irq_timer[i].cancel();
+				m_interrupts[i]++;
+			}
+		}
+		new_packet_IT[i].write(m_irq_level[i]);
+	}
+}
+
+unsigned long MemoryManager::descriptor_transactions() const {
+	unsigned long n = m_discard_writes;
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		n += m_read_transactions[i];
+		if (descriptor_rings) {
+			// the claimed entries are read from the RAM
+			n += m_read_transactions[i] - m_empty_reads[i];
+		}
+	}
+	return n;
+}
+
+void MemoryManager::output_load() const {
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		std::cout << name() << " receive queue " << i << ": " << m_descriptors_read[i]
+				<< " descriptors in " << m_read_transactions[i] << " reads, "
+				<< m_empty_reads[i] << " reads found it empty, " << m_interrupts[i]
+				<< " interrupts, "
+				<< (m_descriptors_read[i] > 0 ? (double) m_interrupts[i]
+						/ m_descriptors_read[i] : 0.0) << " per packet" << std::endl;
 	}
+	std::cout << name() << " discarded " << m_descriptors_discarded << " packets in "
+			<< m_discard_writes << " writes" << std::endl;
+	free_memory_addresses.output_statistics(name());
 }
 
@@ -10,12 +10,16 @@
 
 #include "globaldefs.h"
 #include <queue>
+#include <vector>
+#include <iostream>
 #include <tlm.h>	// includes systemc.h
 #include "tlm_utils/simple_target_socket.h"
 #include "tlm_utils/peq_with_get.h"
 
 #include "IpPacket.h"
 #include "packet_descriptor.h"
+#include "DescriptorRing.h"
+#include "BufferPool.h"
 
 using namespace sc_core;
 using namespace tlm;
@@ -27,7 +31,20 @@ using namespace tlm;
  * Manage the slots in the memory. It holds a list of available slot addresses
  * (@ref free_memory_addresses), and the DMA channels can only write to the memory when
  * they can get a slot address from this list. CPUs must read to the socket of
- * this submodule to drop a corrupted packet.
+ * this submodule to drop a corrupted packet. The slots are the packet buffers of
+ * buffer_classes if the packet memory is divided into size classes.
+ *
+ * The descriptors of the received packets are kept in n_rx_queues receive queues, each
+ * with an own interrupt line and read address (rx_queue_address()), so that the
+ * processors of different queues do not race for the same descriptors.
+ *
+ * A read or a drop command can also move a batch of descriptors, see descriptor_batch_size().
+ *
+ * The interrupts are moderated (rx_irq_packets, rx_irq_time), and a polling processor can
+ * mask the interrupt of its queue at rx_queue_irq_address().
+ *
+ * With descriptor_rings the receive queues are the rx_ring rings in the RAM instead, a
+ * read of rx_queue_address() claims entries of the ring, see ring_claim.
  *
  * @see IoModule
  * @see DmaChannel
@@ -39,8 +56,9 @@ public:
 	// *******                         ports, sockets                        ******* //
 	// *******===============================================================******* //
 
-	/// interrupt which is high when there is packet in the memory not claimed by any processor
-	sc_out<bool> new_packet_IT;
+	/// Interrupts, one per receive queue, high when there is packet in the queue not claimed
+	/// by any processor. Array size is n_rx_queues.
+	sc_out<bool> *new_packet_IT;
 	/// target socket, processors can read packet descriptors through this socket
 	tlm_utils::simple_target_socket<MemoryManager> target_socket;
 
@@ -48,18 +66,18 @@ public:
 	// *******                  contained and associated objects             ******* //
 	// *******===============================================================******* //
 
-	/// Buffer for managing the ip packet pointers.
-	/// Using the buffer queue we can avoid re-creation of objects, thus
-	/// speed up the simulation.
-	std::queue<IpPacket *>* ip_packet_buffer;
-
 	/// RAM slots not yet occupied by packet
-	sc_fifo<soc_address_t> free_memory_addresses;
+	BufferPool free_memory_addresses;
 
-	/// queue that holds packet descriptors that should be
+	/// queues that hold packet descriptors that should be
 	/// read by the CPUs after the packets are transfered to
-	/// the memory and the processors are notified
-	sc_fifo<packet_descriptor> packet_queue;
+	/// the memory and the processors are notified, n_rx_queues of them. Each holds
+	/// n_packet_buffers() descriptors, so that a received packet always finds room.
+	sc_fifo<packet_descriptor> **packet_queue;
+
+	/// with descriptor_rings the receive queues, n_rx_queues of them, written by the DMA
+	/// channels
+	DescriptorRing *rx_ring;
 
 private:
 	/// payload event queue
@@ -71,6 +89,36 @@ private:
 	/// delay when reading the packet descriptor FIFO
 	sc_time m_read_packet_descriptor_delay;
 
+	/// the queues were restored from a checkpoint, the free slots are not filled in
+	bool m_restored;
+
+	/// read transactions of each receive queue, a batch counts once
+	std::vector<unsigned long> m_read_transactions;
+	/// descriptors read from each receive queue
+	std::vector<unsigned long> m_descriptors_read;
+	/// reads of each receive queue that found it empty, e.g. lost a race to another CPU
+	std::vector<unsigned long> m_empty_reads;
+	/// drop command writes, a batch counts once
+	unsigned long m_discard_writes;
+	/// packets dropped by the drop commands
+	unsigned long m_descriptors_discarded;
+
+	// interrupt moderation, per receive queue
+	/// the interrupt is not masked by a polling processor
+	std::vector<bool> m_irq_enabled;
+	/// the interrupt line is high
+	std::vector<bool> m_irq_level;
+	/// packets are waiting, but not yet signalled
+	std::vector<bool> m_irq_waiting;
+	/// the time the first of the waiting packets arrived
+	std::vector<sc_time> m_irq_waiting_since;
+	/// expires rx_irq_time after the first waiting packet, array size n_rx_queues
+	sc_event *m_irq_timer;
+	/// an interrupt enable register was written
+	sc_event m_irq_control_event;
+	/// number of interrupts raised
+	std::vector<unsigned long> m_interrupts;
+
 	// *******===============================================================******* //
 	// *******                      member functions, processes              ******* //
 	// *******===============================================================******* //
@@ -79,10 +127,49 @@ public:
 	tlm_sync_enum nb_transport_fw(tlm_generic_payload &payload, tlm_phase &phase,
 			sc_time &delay_time);
 
+	/// blocking target socket callback, used in loosely_timed mode
+	void b_transport(tlm_generic_payload &payload, sc_time &delay_time);
+
+	/// fills free_memory_addresses with all the slots, unless they were restored
+	void start_of_simulation();
+
+	/// write the queues to a checkpoint, they are left empty, see save_checkpoint()
+	void save(std::ostream& out);
+
+	/**
+	 * Restores the queues, call before the simulation starts.
+	 * @param used_slots - the slots of the restored queues are appended to it
+	 */
+	void restore(std::istream& in, std::vector<soc_address_t>& used_slots);
+
+	/**
+	 * Frees the slots not referenced by the restored queues, i.e. those of the packets
+	 * that were in flight when the checkpoint was taken.
+	 * @return the number of slots freed
+	 */
+	unsigned int free_unused_slots(const std::vector<soc_address_t>& used_slots);
+
+	/// print the descriptor reads of the receive queues and the drop commands, and the use
+	/// of the packet buffers
+	void output_load() const;
+
+	/// number of descriptor reads and drop command writes, a batch counts once; with
+	/// descriptor_rings a claim and the read of the claimed entries from the RAM count
+	unsigned long descriptor_transactions() const;
+
 private:
+	/// reads a packet descriptor or frees the slot of a dropped packet, sets the response status
+	void execute_command(tlm_generic_payload &payload);
+	/// claims entries of a receive ring, sets the response status
+	void claim_ring_entries(tlm_generic_payload &payload, unsigned int queue);
+	/// number of packets waiting in a receive queue
+	unsigned int packets_waiting(unsigned int queue) const;
 	/// calls the backward path of a transaction
 	void respond_to_command_thread(void);
-	/// method that sets and clears the interrupt line in accordance with the packet_queue
+	/// writes an interrupt enable register, sets the response status
+	void set_interrupt_enable(tlm_generic_payload &payload);
+	/// method that sets and clears the interrupt lines in accordance with the packet queues,
+	/// the moderation and the interrupt enable registers
 	void interrupt_port_method(void);
 
 	/**
@@ -91,6 +178,9 @@ private:
 	 */
 public:
 	SC_CTOR(MemoryManager);
+
+	/// frees the queues, rings and interrupt ports
+	~MemoryManager();
 };
 
 #endif /* MEMORYMANAGER_H_ */
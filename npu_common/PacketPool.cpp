@@ -0,0 +1,126 @@
+/**
+ * @file	PacketPool.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "PacketPool.h"
+#include <iostream>
+#include <new>
+#include <cassert>
+
+using namespace std;
+
+const unsigned int PacketPool::CLASS_CAPACITY[N_SIZE_CLASSES] = { 64, 256, 1518,
+		IpPacket::MAX_DATA_SIZE };
+
+PacketPool::PacketPool() :
+	m_memory(0) {
+	for (unsigned int i = 0; i < N_SIZE_CLASSES; i++) {
+		m_free[i] = 0;
+		Statistics empty = { 0, 0, 0, 0 };
+		m_statistics[i] = empty;
+	}
+}
+
+PacketPool::~PacketPool() {
+	for (size_t i = 0; i < m_slabs.size(); i++) {
+		delete[] m_slabs[i];
+	}
+}
+
+size_t PacketPool::stride(unsigned int sizeClass) {
+	// the object itself may be larger than a small buffer, round up to 16 bytes
+	size_t size = IpPacket::DATA_OFFSET + CLASS_CAPACITY[sizeClass];
+	if (size < sizeof(IpPacket)) {
+		size = sizeof(IpPacket);
+	}
+	return (sizeof(BufferHeader) + size + 15) & ~(size_t) 15;
+}
+
+void PacketPool::grow(unsigned int sizeClass) {
+	size_t bufferSize = stride(sizeClass);
+	unsigned char* slab = new unsigned char[bufferSize * BUFFERS_PER_SLAB];
+	m_slabs.push_back(slab);
+	m_memory += bufferSize * BUFFERS_PER_SLAB;
+
+	// chain the buffers in address order
+	for (unsigned int i = BUFFERS_PER_SLAB; i-- > 0;) {
+		BufferHeader* header = reinterpret_cast<BufferHeader*> (slab + i * bufferSize);
+		header->h.next = m_free[sizeClass];
+		header->h.pool = this;
+		header->h.refs = 0;
+		header->h.sizeClass = sizeClass;
+		new (packet(header)) IpPacket();
+		m_free[sizeClass] = header;
+	}
+	m_statistics[sizeClass].buffers += BUFFERS_PER_SLAB;
+}
+
+IpPacket* PacketPool::acquire(unsigned int dataSize) {
+	if (dataSize > CLASS_CAPACITY[JUMBO]) {
+		return 0;
+	}
+	unsigned int sizeClass = 0;
+	while (CLASS_CAPACITY[sizeClass] < dataSize) {
+		sizeClass++;
+	}
+	if (m_free[sizeClass] == 0) {
+		grow(sizeClass);
+	}
+
+	BufferHeader* header = m_free[sizeClass];
+	m_free[sizeClass] = header->h.next;
+	header->h.refs = 1;
+
+	Statistics& statistics = m_statistics[sizeClass];
+	statistics.acquired++;
+	if (++statistics.inUse > statistics.peakInUse) {
+		statistics.peakInUse = statistics.inUse;
+	}
+
+	IpPacket* p = packet(header);
+	p->data_size = dataSize;
+	return p;
+}
+
+void PacketPool::retain(IpPacket* packet) {
+	BufferHeader* h = header(packet);
+	assert(h->h.refs > 0);
+	h->h.refs++;
+}
+
+void PacketPool::release(IpPacket* packet) {
+	BufferHeader* h = header(packet);
+	assert(h->h.refs > 0);
+	if (--h->h.refs == 0) {
+		h->h.pool->recycle(h);
+	}
+}
+
+void PacketPool::recycle(BufferHeader* header) {
+	unsigned int sizeClass = header->h.sizeClass;
+	header->h.next = m_free[sizeClass];
+	m_free[sizeClass] = header;
+	m_statistics[sizeClass].inUse--;
+}
+
+unsigned int PacketPool::capacity(const IpPacket* packet) {
+	return CLASS_CAPACITY[header(packet)->h.sizeClass];
+}
+
+size_t PacketPool::memoryUsage() const {
+	return m_memory;
+}
+
+void PacketPool::output_statistics(const char* name) const {
+	cout << name << " packet pool: " << m_slabs.size() << " slabs, "
+			<< m_memory / 1024 << " kB" << endl;
+	for (unsigned int i = 0; i < N_SIZE_CLASSES; i++) {
+		const Statistics& statistics = m_statistics[i];
+		cout << '\t' << CLASS_CAPACITY[i] << " B buffers: " << statistics.buffers
+				<< ", in use " << statistics.inUse << ", peak " << statistics.peakInUse
+				<< ", acquired " << statistics.acquired << " times" << endl;
+	}
+}
@@ -0,0 +1,159 @@
+/**
+ * @file	PacketPool.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef PACKETPOOL_H_
+#define PACKETPOOL_H_
+
+#include <vector>
+#include <cstddef>
+#include "IpPacket.h"
+
+/**
+ * Slab allocator for IpPacket objects.
+ *
+ * Packets are allocated in the smallest size class their data fits in:
+ * 64 bytes, 256 bytes, a full Ethernet frame (1518 bytes) or a jumbo
+ * buffer of IpPacket::MAX_DATA_SIZE bytes, whose memory image fills a
+ * memory slot. Larger packets are refused.
+ * Every size class has a free list of buffers, which are carved from slabs
+ * of BUFFERS_PER_SLAB buffers. A slab is only allocated when the free list
+ * of its class runs empty, so once the number of packets in flight stops
+ * growing there are no more heap allocations, and a small packet does not
+ * occupy a 2 kB buffer.
+ *
+ * The packets are passed as IpPacket pointers through the MAC FIFOs, the
+ * DMA channels and the Ethernet links, the data is never copied between
+ * them. Every buffer has a reference count, which is 1 after acquire().
+ * The owner of a reference either passes it on (e.g. by writing the pointer
+ * into a FIFO) or returns it with release(). retain() adds a reference for
+ * a second owner. The buffer goes back to the free list with the last
+ * release(). The reference count is not atomic, SystemC processes run in
+ * one thread.
+ *
+ * The pool frees all of its slabs when destroyed, including the packets
+ * still held in FIFOs.
+ *
+ * @note Used to speed up simulation, not intended to model any HW.
+ */
+class PacketPool {
+public:
+	/// size classes of the buffers
+	enum SizeClass {
+		SMALL,
+		MEDIUM,
+		FULL_FRAME,
+		JUMBO,
+		N_SIZE_CLASSES
+	};
+
+	/// capacity of packet_data in the buffers of each size class
+	static const unsigned int CLASS_CAPACITY[N_SIZE_CLASSES];
+
+	/// number of buffers allocated at once
+	static const unsigned int BUFFERS_PER_SLAB = 64;
+
+	/// occupancy of a size class
+	struct Statistics {
+		/// number of buffers in the slabs
+		unsigned int buffers;
+		/// number of buffers holding a packet
+		unsigned int inUse;
+		/// max. of inUse
+		unsigned int peakInUse;
+		/// number of acquire() calls served
+		unsigned long long acquired;
+	};
+
+	PacketPool();
+
+	/// frees all slabs
+	~PacketPool();
+
+	/**
+	 * Returns a packet with at least dataSize bytes of packet_data and
+	 * a reference count of 1. data_size is set to dataSize.
+	 * @param dataSize - number of data bytes
+	 * @return NULL if dataSize is more than IpPacket::MAX_DATA_SIZE, the
+	 * 			memory image of the packet would not fit into a memory slot
+	 */
+	IpPacket* acquire(unsigned int dataSize);
+
+	/// adds a reference to a packet of a pool
+	static void retain(IpPacket* packet);
+
+	/// drops a reference, the last one returns the packet to its pool
+	static void release(IpPacket* packet);
+
+	/// number of data bytes the buffer of a packet of a pool can hold
+	static unsigned int capacity(const IpPacket* packet);
+
+	/// occupancy of a size class
+	const Statistics& statistics(SizeClass sizeClass) const {
+		return m_statistics[sizeClass];
+	}
+
+	/// memory allocated for the slabs in bytes
+	size_t memoryUsage() const;
+
+	/// print the occupancy of every size class
+	void output_statistics(const char* name) const;
+
+private:
+	/**
+	 * Bookkeeping in front of every packet. It is padded to 32 bytes, so
+	 * that the packet following it stays aligned.
+	 */
+	union BufferHeader {
+		struct {
+			/// next free buffer of the size class, if free
+			BufferHeader* next;
+			/// pool the buffer belongs to
+			PacketPool* pool;
+			unsigned int refs;
+			unsigned int sizeClass;
+		} h;
+		/// padding
+		unsigned char align[32];
+	};
+
+	/// distance of the buffers of a size class in a slab
+	static size_t stride(unsigned int sizeClass);
+
+	static BufferHeader* header(const IpPacket* packet) {
+		return reinterpret_cast<BufferHeader*> (const_cast<unsigned char*> (
+				reinterpret_cast<const unsigned char*> (packet)) - sizeof(BufferHeader));
+	}
+
+	static IpPacket* packet(BufferHeader* header) {
+		return reinterpret_cast<IpPacket*> (reinterpret_cast<unsigned char*> (header)
+				+ sizeof(BufferHeader));
+	}
+
+	/// allocates a slab and puts its buffers on the free list
+	void grow(unsigned int sizeClass);
+
+	/// returns a buffer to the free list
+	void recycle(BufferHeader* header);
+
+	/// free buffers of each size class
+	BufferHeader* m_free[N_SIZE_CLASSES];
+
+	/// occupancy of each size class
+	Statistics m_statistics[N_SIZE_CLASSES];
+
+	/// all slabs
+	std::vector<unsigned char*> m_slabs;
+
+	/// bytes in the slabs
+	size_t m_memory;
+
+	// not copyable
+	PacketPool(const PacketPool&);
+	PacketPool& operator=(const PacketPool&);
+};
+
+#endif /* PACKETPOOL_H_ */
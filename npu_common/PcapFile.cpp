@@ -0,0 +1,203 @@
+/**
+ * @file	PcapFile.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "PcapFile.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const char PcapFile::INDEX_MAGIC[4] = { 'P', 'I', 'D', 'X' };
+
+namespace {
+
+/// magic number of microsecond resolution captures
+const uint32_t PCAP_MAGIC = 0xA1B2C3D4;
+/// magic number of nanosecond resolution captures
+const uint32_t PCAP_MAGIC_NS = 0xA1B23C4D;
+
+/// size of the global header of a capture file
+const size_t GLOBAL_HEADER_SIZE = 24;
+/// size of the header in front of every packet
+const size_t RECORD_HEADER_SIZE = 16;
+/// size of an Ethernet header
+const size_t ETHERNET_HEADER_SIZE = 14;
+
+inline uint32_t swap32(uint32_t value) {
+	return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000)
+			| (value << 24);
+}
+
+/// reads a 32-bit field of a header in the byte order of the file
+inline uint32_t field(const unsigned char* p, bool swapped) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return swapped ? swap32(value) : value;
+}
+
+} // namespace
+
+PcapFile::PcapFile(const char* fileName, bool cacheIndex, uint32_t maxLength) :
+	m_data(0), m_size(0), m_records(0), m_count(0), m_maxLength(maxLength), m_skipped(0),
+			m_indexMap(0), m_indexMapSize(0) {
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) GLOBAL_HEADER_SIZE) {
+		m_size = st.st_size;
+		void* mapped = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) {
+			m_data = (const unsigned char*) mapped;
+			// the packets are replayed in file order
+			madvise(mapped, m_size, MADV_SEQUENTIAL);
+		}
+	}
+	close(fd);
+	if (m_data == 0) {
+		return;
+	}
+
+	uint32_t magic = field(m_data, false);
+	if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS && swap32(magic) != PCAP_MAGIC
+			&& swap32(magic) != PCAP_MAGIC_NS) {
+		cerr << fileName << " is not a PCAP file" << endl;
+		munmap((void*) m_data, m_size);
+		m_data = 0;
+		return;
+	}
+
+	string indexName = string(fileName) + ".idx";
+	uint64_t fileTime = st.st_mtime;
+	if (cacheIndex && loadIndex(indexName.c_str(), fileTime)) {
+		return;
+	}
+	buildIndex();
+	if (cacheIndex) {
+		saveIndex(indexName.c_str(), fileTime);
+	}
+}
+
+PcapFile::~PcapFile() {
+	if (m_indexMap != 0) {
+		munmap(m_indexMap, m_indexMapSize);
+	}
+	if (m_data != 0) {
+		munmap((void*) m_data, m_size);
+	}
+}
+
+void PcapFile::buildIndex() {
+	uint32_t magic = field(m_data, false);
+	bool swapped = magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS;
+	bool nanoseconds = (swapped ? swap32(magic) : magic) == PCAP_MAGIC_NS;
+
+	m_built.clear();
+	m_skipped = 0;
+	size_t offset = GLOBAL_HEADER_SIZE;
+	while (offset + RECORD_HEADER_SIZE <= m_size) {
+		const unsigned char* header = m_data + offset;
+		Record record;
+		memset(&record, 0, sizeof(record));
+		record.offset = offset + RECORD_HEADER_SIZE;
+		record.timestamp = field(header, swapped) * 1000000000ULL
+				+ field(header + 4, swapped) * (nanoseconds ? 1ULL : 1000ULL);
+		record.caplen = field(header + 8, swapped);
+		record.len = field(header + 12, swapped);
+		if (record.caplen > m_size - record.offset) {
+			// truncated file, drop the incomplete packet
+			break;
+		}
+		offset = record.offset + record.caplen;
+		if (record.caplen < ETHERNET_HEADER_SIZE || record.caplen > record.len
+				|| record.len > m_maxLength) {
+			// no Ethernet header, malformed or too long to be replayed
+			m_skipped++;
+			continue;
+		}
+
+		const unsigned char* packet = m_data + record.offset;
+		if (record.caplen > ETHERNET_HEADER_SIZE) {
+			record.ipVersion = packet[ETHERNET_HEADER_SIZE] >> 4;
+		}
+		// destination address is at bytes 16..19 of the IP header
+		if (record.ipVersion == 4 && record.caplen >= ETHERNET_HEADER_SIZE + 20) {
+			const unsigned char* address = packet + ETHERNET_HEADER_SIZE + 16;
+			record.destAddress = ((uint32_t) address[0] << 24) | (address[1] << 16)
+					| (address[2] << 8) | address[3];
+		}
+		m_built.push_back(record);
+	}
+
+	m_records = m_built.empty() ? 0 : &m_built[0];
+	m_count = m_built.size();
+}
+
+bool PcapFile::loadIndex(const char* indexName, uint64_t fileTime) {
+	int fd = open(indexName, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	void* mapped = MAP_FAILED;
+	size_t size = 0;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(IndexHeader)) {
+		size = st.st_size;
+		mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+
+	const IndexHeader* header = (const IndexHeader*) mapped;
+	if (memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+			|| header->version != INDEX_VERSION || header->fileSize != m_size
+			|| header->fileTime != fileTime || header->maxLength != m_maxLength
+			|| header->count != (size - sizeof(IndexHeader)) / sizeof(Record)) {
+		// out of date or not an index
+		munmap(mapped, size);
+		return false;
+	}
+
+	m_indexMap = mapped;
+	m_indexMapSize = size;
+	m_count = header->count;
+	m_skipped = header->skipped;
+	m_records = (const Record*) ((const char*) mapped + sizeof(IndexHeader));
+	return true;
+}
+
+void PcapFile::saveIndex(const char* indexName, uint64_t fileTime) const {
+	IndexHeader header;
+	memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.version = INDEX_VERSION;
+	header.fileSize = m_size;
+	header.fileTime = fileTime;
+	header.maxLength = m_maxLength;
+	header.skipped = m_skipped;
+	header.count = m_count;
+
+	// a sidecar that cannot be written is not an error, the index is rebuilt next time
+	ofstream oFile(indexName, ios::binary | ios::trunc);
+	oFile.write((const char*) &header, sizeof(header));
+	if (m_count > 0) {
+		oFile.write((const char*) m_records, m_count * sizeof(Record));
+	}
+	oFile.close();
+	if (!oFile) {
+		unlink(indexName);
+	}
+}
@@ -0,0 +1,143 @@
+/**
+ * @file	PcapFile.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef PCAPFILE_H_
+#define PCAPFILE_H_
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Memory mapped libpcap capture file with an index of its packets.
+ *
+ * The constructor maps the file and walks the records once, storing the
+ * offset, timestamp, lengths and IPv4 destination address of every packet
+ * in a Record. Packets are then read with data() straight from the mapping,
+ * without copying or system calls, and replaying the file again only means
+ * starting over at index 0.
+ *
+ * The index can be cached in a sidecar file next to the capture (the file
+ * name with ".idx" appended). If the sidecar matches the size and the
+ * modification time of the capture, it is mapped instead of walking the
+ * capture again. The sidecar uses the byte order of the host.
+ *
+ * Both microsecond and nanosecond resolution captures are read, in either
+ * byte order. The link layer is assumed to be Ethernet. Records shorter than
+ * an Ethernet header, with more bytes captured than sent, or longer than
+ * maxLength are left out of the index and counted in skipped().
+ */
+class PcapFile {
+public:
+	/// index entry of a packet
+	struct Record {
+		/// offset of the packet data in the file
+		uint64_t offset;
+		/// capture time in ns
+		uint64_t timestamp;
+		/// number of bytes captured
+		uint32_t caplen;
+		/// length of the packet on the wire
+		uint32_t len;
+		/// IPv4 destination address, 0 if not an IPv4 packet
+		uint32_t destAddress;
+		/// version field of the IP header, 0 if the packet is too short
+		uint8_t ipVersion;
+		uint8_t reserved[3];
+	};
+
+	/**
+	 * Maps the file and builds or loads the index.
+	 * @param fileName - the path of the capture file
+	 * @param cacheIndex - load the index from the sidecar file, or write
+	 * 				it there if it is missing or out of date
+	 * @param maxLength - longest packet on the wire to index, Ethernet header included
+	 */
+	PcapFile(const char* fileName, bool cacheIndex = false,
+			uint32_t maxLength = 0xFFFFFFFF);
+
+	~PcapFile();
+
+	/// false if the file cannot be opened or is not a capture file
+	bool isOpen() const { return m_data != 0; }
+
+	/// number of packets
+	size_t size() const { return m_count; }
+
+	/// number of records left out of the index, see the class description
+	size_t skipped() const { return m_skipped; }
+
+	/// index entry of the packet at position i
+	const Record& operator[](size_t i) const { return m_records[i]; }
+
+	/// the captured bytes of a packet, starting with the Ethernet header
+	const unsigned char* data(const Record& record) const {
+		return m_data + record.offset;
+	}
+
+	/// true if the index was loaded from the sidecar file
+	bool indexCached() const { return m_indexMap != 0; }
+
+private:
+	/// header of the sidecar file, followed by count Records
+	struct IndexHeader {
+		/// INDEX_MAGIC
+		char magic[4];
+		/// INDEX_VERSION
+		uint32_t version;
+		/// size of the capture file
+		uint64_t fileSize;
+		/// modification time of the capture file
+		uint64_t fileTime;
+		/// maxLength the index was built with
+		uint64_t maxLength;
+		/// number of records left out
+		uint64_t skipped;
+		/// number of records
+		uint64_t count;
+	};
+
+	/// first bytes of a sidecar file
+	static const char INDEX_MAGIC[4];
+
+	/// version of the sidecar format
+	static const uint32_t INDEX_VERSION = 2;
+
+	/// walks the records of the mapped capture
+	void buildIndex();
+
+	/// maps the sidecar file if it matches the capture
+	bool loadIndex(const char* indexName, uint64_t fileTime);
+
+	/// writes the index into the sidecar file
+	void saveIndex(const char* indexName, uint64_t fileTime) const;
+
+	/// the mapped capture file
+	const unsigned char* m_data;
+	size_t m_size;
+
+	/// the index, points to m_built or into m_indexMap
+	const Record* m_records;
+	size_t m_count;
+
+	/// longest record indexed, and the number of records left out
+	uint32_t m_maxLength;
+	size_t m_skipped;
+
+	/// index built from the capture
+	std::vector<Record> m_built;
+
+	/// the mapped sidecar file, if the index was loaded from there
+	void* m_indexMap;
+	size_t m_indexMapSize;
+
+	// not copyable
+	PcapFile(const PcapFile&);
+	PcapFile& operator=(const PcapFile&);
+};
+
+#endif /* PCAPFILE_H_ */
@@ -13,6 +13,7 @@
 #include <cassert>
 #include <arpa/inet.h> // for formatting inet addresses
 #include "PcapImporter.h"
+#include "Checkpoint.h"
 
 using namespace sc_core;
 using namespace std;
@@ -30,29 +31,29 @@ inline int min(int i1, int i2) {
 //
 SC_HAS_PROCESS(PcapImporter);
 
-PcapImporter::PcapImporter(sc_module_name name, const char * fileName) :
-	sc_module(name) {
-	unsigned int name_length = strlen(fileName) +1;
-	m_file_name = new char[name_length];
-	memcpy(m_file_name, fileName, name_length);
-	// open the PCAP file
-	m_handle = pcap_open_offline(m_file_name, 0);
-	if (m_handle == 0) {
+PcapImporter::PcapImporter(sc_module_name name, const char * fileName, bool cacheIndex) :
+	sc_module(name), m_file(fileName, cacheIndex,
+			EthernetLink::ETHERNET_HEADER_LENGTH + IpPacket::MAX_DATA_SIZE) {
+	// the file was mapped and indexed by m_file, without the packets that do not fit
+	// into a memory slot
+	if (!m_file.isOpen() || m_file.size() == 0) {
 		std::cerr << "unable to open PCAP file" << std::endl;
 		std::exit(1);
 	}
+	if (m_file.skipped() > 0) {
+		std::cout << this->name() << " skipped " << m_file.skipped()
+				<< " malformed or oversized packets of " << fileName << "." << std::endl;
+	}
+	m_packets_read = 0;
+	m_position = 0;
+	m_last_packet_time = 0;
 	m_time_scaling = 0.001;
 	m_total_transfer_time = SC_ZERO_TIME;
 	SC_THREAD(load_thread);
 }
 
 PcapImporter::~PcapImporter() {
-	// close the member handler if it was open
-	if (m_handle != 0) {
-		pcap_close(m_handle);
-	}
 	std::cout << name() << " received " << m_packets_read << " packets."  << std::endl;
-	delete[] m_file_name;
 }
 
 void PcapImporter::setTimeScaling(float ratio) {
@@ -61,38 +62,29 @@ void PcapImporter::setTimeScaling(float ratio) {
 }
 
 void PcapImporter::load_thread() {
-	// libpcap packet header that is filled out by pcap_next()
-	pcap_pkthdr pcapPacketHeader;
-	// packet data
-	const u_char *temp;
-
-	// read the packets one-by-one until we run out of data or encounter a read error
-	for (m_packets_read = 0;; m_packets_read++) {
-		// read pcap header and packet content
-		temp = pcap_next(m_handle, &pcapPacketHeader);
-		if (temp == 0) {
-			// error or end of file
-			pcap_close(m_handle);
-			m_handle = pcap_open_offline(m_file_name, 0);
-			temp = pcap_next(m_handle, &pcapPacketHeader);
+	// read the packets one-by-one, start over at the end of the file,
+	// a restored checkpoint continues where it was taken
+	for (;; m_packets_read++) {
+		if (m_position == m_file.size()) {
+			m_position = 0;
 		}
-		// check assumptions
-		assert(pcapPacketHeader.caplen < IpPacket::PACKET_MAX_SIZE);
+		// every indexed record has an Ethernet header and fits into a memory slot
+		const PcapFile::Record& record = m_file[m_position++];
 
 		if (m_packets_read != 0) {
 			// Skip this part for the first packet, that one is only used for time synchronization
 			// between the different input MACs of the switch (that use different pcap files).
 
 			// Wait to make the packets arrive in the MAC FIFO at the same rate as originally.
-			sc_time delay_time =
-					sc_time((pcapPacketHeader.ts.tv_sec - m_last_packet_time.tv_sec)*1000, SC_MS) +
-					sc_time( pcapPacketHeader.ts.tv_usec - m_last_packet_time.tv_usec    , SC_US);
+			// After starting over the first packet is earlier than the last one, it is not delayed.
+			sc_time delay_time = record.timestamp > m_last_packet_time ?
+					sc_time((double) (record.timestamp - m_last_packet_time), SC_NS) : SC_ZERO_TIME;
 
 			// Transfer time of the packet on an Ethernet line
 			sc_time packet_transfer_time =
-//						(max(pcapPacketHeader.len*8, 512) + EthernetLink::interframe_gap_bits)
+//						(max(record.len*8, 512) + EthernetLink::interframe_gap_bits)
 //							* EthernetLink::time_per_bit;
-				((pcapPacketHeader.len*8>512 ? pcapPacketHeader.len*8 : 512) 
+				((record.len*8>512 ? record.len*8 : 512) 
                                  + EthernetLink::interframe_gap_bits) * EthernetLink::time_per_bit;
 
 			// wait at least as long as it takes to transfer the packet on the line
@@ -104,30 +96,23 @@ void PcapImporter::load_thread() {
 
 			wait( waiting_time );
 
-			// put data into the Packet class
-			IpPacket *p;
-			if (unused_packets_queue->empty()) {
-				// create new packet
-				p = new IpPacket();
-			} else {
-				// get a packet pointer from the queue
-				p = unused_packets_queue->front();
-				// remove it from the queue
-				unused_packets_queue->pop();
-			}
-			// The Ethernet header is stripped, so the size is smaller than what
-			// the PCAP size param tells.
-			p->data_size = pcapPacketHeader.len - EthernetLink::ETHERNET_HEADER_LENGTH;
-			p->received = sc_time_stamp();
-			memcpy(p->packet_data, temp + EthernetLink::ETHERNET_HEADER_LENGTH, p->data_size);
-
 			// only use IP v4 packets
-			if (p->getVersion() == 4) {
+			if (record.ipVersion == 4) {
+				// The Ethernet header is stripped, so the size is smaller than what
+				// the PCAP size param tells. Bytes not captured are left as they are.
+				IpPacket *p = packet_pool->acquire(
+						record.len - EthernetLink::ETHERNET_HEADER_LENGTH);
+				assert(p != 0);
+				p->received = simulation_time();
+				unsigned int captured = record.caplen - EthernetLink::ETHERNET_HEADER_LENGTH;
+				memcpy(p->packet_data, m_file.data(record) + EthernetLink::ETHERNET_HEADER_LENGTH,
+						captured < p->data_size ? captured : p->data_size);
+
 				n_packets_received++;
-				if (n_packets_received == MAX_PACKETS) sc_stop();
+				if (n_packets_received >= MAX_PACKETS) sc_stop();
 
 				// log destination address in static member
-				unsigned int dest_address = p->getDestAddress();
+				unsigned int dest_address = record.destAddress;
 				std::map<unsigned int, unsigned int>::iterator it = address_map.find(dest_address);
 				if (it == address_map.end()) {
 					// add address to address_map
@@ -140,13 +125,8 @@ void PcapImporter::load_thread() {
 				// post packet into the MAC FIFO
 				sendPacket(p);
 			}
-			else{
-				// packet not sent into the system, push back to the queue
-				unused_packets_queue->push(p);
-			}
-				
 		}
-		m_last_packet_time = pcapPacketHeader.ts;
+		m_last_packet_time = record.timestamp;
 		
 	}
 }
@@ -155,8 +135,8 @@ void PcapImporter::sendPacket(IpPacket * packet) {
 	bool success = out_port->nb_write(packet);
 	if (!success){
 		n_packets_dropped_input_mac++;
-		// packet not sent into the system, push back to the queue
-		unused_packets_queue->push(packet);
+		// packet not sent into the system, give it back to the pool
+		PacketPool::release(packet);
 	}
 }
 
@@ -177,6 +157,21 @@ void PcapImporter::print_addresses() {
 }
 
 
+void PcapImporter::save(std::ostream& out) const {
+	checkpoint::write(out, m_packets_read);
+	checkpoint::write(out, (uint64_t) m_position);
+	checkpoint::write(out, m_last_packet_time);
+}
+
+void PcapImporter::restore(std::istream& in) {
+	uint64_t position;
+	checkpoint::read(in, m_packets_read);
+	checkpoint::read(in, position);
+	checkpoint::read(in, m_last_packet_time);
+	// the same file was replayed, see the configuration check of restore_checkpoint()
+	m_position = position < m_file.size() ? position : 0;
+}
+
 void PcapImporter::output_load() const {
 	cout << name() << " total transfer time: " << m_total_transfer_time << endl;
 	cout << name() << fixed << setprecision(1) << " load: transfer "
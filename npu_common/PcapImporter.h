@@ -9,10 +9,10 @@
 #define PCAPIMPORTER_H_
 
 #include <systemc>
-#include <queue>
 #include <map>
-#include <pcap.h>
-#include "IpPacket.h"
+#include <iostream>
+#include "PacketPool.h"
+#include "PcapFile.h"
 #include "globaldefs.h"
 
 /**
@@ -20,6 +20,11 @@
  * the first packet, which is only used to establish a relationship between
  * simulation time and time in the captured data.
  *
+ * The file is memory mapped and indexed once by a PcapFile, the packets are
+ * copied into the IpPacket buffers straight from the mapping. When the end of
+ * the file is reached, the replay starts over at the first packet. Malformed
+ * records and packets that do not fit into a memory slot are left out of the
+ * index, their number is printed by the constructor.
  */
 class PcapImporter: public sc_core::sc_module {
 
@@ -41,29 +46,29 @@ public:
 	/// Port for writing to the MAC receive FIFO
 	sc_core::sc_port<sc_core::sc_fifo_out_if<IpPacket *> > out_port;
 
-	/// packet queue
-	std::queue<IpPacket *> *unused_packets_queue;
+	/// pool the packets are allocated from
+	PacketPool *packet_pool;
 
 protected:
 	/// the number of packets already read from the PCAP file
 	unsigned int m_packets_read;
 
-	/// handle for a PCAP file
-	pcap_t *m_handle;
+	/// position of the next packet in the file
+	size_t m_position;
+
+	/// the mapped and indexed PCAP file
+	PcapFile m_file;
 
 	/// scaling factor used for adjusting the rate of packets
 	/// to the required load_thread in the simulation
 	float m_time_scaling;
 
-	/// time when the last packet was sent to the mac
-	timeval m_last_packet_time;
+	/// capture time of the last packet sent to the mac in ns
+	uint64_t m_last_packet_time;
 
 	/// time used to transfer received packets on the Ethernet line
 	sc_time m_total_transfer_time;
 
-	/// file name
-	char * m_file_name;
-
 	//
 	// member functions and processes
 	//
@@ -82,6 +87,12 @@ public:
 
 	void output_load() const;
 
+	/// write the replay position to a checkpoint, see save_checkpoint()
+	void save(std::ostream& out) const;
+
+	/// continue the replay from a checkpoint, call before the simulation starts
+	void restore(std::istream& in);
+
 protected:
 	/// Main working thread of this module. Loads packets from the file and writes
 	/// them to the FIFO port out_port;
@@ -96,15 +107,17 @@ protected:
 public:
 	/**
 	 * Constructor that opens the defined pcap file for reading. Member
-	 * m_time_scaling is set to 1.0. It throws an exception if the file
+	 * m_time_scaling is set to 1.0. It exits the program if the file
 	 * is not found or other errors occured while trying to open it.
 	 * @param name - SystemC module name
 	 * @param fileName - the path of the file that you want to open
-	 * @throws Exception if the file cannot be opened
+	 * @param cacheIndex - keep the packet index of the file in a sidecar file,
+	 * 				see PcapFile
 	 */
-	PcapImporter(sc_core::sc_module_name name, const char * fileName);
+	PcapImporter(sc_core::sc_module_name name, const char * fileName,
+			bool cacheIndex = false);
 
-	/// close PCAP file and print the number of read packets
+	/// print the number of read packets
 	~PcapImporter();
 
 };
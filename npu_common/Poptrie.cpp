@@ -0,0 +1,511 @@
+/**
+ * @file	Poptrie.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "Poptrie.h"
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <cassert>
+
+using namespace std;
+
+Poptrie::Poptrie() :
+	garbage(0) {
+	// an empty trie routes everything to 0
+	build();
+}
+
+bool Poptrie::prefixLength(unsigned int subnetMask, unsigned int& length) {
+	// count the leading ones of the mask, the rest of it has to be zero
+	length = 0;
+	while (length < 32 && (subnetMask & (0x80000000u >> length))) {
+		length++;
+	}
+	return length == 32 || (subnetMask << length) == 0;
+}
+
+bool Poptrie::add(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int nextHop) {
+	unsigned int length;
+	if (!prefixLength(subnetMask, length)) {
+		return false;
+	}
+
+	// an identical prefix added earlier is kept by build()
+	added.push_back(make_pair(key(length, netAddress & subnetMask), nextHop));
+	return true;
+}
+
+unsigned int Poptrie::expand(unsigned int netAddress, unsigned int length,
+		unsigned int nextHop, unsigned int& firstSlot, unsigned int& slotCount) {
+	uint64_t key = (uint64_t) netAddress << 4;
+	// level the prefix ends on, /0 is expanded on the root
+	unsigned int depth = length == 0 ? 0 : (length - 1) / STRIDE;
+	unsigned int current = 0;
+	bool created = false;
+	unsigned int top = 0;
+
+	// walk down, create the missing nodes on the path
+	for (unsigned int level = 0; level < depth; level++) {
+		unsigned int index = (key >> ((MAX_DEPTH - 1 - level) * STRIDE)) & 0x3F;
+		if (trie[current].child[index] < 0) {
+			// the new node inherits the (shorter) prefix that covered the slot
+			BuildNode node;
+			for (unsigned int i = 0; i < 64; i++) {
+				node.child[i] = -1;
+				node.nextHop[i] = trie[current].nextHop[index];
+				node.length[i] = trie[current].length[index];
+			}
+			trie.push_back(node);
+			trie[current].child[index] = trie.size() - 1;
+			if (!created) {
+				// the first node that got a new child
+				created = true;
+				top = current;
+				firstSlot = index;
+				slotCount = 1;
+			}
+		}
+		current = trie[current].child[index];
+	}
+	if (!created) {
+		top = current;
+	}
+
+	// expand the prefix to the slots it covers on its level
+	unsigned int fixedBits = length - depth * STRIDE;
+	unsigned int index = (key >> ((MAX_DEPTH - 1 - depth) * STRIDE)) & 0x3F;
+	unsigned int first = index & ~((1u << (STRIDE - fixedBits)) - 1);
+	unsigned int count = 1u << (STRIDE - fixedBits);
+	if (length == 0) {
+		first = 0;
+		count = 64;
+	}
+	for (unsigned int i = first; i < first + count; i++) {
+		paint(current, i, nextHop, length);
+	}
+	if (!created) {
+		firstSlot = first;
+		slotCount = count;
+	}
+	return top;
+}
+
+unsigned int Poptrie::withdraw(unsigned int netAddress, unsigned int length,
+		unsigned int coverNextHop, int coverLength, unsigned int& firstSlot,
+		unsigned int& slotCount) {
+	uint64_t key = (uint64_t) netAddress << 4;
+	unsigned int depth = length == 0 ? 0 : (length - 1) / STRIDE;
+	unsigned int current = 0;
+
+	// the path was created when the prefix was expanded
+	for (unsigned int level = 0; level < depth; level++) {
+		unsigned int index = (key >> ((MAX_DEPTH - 1 - level) * STRIDE)) & 0x3F;
+		assert(trie[current].child[index] >= 0);
+		current = trie[current].child[index];
+	}
+
+	unsigned int fixedBits = length - depth * STRIDE;
+	unsigned int index = (key >> ((MAX_DEPTH - 1 - depth) * STRIDE)) & 0x3F;
+	unsigned int first = index & ~((1u << (STRIDE - fixedBits)) - 1);
+	unsigned int count = 1u << (STRIDE - fixedBits);
+	if (length == 0) {
+		first = 0;
+		count = 64;
+	}
+	for (unsigned int i = first; i < first + count; i++) {
+		unpaint(current, i, length, coverNextHop, coverLength);
+	}
+	firstSlot = first;
+	slotCount = count;
+	return current;
+}
+
+void Poptrie::paint(unsigned int node, unsigned int slot, unsigned int nextHop,
+		int length) {
+	// a longer prefix already owns the slot
+	if (trie[node].length[slot] > length) {
+		return;
+	}
+	trie[node].nextHop[slot] = nextHop;
+	trie[node].length[slot] = length;
+	if (trie[node].child[slot] >= 0) {
+		for (unsigned int i = 0; i < 64; i++) {
+			paint(trie[node].child[slot], i, nextHop, length);
+		}
+	}
+}
+
+void Poptrie::unpaint(unsigned int node, unsigned int slot, int length,
+		unsigned int coverNextHop, int coverLength) {
+	// the same length within the range of the prefix can only be the prefix itself
+	if (trie[node].length[slot] != length) {
+		return;
+	}
+	trie[node].nextHop[slot] = coverNextHop;
+	trie[node].length[slot] = coverLength;
+	if (trie[node].child[slot] >= 0) {
+		for (unsigned int i = 0; i < 64; i++) {
+			unpaint(trie[node].child[slot], i, length, coverNextHop, coverLength);
+		}
+	}
+}
+
+void Poptrie::build() {
+	if (!trie.empty()) {
+		// the prefixes of the updates come first, they were there earlier
+		PrefixList all(prefixes.begin(), prefixes.end());
+		all.insert(all.end(), added.begin(), added.end());
+		added.swap(all);
+		prefixes.clear();
+		trie.clear();
+		compressed.clear();
+	}
+
+	// Address order puts the prefixes within the range of a slot next to
+	// each other. The sort is stable, so the first of identical prefixes
+	// stays first, and it is the one that is kept.
+	stable_sort(added.begin(), added.end(), Poptrie::byAddress);
+	added.erase(unique(added.begin(), added.end(), sameKey), added.end());
+
+	nodes.assign(1, Node());
+	// Internet tables need fewer nodes than prefixes
+	nodes.reserve(added.size() + 1);
+	leaves.clear();
+	garbage = 0;
+	compress(0, 0, 0, added.size(), 0, -1);
+}
+
+void Poptrie::compress(unsigned int node, unsigned int depth, size_t begin,
+		size_t end, unsigned int nextHop, int length) {
+	// prefixes up to slotBits long are expanded to slots, longer ones make a child
+	unsigned int shift = (MAX_DEPTH - 1 - depth) * STRIDE;
+	unsigned int slotBits = (depth + 1) * STRIDE;
+	unsigned int slotHop[64];
+	int slotLength[64];
+	// slots with a child, and the range of the prefixes of each one
+	uint64_t vector = 0;
+	size_t childBegin[64];
+	size_t childEnd[64];
+	for (unsigned int i = 0; i < 64; i++) {
+		slotHop[i] = nextHop;
+		slotLength[i] = length;
+	}
+
+	for (size_t p = begin; p < end; p++) {
+		unsigned int prefixLength = (unsigned int) (added[p].first >> 32);
+		unsigned int slot = (unsigned int) (((uint64_t) (unsigned int) added[p].first
+				<< 4) >> shift) & 0x3F;
+		unsigned int first = slot;
+		unsigned int count = 1;
+		if (prefixLength > slotBits) {
+			// the prefixes of a slot are contiguous in address order
+			if (!(vector & (1ULL << slot))) {
+				vector |= 1ULL << slot;
+				childBegin[slot] = p;
+			}
+			childEnd[slot] = p + 1;
+			continue;
+		} else if (prefixLength <= depth * STRIDE) {
+			// only a /0 at the root covers a whole node
+			first = 0;
+			count = 64;
+		} else {
+			count = 1u << (slotBits - prefixLength);
+		}
+		for (unsigned int i = first; i < first + count; i++) {
+			// the longest prefix of a slot wins
+			if ((int) prefixLength > slotLength[i]) {
+				slotHop[i] = added[p].second;
+				slotLength[i] = prefixLength;
+			}
+		}
+	}
+
+	// the leaves of the node and its children array are appended, like in compress(top)
+	Node n = { vector, 0, (uint32_t) leaves.size(), (uint32_t) nodes.size() };
+	bool haveLeaf = false;
+	unsigned int lastHop = 0;
+	for (unsigned int i = 0; i < 64; i++) {
+		if (!(vector & (1ULL << i)) && (!haveLeaf || slotHop[i] != lastHop)) {
+			n.leafvec |= 1ULL << i;
+			leaves.push_back(slotHop[i]);
+			haveLeaf = true;
+			lastHop = slotHop[i];
+		}
+	}
+	nodes[node] = n;
+	nodes.resize(nodes.size() + __builtin_popcountll(vector));
+
+	unsigned int child = n.base1;
+	for (uint64_t rest = vector; rest; rest &= rest - 1) {
+		unsigned int i = __builtin_ctzll(rest);
+		compress(child++, depth + 1, childBegin[i], childEnd[i], slotHop[i],
+				slotLength[i]);
+	}
+}
+
+void Poptrie::buildTrie() {
+	// an identical prefix added earlier is kept
+	prefixes.clear();
+	for (PrefixList::const_iterator it = added.begin(); it != added.end(); ++it) {
+		prefixes.insert(*it);
+	}
+	PrefixList().swap(added);
+
+	// the uncompressed multibit trie, shortest prefixes first
+	BuildNode root;
+	for (unsigned int i = 0; i < 64; i++) {
+		root.child[i] = -1;
+		root.nextHop[i] = 0;
+		root.length[i] = -1;
+	}
+	trie.assign(1, root);
+	unsigned int firstSlot, slotCount;
+	for (PrefixMap::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+		expand((unsigned int) it->first, (unsigned int) (it->first >> 32), it->second,
+				firstSlot, slotCount);
+	}
+
+	nodes.clear();
+	leaves.clear();
+	nodes.resize(1);
+	compressed.assign(trie.size(), 0);
+	garbage = 0;
+	compress(0);
+}
+
+unsigned int Poptrie::compress(unsigned int top) {
+	unsigned int writes = 0;
+	compressed.resize(trie.size());
+
+	// Compress breadth first, so that the children of every node
+	// end up next to each other in the nodes array.
+	queue<pair<unsigned int, unsigned int> > pending; // (build index, node index)
+	pending.push(make_pair(top, compressed[top]));
+
+	while (!pending.empty()) {
+		const BuildNode& bn = trie[pending.front().first];
+		unsigned int nodeIndex = pending.front().second;
+		pending.pop();
+
+		Node node = { 0, 0, (uint32_t) leaves.size(), (uint32_t) nodes.size() };
+		bool haveLeaf = false;
+		unsigned int lastHop = 0;
+		for (unsigned int i = 0; i < 64; i++) {
+			if (bn.child[i] >= 0) {
+				node.vector |= 1ULL << i;
+				compressed[bn.child[i]] = nodes.size();
+				pending.push(make_pair((unsigned int) bn.child[i],
+						(unsigned int) nodes.size()));
+				nodes.push_back(Node());
+			} else if (!haveLeaf || bn.nextHop[i] != lastHop) {
+				// start a new run of leaves
+				node.leafvec |= 1ULL << i;
+				leaves.push_back(bn.nextHop[i]);
+				haveLeaf = true;
+				lastHop = bn.nextHop[i];
+				writes++;
+			}
+		}
+		nodes[nodeIndex] = node;
+		writes++;
+	}
+	return writes;
+}
+
+void Poptrie::countSubtree(unsigned int node, size_t& nodeCount,
+		size_t& leafCount) const {
+	nodeCount++;
+	leafCount += __builtin_popcountll(nodes[node].leafvec);
+	unsigned int children = __builtin_popcountll(nodes[node].vector);
+	for (unsigned int i = 0; i < children; i++) {
+		countSubtree(nodes[node].base1 + i, nodeCount, leafCount);
+	}
+}
+
+unsigned int Poptrie::update(unsigned int top, unsigned int firstSlot,
+		unsigned int slotCount) {
+	const Node old = nodes[compressed[top]];
+
+	// the children array and the leaves of top are replaced,
+	// and so are the subtrees of the children in the slot range
+	garbage += __builtin_popcountll(old.vector) + __builtin_popcountll(old.leafvec);
+	for (unsigned int i = firstSlot; i < firstSlot + slotCount; i++) {
+		if (old.vector & (1ULL << i)) {
+			size_t nodeCount = 0;
+			size_t leafCount = 0;
+			countSubtree(old.base1 + __builtin_popcountll(old.vector & ((1ULL << i) - 1)),
+					nodeCount, leafCount);
+			garbage += nodeCount - 1 + leafCount;
+		}
+	}
+
+	if (2 * garbage > nodes.size() + leaves.size()) {
+		// compact: compress the whole uncompressed trie again
+		nodes.clear();
+		leaves.clear();
+		nodes.resize(1);
+		garbage = 0;
+		return compress(0);
+	}
+
+	// rewrite top with a new children array, unchanged children are copied
+	const BuildNode& bn = trie[top];
+	unsigned int writes = 1;
+	vector<unsigned int> changed;
+	compressed.resize(trie.size());
+	Node node = { 0, 0, (uint32_t) leaves.size(), (uint32_t) nodes.size() };
+	bool haveLeaf = false;
+	unsigned int lastHop = 0;
+	for (unsigned int i = 0; i < 64; i++) {
+		if (bn.child[i] >= 0) {
+			node.vector |= 1ULL << i;
+			Node child = nodes[compressed[bn.child[i]]];
+			compressed[bn.child[i]] = nodes.size();
+			nodes.push_back(child);
+			writes++;
+			if (i >= firstSlot && i < firstSlot + slotCount) {
+				changed.push_back(bn.child[i]);
+			}
+		} else if (!haveLeaf || bn.nextHop[i] != lastHop) {
+			node.leafvec |= 1ULL << i;
+			leaves.push_back(bn.nextHop[i]);
+			haveLeaf = true;
+			lastHop = bn.nextHop[i];
+			writes++;
+		}
+	}
+	nodes[compressed[top]] = node;
+
+	for (unsigned int i = 0; i < changed.size(); i++) {
+		// the copied node is overwritten
+		writes += compress(changed[i]) - 1;
+	}
+	return writes;
+}
+
+bool Poptrie::insert(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int nextHop, unsigned int& memoryWrites) {
+	unsigned int length;
+	memoryWrites = 0;
+	if (!prefixLength(subnetMask, length)) {
+		return false;
+	}
+
+	if (trie.empty()) {
+		buildTrie();
+	}
+
+	netAddress &= subnetMask;
+	prefixes[key(length, netAddress)] = nextHop;
+	unsigned int firstSlot, slotCount;
+	unsigned int top = expand(netAddress, length, nextHop, firstSlot, slotCount);
+	memoryWrites = update(top, firstSlot, slotCount);
+	return true;
+}
+
+bool Poptrie::remove(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int& memoryWrites) {
+	unsigned int length;
+	memoryWrites = 0;
+	if (!prefixLength(subnetMask, length)) {
+		return false;
+	}
+	if (trie.empty()) {
+		buildTrie();
+	}
+	if (prefixes.erase(key(length, netAddress & subnetMask)) == 0) {
+		return false;
+	}
+	netAddress &= subnetMask;
+
+	// the longest shorter prefix takes over the slots
+	unsigned int coverNextHop = 0;
+	int coverLength = -1;
+	for (int l = (int) length - 1; l >= 0 && coverLength < 0; l--) {
+		PrefixMap::const_iterator it = prefixes.find(key(l, netAddress & mask(l)));
+		if (it != prefixes.end()) {
+			coverNextHop = it->second;
+			coverLength = l;
+		}
+	}
+	unsigned int firstSlot, slotCount;
+	unsigned int top = withdraw(netAddress, length, coverNextHop, coverLength,
+			firstSlot, slotCount);
+	memoryWrites = update(top, firstSlot, slotCount);
+	return true;
+}
+
+unsigned int Poptrie::lookup(unsigned int address, unsigned int& memoryReads) const {
+	uint64_t key = (uint64_t) address << 4;
+	unsigned int shift = (MAX_DEPTH - 1) * STRIDE;
+	const Node* node = &nodes[0];
+	unsigned int index = (unsigned int) (key >> shift) & 0x3F;
+
+	// root node and leaf
+	memoryReads = 2;
+	while (node->vector & (1ULL << index)) {
+		node = &nodes[node->base1
+				+ __builtin_popcountll(node->vector & ((2ULL << index) - 1)) - 1];
+		shift -= STRIDE;
+		index = (unsigned int) (key >> shift) & 0x3F;
+		memoryReads++;
+	}
+	return leaves[node->base0
+			+ __builtin_popcountll(node->leafvec & ((2ULL << index) - 1)) - 1];
+}
+
+void Poptrie::lookup(const unsigned int* addresses, unsigned int* nextHops,
+		size_t count) const {
+	// addresses walked down the trie in lock-step
+	static const unsigned int GROUP = 8;
+	const Node* node[GROUP];
+	size_t leaf[GROUP];
+	size_t i = 0;
+
+	for (; i + GROUP <= count; i += GROUP) {
+		// Every address starts at the root, so all of them are on the same
+		// level in every round. The next node of each one is prefetched,
+		// its cache miss overlaps with those of the other addresses.
+		unsigned int shift = (MAX_DEPTH - 1) * STRIDE;
+		unsigned int pending = (1u << GROUP) - 1;
+		for (unsigned int j = 0; j < GROUP; j++) {
+			node[j] = &nodes[0];
+		}
+		while (pending) {
+			for (unsigned int j = 0; j < GROUP; j++) {
+				if (!(pending & (1u << j))) {
+					continue;
+				}
+				unsigned int index = (unsigned int) (((uint64_t) addresses[i + j] << 4)
+						>> shift) & 0x3F;
+				if (node[j]->vector & (1ULL << index)) {
+					node[j] = &nodes[node[j]->base1 + __builtin_popcountll(
+							node[j]->vector & ((2ULL << index) - 1)) - 1];
+					__builtin_prefetch(node[j]);
+				} else {
+					leaf[j] = node[j]->base0 + __builtin_popcountll(
+							node[j]->leafvec & ((2ULL << index) - 1)) - 1;
+					__builtin_prefetch(&leaves[leaf[j]]);
+					pending &= ~(1u << j);
+				}
+			}
+			shift -= STRIDE;
+		}
+		for (unsigned int j = 0; j < GROUP; j++) {
+			nextHops[i + j] = leaves[leaf[j]];
+		}
+	}
+	for (; i < count; i++) {
+		nextHops[i] = lookup(addresses[i]);
+	}
+}
+
+size_t Poptrie::memoryUsage() const {
+	return nodes.size() * sizeof(Node) + leaves.size() * sizeof(unsigned int);
+}
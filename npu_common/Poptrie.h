@@ -0,0 +1,284 @@
+/**
+ * @file	Poptrie.h
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#ifndef POPTRIE_H_
+#define POPTRIE_H_
+
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Compressed multibit trie for longest prefix match (Poptrie).
+ *
+ * The 32-bit address is consumed in 6-bit chunks, so every node has 64
+ * logical slots and a lookup visits at most 6 nodes. A node does not store
+ * its slots explicitly, it stores two 64-bit bitmaps instead:
+ * - @c vector: bit i is set if slot i points to a child node,
+ * - @c leafvec: bit i is set if slot i is a leaf whose next hop differs
+ *   from the previous leaf of the node (leaf compression).
+ *
+ * The children and the leaves of a node are stored contiguously in the
+ * @ref nodes and @ref leaves arrays, the position of a slot within them is
+ * the population count of the corresponding bitmap below the slot index.
+ * A node is 24 bytes, so the whole lookup touches a handful of cache lines
+ * regardless of the number of prefixes.
+ *
+ * Usage: call add() for every routing entry, then build() once. Entries
+ * with the same prefix and prefix length are resolved in favour of the
+ * first one added. Addresses not covered by any prefix are routed to 0.
+ *
+ * build() compresses the trie directly from the prefixes sorted by
+ * address. insert() and remove() update an uncompressed trie in place,
+ * which is built by the first of them. The changed node gets a new
+ * children array at the end of the arrays, only the subtrees below its
+ * changed slots are compressed again; the old copies become garbage. The
+ * arrays are compacted once the garbage outgrows the live part.
+ *
+ * @see RoutingTable
+ */
+class Poptrie {
+public:
+	/// number of address bits consumed per trie level
+	static const unsigned int STRIDE = 6;
+
+	/// number of levels needed to consume 32 bits with STRIDE bit chunks
+	static const unsigned int MAX_DEPTH = 6;
+
+	Poptrie();
+
+	/**
+	 * Registers a prefix, it only becomes visible to lookup() after build().
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - contiguous subnet mask (host byte order)
+	 * @param nextHop - value returned by lookup() for matching addresses
+	 * @retval false if the mask is not contiguous, the entry is ignored then
+	 */
+	bool add(unsigned int netAddress, unsigned int subnetMask, unsigned int nextHop);
+
+	/**
+	 * Builds the compressed trie from the prefixes registered so far,
+	 * including those of earlier insert() and remove() calls.
+	 */
+	void build();
+
+	/**
+	 * Adds a prefix or replaces the next hop of an existing one, and
+	 * updates the trie incrementally.
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - contiguous subnet mask (host byte order)
+	 * @param nextHop - value returned by lookup() for matching addresses
+	 * @param memoryWrites - number of nodes and leaves written
+	 * @retval false if the mask is not contiguous, the prefix is ignored then
+	 */
+	bool insert(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int nextHop, unsigned int& memoryWrites);
+
+	/**
+	 * Withdraws a prefix, and updates the trie incrementally. The addresses
+	 * it covered fall back to the next shorter matching prefix.
+	 * @param netAddress - network address (host byte order)
+	 * @param subnetMask - subnet mask (host byte order)
+	 * @param memoryWrites - number of nodes and leaves written
+	 * @retval false if the prefix is not in the trie
+	 */
+	bool remove(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int& memoryWrites);
+
+	/**
+	 * Longest prefix match.
+	 * @param address - destination address (host byte order)
+	 * @return next hop of the longest matching prefix, 0 if nothing matches
+	 */
+	inline unsigned int lookup(unsigned int address) const {
+		// the 32-bit key is extended to 36 bits, so that every level is STRIDE wide
+		uint64_t key = (uint64_t) address << 4;
+		unsigned int shift = (MAX_DEPTH - 1) * STRIDE;
+		const Node* node = &nodes[0];
+		unsigned int index = (unsigned int) (key >> shift) & 0x3F;
+
+		while (node->vector & (1ULL << index)) {
+			node = &nodes[node->base1
+					+ __builtin_popcountll(node->vector & ((2ULL << index) - 1)) - 1];
+			shift -= STRIDE;
+			index = (unsigned int) (key >> shift) & 0x3F;
+		}
+		return leaves[node->base0
+				+ __builtin_popcountll(node->leafvec & ((2ULL << index) - 1)) - 1];
+	}
+
+	/**
+	 * Longest prefix match that also reports its cost.
+	 * @param address - destination address (host byte order)
+	 * @param memoryReads - number of nodes and leaves read
+	 */
+	unsigned int lookup(unsigned int address, unsigned int& memoryReads) const;
+
+	/**
+	 * Longest prefix match of several addresses at once. Groups of eight
+	 * addresses are walked down the trie level by level, with their next
+	 * nodes prefetched, so that the cache misses of the group overlap.
+	 * @param addresses - destination addresses (host byte order)
+	 * @param nextHops - receives the next hop of each address
+	 * @param count - number of addresses
+	 */
+	void lookup(const unsigned int* addresses, unsigned int* nextHops,
+			size_t count) const;
+
+	/// number of internal nodes of the compressed trie
+	size_t nodeCount() const { return nodes.size(); }
+	/// number of leaves of the compressed trie
+	size_t leafCount() const { return leaves.size(); }
+	/// memory used by the lookup structure in bytes
+	size_t memoryUsage() const;
+
+private:
+	/// compressed internal node
+	struct Node {
+		/// slots holding a child node
+		uint64_t vector;
+		/// slots where a new run of leaves begins
+		uint64_t leafvec;
+		/// index of the first leaf of this node in @ref leaves
+		uint32_t base0;
+		/// index of the first child of this node in @ref nodes
+		uint32_t base1;
+	};
+
+	/// prefixes ordered by length, then by network address, see key()
+	typedef std::map<uint64_t, unsigned int> PrefixMap;
+
+	/// prefixes as registered by add(), ordered by build(), see byAddress()
+	typedef std::vector<std::pair<uint64_t, unsigned int> > PrefixList;
+
+	/// key of a prefix in PrefixMap
+	static uint64_t key(unsigned int length, unsigned int netAddress) {
+		return ((uint64_t) length << 32) | netAddress;
+	}
+
+	/// orders the prefixes of a PrefixList by network address, then by length
+	static bool byAddress(const std::pair<uint64_t, unsigned int>& a,
+			const std::pair<uint64_t, unsigned int>& b) {
+		return (unsigned int) a.first != (unsigned int) b.first
+				? (unsigned int) a.first < (unsigned int) b.first : a.first < b.first;
+	}
+
+	/// true for two entries of the same prefix in a PrefixList
+	static bool sameKey(const std::pair<uint64_t, unsigned int>& a,
+			const std::pair<uint64_t, unsigned int>& b) {
+		return a.first == b.first;
+	}
+
+	/// subnet mask of a prefix length
+	static unsigned int mask(unsigned int length) {
+		return length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+	}
+
+	/// converts a contiguous subnet mask to a prefix length
+	static bool prefixLength(unsigned int subnetMask, unsigned int& length);
+
+	/// Uncompressed node of the updates, slots are expanded prefixes.
+	struct BuildNode {
+		/// child index in the build array, -1 if the slot is a leaf
+		int child[64];
+		/// next hop stored in leaf slots
+		unsigned int nextHop[64];
+		/// length of the prefix that set nextHop, -1 if none
+		signed char length[64];
+	};
+
+	/**
+	 * Expands a prefix into the uncompressed trie.
+	 * @param firstSlot - receives the first slot of the returned node that changed
+	 * @param slotCount - receives the number of changed slots
+	 * @return index of the highest build node that changed
+	 */
+	unsigned int expand(unsigned int netAddress, unsigned int length,
+			unsigned int nextHop, unsigned int& firstSlot, unsigned int& slotCount);
+
+	/**
+	 * Removes an expanded prefix from the uncompressed trie, its slots get
+	 * the covering prefix.
+	 * @param firstSlot - receives the first slot of the returned node that changed
+	 * @param slotCount - receives the number of changed slots
+	 * @return index of the highest build node that changed
+	 */
+	unsigned int withdraw(unsigned int netAddress, unsigned int length,
+			unsigned int coverNextHop, int coverLength, unsigned int& firstSlot,
+			unsigned int& slotCount);
+
+	/// sets a slot and the slots inherited from it below, if length is not shorter
+	void paint(unsigned int node, unsigned int slot, unsigned int nextHop,
+			int length);
+
+	/// replaces a slot and the slots inherited from it below, if set by length
+	void unpaint(unsigned int node, unsigned int slot, int length,
+			unsigned int coverNextHop, int coverLength);
+
+	/**
+	 * Compresses a node and its subtree directly from a range of the
+	 * prefixes in address order. The range holds the prefixes within the
+	 * address range of the node that are longer than its parent's slots.
+	 * @param node - index of the node in @ref nodes, its children are appended
+	 * @param depth - level of the node, the root is 0
+	 * @param begin, end - range of the node in @ref added
+	 * @param nextHop, length - prefix covering the whole node, length -1 if none
+	 */
+	void compress(unsigned int node, unsigned int depth, size_t begin, size_t end,
+			unsigned int nextHop, int length);
+
+	/**
+	 * Builds the uncompressed trie and the prefix map from the prefixes of
+	 * build(), for the first insert() or remove(). The compressed trie is
+	 * compressed again from the uncompressed one.
+	 */
+	void buildTrie();
+
+	/**
+	 * Compresses the subtree of a build node. Its compressed node is
+	 * overwritten in place, the rest is appended to the arrays.
+	 * @return number of nodes and leaves written
+	 */
+	unsigned int compress(unsigned int top);
+
+	/// number of nodes and leaves of the compressed subtree of a node
+	void countSubtree(unsigned int node, size_t& nodeCount, size_t& leafCount) const;
+
+	/**
+	 * Writes the compressed node of top again with a new children array.
+	 * Children outside the changed slots are copied, the subtrees of the
+	 * others are compressed again. Everything is compressed again if
+	 * garbage dominates the arrays.
+	 * @return number of nodes and leaves written
+	 */
+	unsigned int update(unsigned int top, unsigned int firstSlot,
+			unsigned int slotCount);
+
+	/// prefixes registered with add(), in address order after build()
+	PrefixList added;
+
+	/// prefixes of the incremental updates, filled by buildTrie()
+	PrefixMap prefixes;
+
+	/// uncompressed trie, trie[0] is the root, empty before buildTrie()
+	std::vector<BuildNode> trie;
+
+	/// index of the compressed node of every build node
+	std::vector<uint32_t> compressed;
+
+	/// internal nodes, nodes[0] is the root
+	std::vector<Node> nodes;
+
+	/// leaf next hops
+	std::vector<unsigned int> leaves;
+
+	/// nodes and leaves left unreachable by incremental updates
+	size_t garbage;
+};
+
+#endif /* POPTRIE_H_ */
@@ -28,6 +28,7 @@
 #include "RAM.h"                        // our header
 #include "reporting.h"                                // reporting macros
 #include "globaldefs.h"
+#include "Checkpoint.h"
 using namespace std;
 using namespace sc_core;
 using namespace tlm;
@@ -51,6 +52,10 @@ RAM::RAM(sc_module_name module_name // module name
 
 	// register nonblocking function
 	m_memory_socket.register_nb_transport_fw(this, &RAM::nb_transport_fw);
+	// register blocking function, used in loosely_timed mode
+	m_memory_socket.register_b_transport(this, &RAM::b_transport);
+	// register DMI function
+	m_memory_socket.register_get_direct_mem_ptr(this, &RAM::get_direct_mem_ptr);
 
 	// Register begin_reponse as an SC_METHOD
 	// Used to implement force synchronization multiple timing points
@@ -131,6 +136,38 @@ RAM::nb_transport_fw // non-blocking transport call through Bus
 } //end nb_transport_fw
 
 
+//=============================================================================
+// b_transport implementation calls from initiators in loosely_timed mode
+//
+//=============================================================================
+void RAM::b_transport(tlm_generic_payload &payload, sc_time &delay_time) {
+	if (do_logging & LOG_MEM)
+		cout << sc_time_stamp() << " " << name() << ": trans " << &payload
+				<< " received, b_transport, delay " << delay_time << std::endl;
+
+	delay_time += ACCEPT_DELAY;
+	m_target_memory.operation(payload, delay_time); // adds the memory operation delay
+}
+
+//=============================================================================
+// get_direct_mem_ptr implementation, the memory never revokes the pointer
+//
+//=============================================================================
+bool RAM::get_direct_mem_ptr(tlm_generic_payload &payload, tlm_dmi &dmi_data) {
+	if (do_logging & LOG_MEM)
+		cout << sc_time_stamp() << " " << name() << ": DMI requested for address 0x" << hex
+				<< payload.get_address() << dec << endl;
+
+	dmi_data.set_dmi_ptr(m_target_memory.get_mem_ptr());
+	dmi_data.set_start_address(0);
+	dmi_data.set_end_address(m_target_memory.get_size() - 1);
+	// the same as the request and the response of a transaction take
+	dmi_data.set_read_latency(ACCEPT_DELAY + m_target_memory.get_read_delay());
+	dmi_data.set_write_latency(ACCEPT_DELAY + m_target_memory.get_write_delay());
+	dmi_data.allow_read_write();
+	return true;
+}
+
 //=============================================================================
 /// begin_response method function implementation
 //
@@ -197,6 +234,21 @@ void RAM::begin_response_method(void) {
 
 } //end begin_response_queue_active
 
+void RAM::save(std::ostream& out) {
+	sc_dt::uint64 size = m_target_memory.get_size();
+	checkpoint::write(out, size);
+	out.write(reinterpret_cast<const char*> (m_target_memory.get_mem_ptr()), size);
+}
+
+bool RAM::restore(std::istream& in) {
+	sc_dt::uint64 size = 0;
+	checkpoint::read(in, size);
+	if (size != m_target_memory.get_size()) {
+		return false;
+	}
+	in.read(reinterpret_cast<char*> (m_target_memory.get_mem_ptr()), size);
+	return true;
+}
 
 const sc_time RAM::READ_RESPONSE_DELAY = sc_time(10, SC_NS);
 const sc_time RAM::WRITE_RESPONSE_DELAY = sc_time(3, SC_NS);
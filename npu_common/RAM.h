@@ -31,6 +31,7 @@
 #include "tlm_utils/peq_with_get.h"                   // Payload event queue FIFO
 #include "tlm_utils/simple_target_socket.h"
 #include "memory.h"                                   // memory storage
+#include <iostream>
 using namespace sc_core;
 using namespace tlm;
 
@@ -81,6 +82,24 @@ public:
 	tlm_sync_enum nb_transport_fw(tlm_generic_payload &payload, tlm_phase &phase,
 			sc_time &delay_time);
 
+	/**
+	 * Blocking transport for the loosely-timed mode, the memory operation is
+	 * performed at once and its delay is annotated.
+	 */
+	void b_transport(tlm_generic_payload &payload, sc_time &delay_time);
+
+	/**
+	 * Direct memory interface, the whole memory is granted for reading and writing,
+	 * with the latencies of the 2-phase transactions.
+	 */
+	bool get_direct_mem_ptr(tlm_generic_payload &payload, tlm_dmi &dmi_data);
+
+	/// write the memory contents to a checkpoint, see save_checkpoint()
+	void save(std::ostream& out);
+
+	/// restore the memory contents, false if the checkpoint has a different memory size
+	bool restore(std::istream& in);
+
 	/**
 	 * Response Processing.
 	 * This routine takes transaction responses from the m_response_PEQ.
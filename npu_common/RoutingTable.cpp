@@ -6,7 +6,6 @@
  */
 
 #include "RoutingTable.h"
-#include "TokenIterator.h"
 #include <fstream>
 #include <vector>
 #include <string>
@@ -14,58 +13,143 @@
 #include <cstring>
 // whitespace checking
 #include <cctype>
-// for converting string IP addresses to numbers
-#include <arpa/inet.h>
+#include <cstdlib>
+#include <algorithm>
+#include <cassert>
+// memory mapping of the configuration file
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
-RoutingTable::RoutingTable(const char* fileName, char delimiter) {
-	char lineBuffer[200];
-	ifstream iFile(fileName);
+const char RoutingTable::BINARY_MAGIC[4] = { 'L', 'U', 'T', 'B' };
+
+RoutingTable::RoutingTable(const char* fileName, char delimiter,
+		Algorithm algorithm) :
+	m_algorithm(algorithm) {
+	// the whole file is mapped and parsed in a single pass
+	const char* data;
+	size_t size;
+	vector<char> buffer;
+	if (!mapFile(fileName, data, size, buffer)) {
+		// the lookup structures are still built, they route everything to 0
+		cerr << "cannot open LUT initializer file " << fileName << endl;
+	}
 #ifdef DEBUG
-	cerr << "opened file " << fileName << endl;
+	else {
+		cerr << "opened file " << fileName << endl;
+	}
 #endif
-	while (iFile.eof() == false) {
-		// read one line
-		iFile.getline(lineBuffer, sizeof(lineBuffer) / sizeof(char));
+
+	if (size >= sizeof(BinaryHeader)
+			&& memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+		readBinary(data, size);
+	} else {
+		readText(data, size, delimiter);
+	}
+	unmapFile(data, size, buffer);
+
+	normalize();
+
+	if (m_algorithm != LINEAR_SCAN) {
+		// Adding the routes in the order of the prefix maps of the lookup
+		// structures appends to the maps, normalize() sorted them so.
+		for (Iter it = table.begin(); it != table.end(); it++) {
+			if (m_algorithm == POPTRIE
+					&& !m_trie.add(it->netAddress, it->subnetMask, it->nextHop)) {
+				cerr << "non-contiguous subnet mask in LUT initializer file,"
+						<< " entry ignored by the trie" << endl;
+			}
+			if (m_algorithm == DIR_24_8
+					&& !m_dir.add(it->netAddress, it->subnetMask, it->nextHop)) {
+				cerr << "non-contiguous subnet mask or too big next hop in"
+						<< " LUT initializer file, entry ignored by DIR-24-8" << endl;
+			}
+		}
+	}
+
+	if (m_algorithm == POPTRIE) {
+		m_trie.build();
+	}
+	if (m_algorithm == DIR_24_8 && !m_dir.build()) {
+		cerr << "DIR-24-8 ran out of TBLlong chunks, some prefixes longer"
+				<< " than /24 are ignored" << endl;
+	}
+}
+
+bool RoutingTable::mapFile(const char* fileName, const char*& data, size_t& size,
+		vector<char>& buffer) {
+	data = NULL;
+	size = 0;
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		size = st.st_size;
+		void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		data = mapped == MAP_FAILED ? NULL : (const char*) mapped;
+	}
+	if (data == NULL) {
+		// not a regular file (e.g. a pipe), read it into memory
+		char chunk[4096];
+		ssize_t n;
+		while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+			buffer.insert(buffer.end(), chunk, chunk + n);
+		}
+		size = buffer.size();
+		data = size > 0 ? &buffer[0] : NULL;
+	}
+	// the mapping stays valid without the descriptor
+	close(fd);
+	return true;
+}
+
+void RoutingTable::unmapFile(const char* data, size_t size,
+		const vector<char>& buffer) {
+	if (buffer.empty() && data != NULL) {
+		munmap((void*) data, size);
+	}
+}
+
+void RoutingTable::readText(const char* data, size_t size, char delimiter) {
+	const char* end = data + size;
+	const char* line = data;
+
+	while (line < end) {
+		const char* lineEnd = (const char*) memchr(line, '\n', end - line);
+		if (lineEnd == NULL) {
+			lineEnd = end;
+		}
 
 		// handle the line
-		if (lineBuffer[0] == '#' || lineBuffer[0] == '\n' || lineBuffer[0]
-				== '\r' || lineBuffer[0] == '\0') {
+		if (*line == '#' || *line == '\n' || *line == '\r') {
 			// lines that begin with '#' are treated as comment, empty lines are omitted
 #ifdef DEBUG
 			cerr << "line skipped" << endl;
 #endif
 		} else {
-			// create Delimiter object from the single delimiter character and whitespace
-			Delimiters delimiters(delimiter);
-			// create a mutable pointer to the lineBuffer
-			char* pLineBuffer = lineBuffer;
-			// the words parsed will be packed into a vector
-			vector<string> wordList;
-
-			// create TokenIterators that can be used to tokenize the line
-			TokenIterator<char*, Delimiters> charIter(pLineBuffer, pLineBuffer
-					+ strlen(pLineBuffer), delimiters), end2;
-			// tokenize the line, resulting words are stored in wordList
-			copy(charIter, end2, back_inserter(wordList));
+			Field fields[3];
+			unsigned int nFields = splitLine(line, lineEnd, delimiter, fields, 3);
 
 			// make sure every parameter of a table row (RoutingEntry) can be initialized
-			if (wordList.size() != 3) {
+			if (nFields != 3) {
 				// the line should contain exactly 3 parameters
 				cerr << "format error in LUT initializer file" << endl
-						<< "\tno of words: " << wordList.size() << endl;
+						<< "\tno of words: " << nFields << endl;
 			} else {
-#ifdef DEBUG
-				cerr << "from words: ";
-				for (unsigned u = 0; u < 3; u++) {
-					cerr << wordList.at(u) << ", " << endl;
-				}
-#endif
 				RoutingEntry re;
-				re.netAddress = RoutingTable::parseAddress(wordList.at(0));
-				re.subnetMask = RoutingTable::parseAddress(wordList.at(1));
-				re.nextHop = RoutingTable::parseAddress(wordList.at(2));
+				if (!parseAddress(fields[0], re.netAddress)
+						| !parseAddress(fields[1], re.subnetMask)
+						| !parseAddress(fields[2], re.nextHop)) {
+					cerr << "invalid address in LUT initializer file, read as 0" << endl;
+				}
 				table.push_back(re);
 #ifdef DEBUG
 				cerr << "read entry NA: " << re.netAddress << ", SM: "
@@ -73,26 +157,258 @@ RoutingTable::RoutingTable(const char* fileName, char delimiter) {
 #endif
 			}
 		}
+		line = lineEnd + 1;
 	}
+}
 
+void RoutingTable::readBinary(const char* data, size_t size) {
+	BinaryHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.version != BINARY_VERSION
+			|| size != sizeof(header) + (size_t) header.count * sizeof(RoutingEntry)) {
+		cerr << "corrupt or incompatible binary LUT file" << endl;
+		return;
+	}
+
+	table.reserve(header.count);
+	const char* entries = data + sizeof(header);
+	for (uint32_t i = 0; i < header.count; i++) {
+		RoutingEntry re;
+		memcpy(&re, entries + i * sizeof(RoutingEntry), sizeof(RoutingEntry));
+		table.push_back(re);
+	}
 }
 
-unsigned int RoutingTable::getNextHop(unsigned int destAddress) {
+void RoutingTable::normalize() {
+	bool sorted = true;
+	for (size_t i = 0; i < table.size(); i++) {
+		// host bits set in the network address never match in the linear scan
+		table[i].netAddress &= table[i].subnetMask;
+		if (i > 0 && shorterMask(table[i], table[i - 1])) {
+			sorted = false;
+		}
+	}
+	// Binary files are sorted already. The sort is stable, so the first
+	// of identical routes stays first, and it is the one that is kept.
+	if (!sorted) {
+		stable_sort(table.begin(), table.end(), RoutingTable::shorterMask);
+	}
+	size_t count = table.empty() ? 0 : 1;
+	for (size_t i = 1; i < table.size(); i++) {
+		if (table[i].netAddress != table[count - 1].netAddress
+				|| table[i].subnetMask != table[count - 1].subnetMask) {
+			table[count++] = table[i];
+		}
+	}
+	if (count != table.size()) {
+		cerr << table.size() - count << " duplicate routes in LUT initializer file,"
+				<< " the first of each is used" << endl;
+		table.resize(count);
+	}
+}
+
+void RoutingTable::buildIndex() {
+	size_t i = 0;
+	while (i < table.size()) {
+		// the first of identical routes is indexed, the others are dropped
+		if (m_index.insert(make_pair(make_pair(table[i].netAddress, table[i].subnetMask),
+				i)).second) {
+			i++;
+		} else {
+			table[i] = table.back();
+			table.pop_back();
+		}
+	}
+}
+
+bool RoutingTable::save(const char* fileName) const {
+	// Shorter masks first, then by address: the order of the prefix
+	// maps of the lookup structures, so loading appends to them.
+	// The sort is stable, so the first of identical routes stays first.
+	Container sorted(table);
+	stable_sort(sorted.begin(), sorted.end(), RoutingTable::shorterMask);
+
+	ofstream oFile(fileName, ios::out | ios::binary | ios::trunc);
+	BinaryHeader header;
+	memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+	header.version = BINARY_VERSION;
+	header.count = sorted.size();
+	oFile.write((const char*) &header, sizeof(header));
+	if (!sorted.empty()) {
+		oFile.write((const char*) &sorted[0], sorted.size() * sizeof(RoutingEntry));
+	}
+	return oFile.good();
+}
+
+unsigned int RoutingTable::getNextHop(unsigned int destAddress) const {
+	switch (m_algorithm) {
+	case POPTRIE:
+		return m_trie.lookup(destAddress);
+	case DIR_24_8:
+		return m_dir.lookup(destAddress);
+	case LINEAR_SCAN:
+	default:
+		return linearLookup(destAddress);
+	}
+}
+
+unsigned int RoutingTable::getNextHop(unsigned int destAddress,
+		unsigned int& memoryReads) const {
+	switch (m_algorithm) {
+	case POPTRIE:
+		return m_trie.lookup(destAddress, memoryReads);
+	case DIR_24_8:
+		return m_dir.lookup(destAddress, memoryReads);
+	case LINEAR_SCAN:
+	default:
+		// every entry is read
+		memoryReads = table.size();
+		return linearLookup(destAddress);
+	}
+}
+
+bool RoutingTable::addRoute(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int nextHop, unsigned int& memoryWrites) {
+	memoryWrites = 0;
+	// the route is stored like the lookup structures store it
+	netAddress &= subnetMask;
+	if (m_index.empty()) {
+		buildIndex();
+	}
+	switch (m_algorithm) {
+	case POPTRIE:
+		if (!m_trie.insert(netAddress, subnetMask, nextHop, memoryWrites)) {
+			return false;
+		}
+		break;
+	case DIR_24_8:
+		if (!m_dir.insert(netAddress, subnetMask, nextHop, memoryWrites)) {
+			return false;
+		}
+		break;
+	case LINEAR_SCAN:
+	default:
+		// the entry is written in place
+		memoryWrites = 1;
+		break;
+	}
+
+	map<pair<unsigned int, unsigned int>, size_t>::iterator it = m_index.find(
+			make_pair(netAddress, subnetMask));
+	if (it != m_index.end()) {
+		table[it->second].nextHop = nextHop;
+		return true;
+	}
+	RoutingEntry re;
+	re.netAddress = netAddress;
+	re.subnetMask = subnetMask;
+	re.nextHop = nextHop;
+	table.push_back(re);
+	m_index.insert(make_pair(make_pair(netAddress, subnetMask), table.size() - 1));
+	return true;
+}
+
+bool RoutingTable::removeRoute(unsigned int netAddress, unsigned int subnetMask,
+		unsigned int& memoryWrites) {
+	memoryWrites = 0;
+	netAddress &= subnetMask;
+	if (m_index.empty()) {
+		buildIndex();
+	}
+	map<pair<unsigned int, unsigned int>, size_t>::iterator it = m_index.find(
+			make_pair(netAddress, subnetMask));
+	if (it == m_index.end()) {
+		return false;
+	}
+
+	switch (m_algorithm) {
+	case POPTRIE:
+		m_trie.remove(netAddress, subnetMask, memoryWrites);
+		break;
+	case DIR_24_8:
+		m_dir.remove(netAddress, subnetMask, memoryWrites);
+		break;
+	case LINEAR_SCAN:
+	default:
+		// the last entry is moved into the gap
+		memoryWrites = 1;
+		break;
+	}
+
+	// the order of the entries does not matter, fill the gap with the last one
+	size_t position = it->second;
+	m_index.erase(it);
+	if (position != table.size() - 1) {
+		table[position] = table.back();
+		m_index[make_pair(table[position].netAddress, table[position].subnetMask)]
+				= position;
+	}
+	table.pop_back();
+	return true;
+}
+
+void RoutingTable::getNextHops(const unsigned int* destAddresses,
+		unsigned int* nextHops, size_t count) const {
+	switch (m_algorithm) {
+	case POPTRIE:
+		m_trie.lookup(destAddresses, nextHops, count);
+		break;
+	case DIR_24_8:
+		m_dir.lookup(destAddresses, nextHops, count);
+		break;
+	case LINEAR_SCAN:
+	default:
+		linearLookup(destAddresses, nextHops, count);
+		break;
+	}
+}
+
+size_t RoutingTable::memoryUsage() const {
+	switch (m_algorithm) {
+	case POPTRIE:
+		return m_trie.memoryUsage();
+	case DIR_24_8:
+		return m_dir.memoryUsage();
+	case LINEAR_SCAN:
+	default:
+		return table.size() * sizeof(RoutingEntry);
+	}
+}
+
+void RoutingTable::output_memory_usage() const {
+	static const char* algorithmNames[] = { "linear scan", "Poptrie", "DIR-24-8" };
+
+	cout << "routing table: " << table.size() << " entries, " << algorithmNames[m_algorithm]
+			<< " lookup uses " << memoryUsage() / 1024 << " kB";
+	if (m_algorithm == POPTRIE) {
+		cout << " (" << m_trie.nodeCount() << " nodes, " << m_trie.leafCount()
+				<< " leaves)";
+	} else if (m_algorithm == DIR_24_8) {
+		cout << " (" << m_dir.chunkCount() << " TBLlong chunks)";
+	}
+	cout << endl;
+}
+
+unsigned int RoutingTable::linearLookup(unsigned int destAddress) const {
+	bool matched = false;
 	unsigned int longestMatchMask = 0;
 	unsigned int longestMatchNextHop = 0;
 
 	// analyze each entry
-	for (Iter it = table.begin(); it != table.end(); it++) {
+	for (Container::const_iterator it = table.begin(); it != table.end(); it++) {
 #ifdef DEBUG
 			cout << "comparing " << (destAddress & it->subnetMask) << " <-> " << it->netAddress
 					<< endl;
 #endif
 		// Address masked with subnet mask and checked if it is equals
 		// the required network address.
+		// The first match is always saved, so that a 0.0.0.0/0 default route is
+		// taken into account as well.
 		if (((destAddress & it->subnetMask) == it->netAddress)
-				&& (it-> subnetMask > longestMatchMask)) {
+				&& (!matched || it-> subnetMask > longestMatchMask)) {
 
 			// longest match, save it!
+			matched = true;
 			longestMatchMask = it->subnetMask;
 			longestMatchNextHop = it->nextHop;
 		}
@@ -100,30 +416,258 @@ unsigned int RoutingTable::getNextHop(unsigned int destAddress) {
 	return longestMatchNextHop;
 }
 
-unsigned int RoutingTable::parseAddress(std::string& str) {
+void RoutingTable::linearLookup(const unsigned int* destAddresses,
+		unsigned int* nextHops, size_t count) const {
+	size_t i = 0;
+#ifdef __SSE2__
+	// Every entry is compared with 16 addresses in four registers. Matches
+	// are rare, so the longest match is kept by scalar code in a branch.
+	for (; i + 16 <= count; i += 16) {
+		__m128i address[4];
+		bool matched[16];
+		unsigned int longestMatchMask[16];
+		for (unsigned int k = 0; k < 4; k++) {
+			address[k] = _mm_loadu_si128((const __m128i*) (destAddresses + i) + k);
+		}
+		for (unsigned int j = 0; j < 16; j++) {
+			matched[j] = false;
+			longestMatchMask[j] = 0;
+			nextHops[i + j] = 0;
+		}
+
+		for (Container::const_iterator it = table.begin(); it != table.end(); it++) {
+			__m128i mask = _mm_set1_epi32(it->subnetMask);
+			__m128i netAddress = _mm_set1_epi32(it->netAddress);
+			int match = 0;
+			for (unsigned int k = 0; k < 4; k++) {
+				match |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(
+						_mm_and_si128(address[k], mask), netAddress))) << (4 * k);
+			}
+			while (match) {
+				// same rule as the scalar version: first match or longer mask
+				unsigned int j = __builtin_ctz(match);
+				match &= match - 1;
+				if (!matched[j] || it->subnetMask > longestMatchMask[j]) {
+					matched[j] = true;
+					longestMatchMask[j] = it->subnetMask;
+					nextHops[i + j] = it->nextHop;
+				}
+			}
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		nextHops[i] = linearLookup(destAddresses[i]);
+	}
+}
+
+vector<RoutingTable::Update> RoutingTable::readUpdates(const char* fileName,
+		char delimiter) {
+	vector<Update> updates;
+	const char* data;
+	size_t size;
+	vector<char> buffer;
+	if (!mapFile(fileName, data, size, buffer)) {
+		return updates;
+	}
+
+	// parsed in place like the LUT file, lines are not copied
+	const char* end = data + size;
+	const char* line = data;
+	for (; line < end; line++) {
+		const char* lineEnd = (const char*) memchr(line, '\n', end - line);
+		if (lineEnd == NULL) {
+			lineEnd = end;
+		}
+		if (*line == '#' || *line == '\r' || *line == '\n') {
+			// comments and empty lines are omitted
+			line = lineEnd;
+			continue;
+		}
+		Field fields[5];
+		unsigned int nFields = splitLine(line, lineEnd, delimiter, fields, 5);
+		line = lineEnd;
+		if (nFields != 5) {
+			cerr << "format error in route update file" << endl
+					<< "\tno of words: " << nFields << endl;
+			continue;
+		}
+		Update u;
+		u.time = 0;
+		for (const char* digit = fields[0].begin; digit < fields[0].end
+				&& isdigit((unsigned char) *digit); digit++) {
+			u.time = u.time * 10 + (*digit - '0');
+		}
+		if (fields[1].end - fields[1].begin != 1
+				|| (*fields[1].begin != 'A' && *fields[1].begin != 'W')) {
+			cerr << "unknown operation in route update file, update ignored" << endl;
+			continue;
+		}
+		u.withdraw = *fields[1].begin == 'W';
+		if (!parseAddress(fields[2], u.netAddress)
+				| !parseAddress(fields[3], u.subnetMask)
+				| !parseAddress(fields[4], u.nextHop)) {
+			cerr << "invalid address in route update file, read as 0" << endl;
+		}
+		updates.push_back(u);
+	}
+	unmapFile(data, size, buffer);
+	return updates;
+}
+
+unsigned int RoutingTable::splitLine(const char* begin, const char* end,
+		char delimiter, Field* fields, unsigned int maxFields) {
+	unsigned int count = 0;
+	const char* pos = begin;
+	while (pos <= end) {
+		const char* fieldEnd = (const char*) memchr(pos, delimiter, end - pos);
+		if (fieldEnd == NULL) {
+			fieldEnd = end;
+		}
+		// trim whitespace (including the '\r' of DOS line ends)
+		const char* first = pos;
+		const char* last = fieldEnd;
+		while (first < last && isspace((unsigned char) *first)) {
+			first++;
+		}
+		while (last > first && isspace((unsigned char) last[-1])) {
+			last--;
+		}
+		// empty fields are skipped, like consecutive delimiters
+		if (first < last) {
+			if (count < maxFields) {
+				fields[count].begin = first;
+				fields[count].end = last;
+			}
+			count++;
+		}
+		pos = fieldEnd + 1;
+	}
+	return count;
+}
+
+bool RoutingTable::parseAddress(const Field& field, unsigned int& address) {
 	/*
-	 * The string contains an IPv4 address in the human
-	 * readable numbers-and-dots notation. However, it might
-	 * begin with whitespace, while the function inet_aton()
-	 * (see below) expects the string to begin with the address.
-	 * So whitespace has to be removed first.
+	 * The field contains an IPv4 address in the numbers-and-dots
+	 * notation of inet_aton(), with decimal parts: "a.b.c.d", or fewer
+	 * parts where the last one fills the remaining bytes ("3" is 0.0.0.3).
+	 * It is parsed in place, without copying the field.
 	 */
-	unsigned idx; // idx will hold the index in the string, where the address begins.
-	// go through the string until we get to a number
-	for (idx = 0; idx < str.length(); idx++) {
-		if (isdigit(str.at(idx))) {
+	unsigned long long parts[4];
+	unsigned int nParts = 0;
+	const char* pos = field.begin;
+	address = 0;
+
+	while (true) {
+		if (nParts == 4 || pos == field.end || !isdigit((unsigned char) *pos)) {
+			return false;
+		}
+		unsigned long long value = 0;
+		while (pos < field.end && isdigit((unsigned char) *pos) && value <= 0xFFFFFFFFull) {
+			value = value * 10 + (*pos++ - '0');
+		}
+		parts[nParts++] = value;
+		if (pos == field.end) {
 			break;
 		}
+		if (*pos++ != '.') {
+			return false;
+		}
 	}
-	// Erase leading whitespace
-	str.erase(0, idx);
 
-	// use standard function to read the address
-	in_addr addr_struct;
-	if (inet_aton(str.c_str(), &addr_struct)) {
-		// convert to local number format (endianness)
-		return ntohl(addr_struct.s_addr);
-	} else {
-		return 0;
+	// all parts but the last are single bytes, the last one fills the rest
+	unsigned int lastBits = 32 - 8 * (nParts - 1);
+	if (parts[nParts - 1] > (0xFFFFFFFFull >> (32 - lastBits))) {
+		return false;
+	}
+	unsigned long long result = parts[nParts - 1];
+	for (unsigned int i = 0; i < nParts - 1; i++) {
+		if (parts[i] > 0xFF) {
+			return false;
+		}
+		result |= parts[i] << (24 - 8 * i);
+	}
+	address = (unsigned int) result;
+	return true;
+}
+
+RoutingTableRef::RoutingTableRef() :
+	m_shared(NULL) {
+}
+
+RoutingTableRef::RoutingTableRef(RoutingTable* table) :
+	m_shared(new Shared) {
+	m_shared->table = table;
+	m_shared->refs = 1;
+}
+
+RoutingTableRef::RoutingTableRef(const RoutingTableRef& other) :
+	m_shared(other.m_shared) {
+	if (m_shared) {
+		m_shared->refs++;
+	}
+}
+
+RoutingTableRef& RoutingTableRef::operator=(const RoutingTableRef& other) {
+	// referenced before the release, in case other refers to the same table
+	Shared* shared = other.m_shared;
+	if (shared) {
+		shared->refs++;
+	}
+	release();
+	m_shared = shared;
+	return *this;
+}
+
+RoutingTableRef::~RoutingTableRef() {
+	release();
+}
+
+void RoutingTableRef::release() {
+	if (m_shared && --m_shared->refs == 0) {
+		if (!m_shared->key.empty()) {
+			registry().erase(m_shared->key);
+		}
+		delete m_shared->table;
+		delete m_shared;
+	}
+	m_shared = NULL;
+}
+
+map<string, RoutingTableRef::Shared*>& RoutingTableRef::registry() {
+	static map<string, Shared*> tables;
+	return tables;
+}
+
+RoutingTableRef RoutingTableRef::shared(const char* fileName, char delimiter,
+		RoutingTable::Algorithm algorithm) {
+	string key = string(fileName) + '\0' + delimiter + (char) ('0' + algorithm);
+	map<string, Shared*>::iterator it = registry().find(key);
+	if (it != registry().end()) {
+		RoutingTableRef ref;
+		ref.m_shared = it->second;
+		ref.m_shared->refs++;
+		return ref;
+	}
+
+	RoutingTableRef ref(new RoutingTable(fileName, delimiter, algorithm));
+	ref.m_shared->key = key;
+	registry()[key] = ref.m_shared;
+	return ref;
+}
+
+RoutingTable& RoutingTableRef::modify() {
+	// a default constructed handle has no table to modify
+	assert(m_shared);
+	if (m_shared->refs > 1) {
+		// copy-on-write: the other handles keep the current snapshot
+		RoutingTableRef copy(new RoutingTable(*m_shared->table));
+		*this = copy;
+	} else if (!m_shared->key.empty()) {
+		// the only handle: take the table out of the registry, so that
+		// shared() does not return the modified table
+		registry().erase(m_shared->key);
+		m_shared->key.clear();
 	}
+	return *m_shared->table;
 }
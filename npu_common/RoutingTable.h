@@ -9,7 +9,11 @@
 #define ROUTINGTABLE_H_
 
 #include <vector>
+#include <map>
 #include <string>
+#include <stdint.h>
+#include "Poptrie.h"
+#include "Dir24_8.h"
 
 /**
  * Lookup table for IP packet routing.
@@ -33,18 +37,135 @@
    139.133.0.0 | 255.255.0.0     | 2
    0.0.0.0 | 0.0.0.0 | 3
   @endverbatim
+ *
+ * The file is memory mapped and parsed in a single pass. A table saved
+ * with save() is a binary image of the entries instead, which is loaded
+ * without parsing; the constructor recognizes it by its header.
+ *
+ * The longest prefix match is done by one of the algorithms in
+ * RoutingTable::Algorithm, selected at construction. The linear scan
+ * over all entries is kept as a reference implementation, the default
+ * is the compressed trie (see Poptrie), whose lookup cost does not grow
+ * with the number of entries. The direct indexed table (see Dir24_8) trades
+ * at least 32 MB of memory for a lookup of one or two memory reads.
  */
 class RoutingTable {
 public:
+	/// longest prefix match implementations
+	enum Algorithm {
+		/// compare the address with every entry, O(N)
+		LINEAR_SCAN,
+		/// compressed multibit trie, at most 6 node visits
+		POPTRIE,
+		/// direct indexed 2^24 + 256 entry chunk tables, 1 or 2 memory reads
+		DIR_24_8
+	};
+
+	/**
+	 * A route announcement or withdrawal scheduled for a simulation time,
+	 * read from an update file by readUpdates().
+	 */
+	struct Update {
+		/// simulation time of the update in ns
+		unsigned long long time;
+		/// true for a withdrawal, false for an announcement
+		bool withdraw;
+		/// network address of the route
+		unsigned int netAddress;
+		/// subnet mask of the route
+		unsigned int subnetMask;
+		/// ID of the MAC for the network, unused for withdrawals
+		unsigned int nextHop;
+	};
+
 	/**
 	 * Constructor to build the lookup table, reads the data from a file.
+	 * @param fileName - the configuration file
+	 * @param delimiter - field separator in the file
+	 * @param algorithm - longest prefix match implementation
 	 */
-	RoutingTable(const char * fileName, char delimiter = '|');
+	RoutingTable(const char * fileName, char delimiter = '|',
+			Algorithm algorithm = POPTRIE);
 	/**
 	 * Returns the ID of the MAC that needs to be used for the next hop.
 	 * @param destAddress destination address as an integer
 	 */
-	unsigned int getNextHop(unsigned int destAddress);
+	unsigned int getNextHop(unsigned int destAddress) const;
+
+	/**
+	 * Returns the ID of the MAC that needs to be used for the next hop,
+	 * and the number of table memory reads the lookup needed. Used to
+	 * model the timing of lookup hardware.
+	 * @param destAddress destination address as an integer
+	 * @param memoryReads number of entries, nodes or table words read
+	 */
+	unsigned int getNextHop(unsigned int destAddress, unsigned int& memoryReads) const;
+
+	/**
+	 * Looks up the next hop of several destination addresses at once,
+	 * e.g. for traffic replay or a batching accelerator.
+	 * @param destAddresses destination addresses as integers
+	 * @param nextHops receives the ID of the MAC for each address
+	 * @param count number of addresses
+	 */
+	void getNextHops(const unsigned int* destAddresses, unsigned int* nextHops,
+			size_t count) const;
+
+	/**
+	 * Adds a route, or changes the next hop of an existing route with the
+	 * same network address and subnet mask. The lookup structure is
+	 * updated incrementally.
+	 * @param netAddress network address as an integer
+	 * @param subnetMask subnet mask as an integer
+	 * @param nextHop ID of the MAC for the network
+	 * @param memoryWrites number of entries, nodes or table words written
+	 * @retval false if the lookup structure cannot hold the route
+	 */
+	bool addRoute(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int nextHop, unsigned int& memoryWrites);
+
+	/**
+	 * Withdraws a route. The lookup structure is updated incrementally.
+	 * @param netAddress network address as an integer
+	 * @param subnetMask subnet mask as an integer
+	 * @param memoryWrites number of entries, nodes or table words written
+	 * @retval false if there is no such route
+	 */
+	bool removeRoute(unsigned int netAddress, unsigned int subnetMask,
+			unsigned int& memoryWrites);
+
+	/**
+	 * Reads a route update file. Every line holds the time in ns,
+	 * 'A' (announce) or 'W' (withdraw), the network address, the subnet
+	 * mask and the next hop, separated by delimiter. Lines beginning
+	 * with '#' are comments.
+	 * @param fileName - the update file
+	 * @param delimiter - field separator in the file
+	 * @return the updates in the order of the file, empty if the file
+	 * 			cannot be opened
+	 */
+	static std::vector<Update> readUpdates(const char* fileName,
+			char delimiter = '|');
+
+	/**
+	 * Saves the routes in the binary format, to be loaded by the
+	 * constructor. The format uses the byte order of the host.
+	 * @param fileName - the file to write
+	 * @retval false if the file cannot be written
+	 */
+	bool save(const char* fileName) const;
+
+	/// number of routes in the table
+	size_t size() const { return table.size(); }
+
+	/// the longest prefix match implementation in use
+	Algorithm getAlgorithm() const { return m_algorithm; }
+
+	/// memory used by the lookup structure in bytes
+	size_t memoryUsage() const;
+
+	/// print the size of the table and the memory used by the lookup structure
+	void output_memory_usage() const;
 
 protected:
 	/**
@@ -70,21 +191,194 @@ protected:
 	typedef std::vector<RoutingEntry> Container;
 	typedef Container::iterator Iter;
 
+	/// header of the binary table format, followed by count RoutingEntry structs
+	struct BinaryHeader {
+		/// BINARY_MAGIC
+		char magic[4];
+		/// BINARY_VERSION
+		uint32_t version;
+		/// number of entries
+		uint32_t count;
+	};
+
+	/// first bytes of a binary table file
+	static const char BINARY_MAGIC[4];
+
+	/// version of the binary table format
+	static const uint32_t BINARY_VERSION = 1;
+
+	/// a field of a line, trimmed, not terminated
+	struct Field {
+		const char* begin;
+		const char* end;
+	};
+
+	/**
+	 * Splits a line into fields at the delimiter, without allocating memory.
+	 * Whitespace around the fields is trimmed, empty fields are skipped.
+	 * @param fields - receives at most maxFields fields
+	 * @return number of fields in the line, it can be more than maxFields
+	 */
+	static unsigned int splitLine(const char* begin, const char* end,
+			char delimiter, Field* fields, unsigned int maxFields);
+
 	/**
-	 * Reads the IP address from the string.
+	 * Reads the IP address from a field.
 	 *
-	 * @param str - the string containing the IPv4 address
+	 * @param field - the field containing the IPv4 address
 	 * 				in numbers-and-dots format (e.g. "127.0.0.1").
-	 * @note	The function may modify the parameter if it
-	 * 			contains leading whitespace.
-	 * @return the integer value of the address, 0 if the string is invalid.
+	 * @param address - receives the integer value of the address,
+	 * 				0 if the field is invalid
+	 * @retval false if the field is not a valid address
 	 */
-	static unsigned int parseAddress(std::string& str);
+	static bool parseAddress(const Field& field, unsigned int& address);
+
+	/**
+	 * Maps a file into memory, or reads it into buffer if it cannot be
+	 * mapped (e.g. a pipe).
+	 * @param data - receives the contents, NULL if the file is empty
+	 * @param size - receives the size of the contents
+	 * @param buffer - holds the contents if the file was not mapped
+	 * @retval false if the file cannot be opened
+	 */
+	static bool mapFile(const char* fileName, const char*& data, size_t& size,
+			std::vector<char>& buffer);
+
+	/// releases the contents returned by mapFile()
+	static void unmapFile(const char* data, size_t size,
+			const std::vector<char>& buffer);
+
+	/// parses the text format from memory
+	void readText(const char* data, size_t size, char delimiter);
+
+	/// loads the binary format from memory
+	void readBinary(const char* data, size_t size);
+
+
+	/// Reference implementation: scans all entries of the table.
+	unsigned int linearLookup(unsigned int destAddress) const;
+
+	/// Reference implementation for several addresses, compares sixteen
+	/// addresses with an entry at once using SSE2.
+	void linearLookup(const unsigned int* destAddresses, unsigned int* nextHops,
+			size_t count) const;
 
 	/**
 	 * The STL container that holds the routing data.
 	 */
 	Container table;
+
+	/// Position of every route in table, keyed by (network address, subnet mask).
+	/// It is only built by the first addRoute() or removeRoute().
+	std::map<std::pair<unsigned int, unsigned int>, size_t> m_index;
+
+	/// indexes the routes of table in m_index, drops duplicate routes
+	void buildIndex();
+
+	/**
+	 * Clears the host bits of the network addresses, sorts the routes in
+	 * shorterMask() order and drops duplicate routes; the first of
+	 * identical routes in the file is kept.
+	 */
+	void normalize();
+
+	/// ordering of save() and of the prefix maps: shorter masks first, then by network address
+	static bool shorterMask(const RoutingEntry& a, const RoutingEntry& b) {
+		return a.subnetMask != b.subnetMask ? a.subnetMask < b.subnetMask
+				: a.netAddress < b.netAddress;
+	}
+
+	/// selected longest prefix match implementation
+	Algorithm m_algorithm;
+
+	/// compressed trie built from table, used if m_algorithm is POPTRIE
+	Poptrie m_trie;
+
+	/// direct indexed tables built from table, used if m_algorithm is DIR_24_8
+	Dir24_8 m_dir;
+};
+
+/**
+ * Reference counted handle of a RoutingTable.
+ *
+ * Handles from shared() refer to one table per configuration file and
+ * algorithm, so the Cpu instances and the Accelerator do not build and
+ * store a copy each. The table can only be read through the handle.
+ * modify() gives write access with copy-on-write: if the table is shared,
+ * the handle gets its own copy and the others keep the old snapshot.
+ *
+ * The lookup methods of RoutingTable are forwarded, so code written for a
+ * RoutingTable member, like m_rt.getNextHop(address), works unchanged.
+ * The reference count is not atomic, SystemC processes run in one thread.
+ */
+class RoutingTableRef {
+public:
+	/// handle that refers to no table
+	RoutingTableRef();
+
+	/// takes ownership of a table allocated with new
+	explicit RoutingTableRef(RoutingTable* table);
+
+	RoutingTableRef(const RoutingTableRef& other);
+	RoutingTableRef& operator=(const RoutingTableRef& other);
+	~RoutingTableRef();
+
+	/**
+	 * Returns a handle of the table read from a configuration file. The
+	 * table is built by the first call, later calls with the same
+	 * parameters share it as long as a handle of it exists.
+	 * @param fileName - the configuration file
+	 * @param delimiter - field separator in the file
+	 * @param algorithm - longest prefix match implementation
+	 */
+	static RoutingTableRef shared(const char* fileName, char delimiter = '|',
+			RoutingTable::Algorithm algorithm = RoutingTable::POPTRIE);
+
+	const RoutingTable* operator->() const { return m_shared->table; }
+	const RoutingTable& operator*() const { return *m_shared->table; }
+
+	/// RoutingTable::getNextHop(), so that a handle can be used like a table
+	unsigned int getNextHop(unsigned int destAddress) const {
+		return m_shared->table->getNextHop(destAddress);
+	}
+
+	/// RoutingTable::getNextHop() with the number of memory reads
+	unsigned int getNextHop(unsigned int destAddress, unsigned int& memoryReads) const {
+		return m_shared->table->getNextHop(destAddress, memoryReads);
+	}
+
+	/// RoutingTable::getNextHops()
+	void getNextHops(const unsigned int* destAddresses, unsigned int* nextHops,
+			size_t count) const {
+		m_shared->table->getNextHops(destAddresses, nextHops, count);
+	}
+
+	/**
+	 * Returns the table for modification. A table referred to by other
+	 * handles is copied first, and this handle refers to the copy.
+	 * @pre the handle refers to a table
+	 */
+	RoutingTable& modify();
+
+	/// number of handles referring to the table
+	unsigned int useCount() const { return m_shared ? m_shared->refs : 0; }
+
+private:
+	/// table with its reference count
+	struct Shared {
+		RoutingTable* table;
+		unsigned int refs;
+		/// key in the registry of shared(), empty if not registered
+		std::string key;
+	};
+
+	/// tables returned by shared(), by file name, delimiter and algorithm
+	static std::map<std::string, Shared*>& registry();
+
+	/// drops the reference, deletes the table with the last one
+	void release();
+
+	Shared* m_shared;
 };
 
 #endif /* ROUTINGTABLE_H_ */
@@ -7,8 +7,6 @@
 #include "SimpleBusAT.h"
 #include "reporting.h"
 
-static const char *filename = "SimpleBusAT.cpp"; ///  filename for reporting
-
 using namespace std;
 using namespace sc_core;
 using namespace tlm;
@@ -17,7 +15,10 @@ SC_HAS_PROCESS(SimpleBusAT);
 SimpleBusAT::SimpleBusAT(sc_module_name name, unsigned int n_initiators,
 		unsigned int n_targets, unsigned int bus_width) :
 	sc_module(name), nr_of_initiators(n_initiators), nr_of_targets(n_targets),
-			arbitration_time(CLK_CYCLE_BUS), m_bus_width(bus_width), mPEQ("requestPEQ") {
+			arbitration_time(CLK_CYCLE_BUS), m_bus_width(bus_width),
+			m_arbiter(n_initiators, bus_arbitration, bus_weights), m_max_burst(bus_max_burst),
+			mPEQ("requestPEQ"), m_grants(n_initiators, 0), m_splits(n_initiators, 0),
+			m_wait_time(n_initiators, SC_ZERO_TIME) {
 
 	target_socket
 			= new tlm_utils::simple_target_socket_tagged<SimpleBusAT>[nr_of_initiators];
@@ -26,10 +27,16 @@ SimpleBusAT::SimpleBusAT(sc_module_name name, unsigned int n_initiators,
 	for (unsigned int i = 0; i < nr_of_initiators; ++i) {
 		target_socket[i].register_nb_transport_fw(this,
 				&SimpleBusAT::nb_transport_fw_tagged, i);
+		target_socket[i].register_b_transport(this,
+				&SimpleBusAT::b_transport_tagged, i);
+		target_socket[i].register_get_direct_mem_ptr(this,
+				&SimpleBusAT::get_direct_mem_ptr_tagged, i);
 	}
 	for (unsigned int i = 0; i < nr_of_targets; ++i) {
 		initiator_socket[i].register_nb_transport_bw(this,
 				&SimpleBusAT::nb_transport_bw_tagged, i);
+		initiator_socket[i].register_invalidate_direct_mem_ptr(this,
+				&SimpleBusAT::invalidate_direct_mem_ptr_tagged, i);
 	}
 
 	SC_THREAD(RequestThread);
@@ -39,38 +46,68 @@ SimpleBusAT::SimpleBusAT(sc_module_name name, unsigned int n_initiators,
 
 void SimpleBusAT::RequestThread(void) {
 	while (true) {
-		wait(mPEQ.get_event());
-
+		// pass the transactions that arrived to the arbiter
 		tlm_generic_payload* trans;
 		while ((trans = mPEQ.get_next_transaction()) != 0) {
-			MEASURE_TRANSFER_TIME(
-				switch (mPendingTransactions.find(trans)->second.phase) {
-				case BEGIN_REQ:
-					// received request from initiator, the bus now forwards it to the target.
-					sendToTarget(trans);
-					break;
-				case END_REQ:
-					// request phase finished
-					// only in 4-phase AT
-					assert(0);
-					break;
-				case BEGIN_RESP:
-					// target started response
-					sendToInitiator(trans);
-					break;
-				case END_RESP:
-					// initiator ends response
-					// only in 4-phase AT
-					assert(0);
-					break;
-				default:
-					cout << "ERROR: '" << name()
-							<< "': Illegal phase in event queue from target." << endl;
-					assert(false);
-					exit(1);
-				}
-			)
+			ConnectionInfo& info = connection(*trans);
+			info.queued = sc_time_stamp();
+			m_arbiter.request(info.initiator, trans);
+		}
+		if (m_arbiter.empty()) {
+			wait(mPEQ.get_event());
+			continue;
 		}
+
+		unsigned int initiator;
+		trans = m_arbiter.grant(initiator);
+		ConnectionInfo& info = connection(*trans);
+		m_grants[initiator]++;
+		m_wait_time[initiator] += sc_time_stamp() - info.queued;
+
+		// the tenure, at most m_max_burst cycles of the phase
+		unsigned int cycles = info.cycles_left;
+		if (m_max_burst > 0 && cycles > m_max_burst) {
+			cycles = m_max_burst;
+		}
+		MEASURE_TRANSFER_TIME(
+			wait(arbitration_time + CLK_CYCLE_BUS * cycles);
+		)
+		info.cycles_left -= cycles;
+		if (info.cycles_left > 0) {
+			// split, the rest has to win the arbitration again
+			m_splits[initiator]++;
+			info.queued = sc_time_stamp();
+			m_arbiter.retry(initiator, trans);
+			continue;
+		}
+
+		MEASURE_TRANSFER_TIME(
+			switch (info.phase) {
+			case BEGIN_REQ:
+				// received request from initiator, the bus now forwards it to the target.
+				sendToTarget(trans);
+				break;
+			case END_REQ:
+				// request phase finished
+				// only in 4-phase AT
+				assert(0);
+				break;
+			case BEGIN_RESP:
+				// target started response
+				sendToInitiator(trans);
+				break;
+			case END_RESP:
+				// initiator ends response
+				// only in 4-phase AT
+				assert(0);
+				break;
+			default:
+				cout << "ERROR: '" << name()
+						<< "': Illegal phase in event queue from target." << endl;
+				assert(false);
+				exit(1);
+			}
+		)
 	}
 }
 
@@ -85,9 +122,8 @@ tlm_sync_enum SimpleBusAT::nb_transport_fw_tagged(int initiator_id,
 	if (phase == BEGIN_REQ) {
 		addPendingTransaction(payload, 0, initiator_id, phase);
 
-		// annotate delay time: arbitration time
-		delay_time += arbitration_time;
-
+		// the request competes for the bus after the annotated delay,
+		// the arbitration time is part of the tenure
 		mPEQ.notify(payload, delay_time);
 		phase = END_REQ;
 	} else {
@@ -100,7 +136,7 @@ tlm_sync_enum SimpleBusAT::nb_transport_fw_tagged(int initiator_id,
 	return TLM_UPDATED;
 }
 
-tlm_sync_enum SimpleBusAT::nb_transport_bw_tagged(int portId,
+tlm_sync_enum SimpleBusAT::nb_transport_bw_tagged(int /* portId */,
 		tlm_generic_payload& payload, tlm_phase& phase, sc_time& delay_time) {
 // logging	cout << "\tBus: trans " << &payload << " sent by target, phase: " << phase
 // logging			<< endl;
@@ -115,23 +151,87 @@ tlm_sync_enum SimpleBusAT::nb_transport_bw_tagged(int portId,
 		assert(false);
 		exit(1);
 	}
-	// Update transaction phase in the pending transactions database.
-	mPendingTransactions.find(&payload)->second.phase = phase;
+	// Update transaction phase in the routing state.
+	ConnectionInfo& info = connection(payload);
+	assert(info.pending);
+	info.phase = phase;
 
 	if (phase == BEGIN_RESP) {
-		// post transaction to PEQ
+		// the response carries the data of a read
+		info.cycles_left = payload.is_read() ? get_transfer_cycles(payload.get_data_length()) : 1;
+		// post transaction to PEQ, it competes for the bus from there
 		mPEQ.notify(payload, delay_time);
 		// Change phase to END_RESP only here, and don't save END_RESP in the
 		// database, because the transaction only ended for the target, not for
 		// the initiator.
 		phase = END_RESP;
 	}
-	// annotate delay time
-	delay_time += get_transport_delay(payload.get_data_length());
 
 	return TLM_COMPLETED;
 }
 
+void SimpleBusAT::b_transport_tagged(int initiator_id, tlm_generic_payload& payload,
+		sc_time& delay_time) {
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": trans " << &payload << " received, b_transport, delay "
+			<< delay_time << endl;
+
+	sc_dt::uint64 address = payload.get_address();
+	unsigned int portId = decode(address);
+	assert(portId < nr_of_targets);
+
+	// the request and the response tenure, one of them carries the data
+	sc_time tenure = 2 * arbitration_time + CLK_CYCLE_BUS * (get_transfer_cycles(
+			payload.get_data_length()) + 1);
+	delay_time += tenure;
+	total_transfer_time += tenure;
+	m_grants[initiator_id] += 2;
+
+	// address translation for the target side, back-translation for the initiator
+	payload.set_address(address & getAddressMask(portId));
+	initiator_socket[portId]->b_transport(payload, delay_time);
+	payload.set_address(address);
+}
+
+bool SimpleBusAT::get_direct_mem_ptr_tagged(int initiator_id,
+		tlm_generic_payload& payload, tlm_dmi& dmi_data) {
+	sc_dt::uint64 address = payload.get_address();
+	unsigned int portId = decode(address);
+	assert(portId < nr_of_targets);
+
+	// address translation for the target side, restored for the initiator
+	payload.set_address(address & getAddressMask(portId));
+	bool granted = initiator_socket[portId]->get_direct_mem_ptr(payload, dmi_data);
+	payload.set_address(address);
+
+	// address back-translation of the region, it may not reach out of the target
+	if (dmi_data.get_end_address() > getAddressMask(portId)) {
+		dmi_data.set_end_address(getAddressMask(portId));
+	}
+	dmi_data.set_start_address(dmi_data.get_start_address() | getAddressOffset(portId));
+	dmi_data.set_end_address(dmi_data.get_end_address() | getAddressOffset(portId));
+	dmi_data.set_read_latency(dmi_data.get_read_latency() + 2 * arbitration_time
+			+ CLK_CYCLE_BUS);
+	dmi_data.set_write_latency(dmi_data.get_write_latency() + 2 * arbitration_time
+			+ CLK_CYCLE_BUS);
+
+	if(do_logging & LOG_BUS)
+		cout << sc_time_stamp()<<" "<<name()<<": DMI " << (granted ? "granted" : "denied")
+			<< " to initiator " << initiator_id << " for target " << portId << endl;
+	return granted;
+}
+
+void SimpleBusAT::invalidate_direct_mem_ptr_tagged(int portId, sc_dt::uint64 start_range,
+		sc_dt::uint64 end_range) {
+	if (end_range > getAddressMask(portId)) {
+		end_range = getAddressMask(portId);
+	}
+	for (unsigned int i = 0; i < nr_of_initiators; i++) {
+		target_socket[i]->invalidate_direct_mem_ptr(start_range | getAddressOffset(portId),
+				end_range | getAddressOffset(portId));
+	}
+}
+
 void SimpleBusAT::sendToTarget(tlm_generic_payload* payload_ptr) {
 
 	// address translation for the target side
@@ -141,13 +241,13 @@ void SimpleBusAT::sendToTarget(tlm_generic_payload* payload_ptr) {
 	payload_ptr->set_address(payload_ptr->get_address() & getAddressMask(portId));
 
 	// Fill in the destination port
-	PendingTransactionsIterator it = mPendingTransactions.find(payload_ptr);
-	assert(it != mPendingTransactions.end());
-	it->second.to = decodeSocket;
+	ConnectionInfo& info = connection(*payload_ptr);
+	assert(info.pending);
+	info.to = decodeSocket;
 
 	// Use reference for phase, so that it is automatically
-	// updated in mPendingTransactions as well.
-	tlm_phase& phase = it->second.phase;
+	// updated in the routing state as well.
+	tlm_phase& phase = info.phase;
 	sc_time t = SC_ZERO_TIME;
 
 // logging	cout << "\tBus: trans " << payload_ptr << " sent to target " << portId
@@ -156,8 +256,8 @@ void SimpleBusAT::sendToTarget(tlm_generic_payload* payload_ptr) {
 		cout << sc_time_stamp()<<" "<<name()<<": trans " << payload_ptr << " sent to target " << portId
 			<< ", phase: " << report::print(phase) << endl;
 
-	// FIXME: No limitation on number of pending transactions
-	//        All targets (that return false) must support multiple transactions
+	// No limitation on number of pending transactions at the targets,
+	// all targets must support multiple transactions
 	tlm_sync_enum sync = (*decodeSocket)->nb_transport_fw(*payload_ptr, phase, t);
 	switch (sync) {
 	case TLM_ACCEPTED:
@@ -179,11 +279,12 @@ void SimpleBusAT::sendToTarget(tlm_generic_payload* payload_ptr) {
 	case TLM_COMPLETED:
 		// Transaction finished - early completion
 		// send to initiator
+		info.phase = BEGIN_RESP;
+		info.cycles_left = payload_ptr->is_read() ? get_transfer_cycles(
+				payload_ptr->get_data_length()) : 1;
+		// the destination port is kept, sendToInitiator() needs it for the address
 		mPEQ.notify(*payload_ptr, t);
 
-		// reset to destination port (we must not send END_RESP to target)
-		it->second.to = 0;
-
 		wait(t);
 		break;
 
@@ -195,24 +296,22 @@ void SimpleBusAT::sendToTarget(tlm_generic_payload* payload_ptr) {
 }
 void SimpleBusAT::sendToInitiator(tlm_generic_payload* payload_ptr) {
 	// find the connection info for the transaction
-	PendingTransactionsIterator it = mPendingTransactions.find(payload_ptr);
-	// mPendingPransactions.end() would mean there's no entry in the map for the transaction.
-	// Very serious error.
-	assert(it != mPendingTransactions.end());
+	ConnectionInfo& info = connection(*payload_ptr);
+	// a transaction that is not pending would be a very serious error
+	assert(info.pending);
 
 	// address back-translation for the initiator side
-	unsigned int portId = ((unsigned long int) it->second.to
-			- (unsigned long int) initiator_socket) / sizeof(simple_initiator_socket<
-			SimpleBusAT> );
+	unsigned int portId = info.to - initiator_socket;
 	assert(portId < nr_of_targets);
-	payload_ptr->set_address(payload_ptr->get_address() | portId << 28);
+	payload_ptr->set_address(payload_ptr->get_address() | getAddressOffset(portId));
 
+	// the data was transferred in the tenure of the response
 	tlm_phase phase = BEGIN_RESP;
-	sc_time t = get_transport_delay(payload_ptr->get_data_length());
+	sc_time t = SC_ZERO_TIME;
 
-	simple_target_socket_tagged<SimpleBusAT>* initiatorSocket = it->second.from;
+	simple_target_socket_tagged<SimpleBusAT>* initiatorSocket = info.from;
 	// if BEGIN_RESP is send first we don't have to send END_REQ anymore
-	it->second.from = 0;
+	info.from = 0;
 // logging	cout << "\tBus: trans " << payload_ptr << "sent to initiator" << portId
 // logging			<< ", phase: " << phase << endl;
 		if(do_logging & LOG_BUS)
@@ -223,7 +322,7 @@ void SimpleBusAT::sendToInitiator(tlm_generic_payload* payload_ptr) {
 	switch (sync) {
 	case TLM_COMPLETED:
 		// Transaction finished
-		mPendingTransactions.erase(payload_ptr);
+		info.pending = false;
 		wait(t);
 // logging		cout << "\tBus waiting " << t << "\n";
 		if(do_logging & LOG_BUS)
@@ -250,4 +349,16 @@ void SimpleBusAT::output_load() {
 	cout << name() << " total transfer time  : " << total_transfer_time << endl;
 	cout << name() << fixed << setprecision(1) << " load: transferring "
 			<< (total_transfer_time) / (sc_time_stamp()) * 100 << "%." << endl;
+	cout << name() << " arbitration: " << BusArbiter::policy_name(bus_arbitration)
+			<< ", max. burst: ";
+	if (m_max_burst > 0) {
+		cout << m_max_burst << " cycles" << endl;
+	} else {
+		cout << "unlimited" << endl;
+	}
+	for (unsigned int i = 0; i < nr_of_initiators; i++) {
+		cout << name() << " initiator " << i << ": " << m_grants[i] << " grants, "
+				<< m_splits[i] << " splits, waited " << m_wait_time[i] << " for the bus"
+				<< endl;
+	}
 }
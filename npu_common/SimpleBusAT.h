@@ -24,6 +24,7 @@
 #include <tlm_utils/peq_with_get.h>
 
 #include "globaldefs.h"
+#include "BusArbiter.h"
 using namespace tlm;
 using namespace sc_core;
 using namespace tlm_utils;
@@ -32,17 +33,40 @@ using namespace tlm_utils;
  * @class SimpleBusAT
  * A simple bus model for approximately timed simulations.
  * Adapted from the TLM 2.0 sample code.
+ *
+ * One transfer uses the bus at a time. A request holds the bus for one cycle, or for its
+ * data if it is a write, a response for one cycle, or for its data if it is a read
+ * (bytes / bus width + 1 cycles). The transfers waiting for the bus are ordered by a
+ * BusArbiter, every tenure starts with arbitration_time. If bus_max_burst is set, a longer
+ * transfer is split: it gives up the bus after bus_max_burst cycles and has to win the
+ * arbitration again for the rest, so that e.g. a CPU can read a descriptor in the middle
+ * of a DMA burst.
  */
 SC_MODULE(SimpleBusAT) {
 private:
-	struct ConnectionInfo {
+	/// Routing state of a transaction, attached to its payload as an extension.
+	/// It is created on the first transaction of the payload and reused by the
+	/// later ones, the payload deletes it.
+	struct ConnectionInfo : public tlm_extension<ConnectionInfo> {
 		simple_target_socket_tagged<SimpleBusAT>* from;
 		simple_initiator_socket_tagged<SimpleBusAT>* to;
 		tlm::tlm_phase phase;
+		/// index of the initiator socket
+		unsigned int initiator;
+		/// bus cycles left of the current phase
+		unsigned int cycles_left;
+		/// time when the transaction started waiting for the bus
+		sc_time queued;
+		/// true from the request until the response is delivered
+		bool pending;
+
+		tlm_extension_base* clone() const {
+			return new ConnectionInfo(*this);
+		}
+		void copy_from(const tlm_extension_base& ext) {
+			*this = static_cast<const ConnectionInfo&> (ext);
+		}
 	};
-	typedef std::map<tlm_generic_payload*, ConnectionInfo> PendingTransactions;
-	typedef PendingTransactions::iterator PendingTransactionsIterator;
-	typedef PendingTransactions::const_iterator PendingTransactionsConstIterator;
 
 	// *******===============================================================******* //
 	// *******                            sockets                            ******* //
@@ -59,7 +83,11 @@ private:
 	const unsigned int nr_of_targets;
 	const sc_time arbitration_time;
 	const unsigned int m_bus_width;
-	PendingTransactions mPendingTransactions;
+
+	/// orders the transactions waiting for the bus
+	BusArbiter m_arbiter;
+	/// max. bus cycles of a tenure, 0: no limit
+	const unsigned int m_max_burst;
 
 	tlm_utils::peq_with_get<tlm_generic_payload> mPEQ;
 	sc_core::sc_event mBeginRequestEvent;
@@ -70,6 +98,13 @@ private:
 	sc_time total_transfer_time;
 	sc_time period_start_time;
 
+	/// number of tenures per initiator
+	std::vector<unsigned long> m_grants;
+	/// number of transfers split per initiator
+	std::vector<unsigned long> m_splits;
+	/// time spent waiting for the bus per initiator
+	std::vector<sc_time> m_wait_time;
+
 	// *******===============================================================******* //
 	// *******                   member functions, processes                 ******* //
 	// *******===============================================================******* //
@@ -99,22 +134,43 @@ public:
 	tlm_sync_enum nb_transport_bw_tagged(int portId, tlm_generic_payload& payload,
 			tlm_phase& phase, sc_time& delay_time);
 
+	/**
+	 * Blocking transport for the loosely_timed mode. The transaction is forwarded
+	 * at once, and the tenures of its request and response on an uncontended bus are
+	 * annotated.
+	 */
+	void b_transport_tagged(int initiator_id, tlm_generic_payload& payload,
+			sc_time& delay_time);
+
+	/**
+	 * Forwards a DMI request to the target, and translates the region it gets
+	 * back into the address space of the initiators. Without contention a
+	 * transaction holds the bus for two arbitrations and the cycle of the phase
+	 * that carries no data, these are added to the latencies.
+	 */
+	bool get_direct_mem_ptr_tagged(int initiator_id, tlm_generic_payload& payload,
+			tlm_dmi& dmi_data);
+
+	/// forwards the invalidation of a DMI region of a target to every initiator
+	void invalidate_direct_mem_ptr_tagged(int portId, sc_dt::uint64 start_range,
+			sc_dt::uint64 end_range);
+
 	//
-	// Dummy decoder:
-	// - address[31-28]: portId
-	// - address[27-0]: masked address
+	// Dummy decoder, see init_address_map():
+	// - address[31-address_port_shift]: portId (address[31-28] with up to 13 MACs)
+	// - address[address_port_shift-1 - 0]: masked address
 	//
 
 	unsigned int getPortId(const sc_dt::uint64& address) {
-		return (unsigned int) address >> 28;
+		return (unsigned int) address >> address_port_shift;
 	}
 
 	sc_dt::uint64 getAddressOffset(unsigned int portId) {
-		return portId << 28;
+		return (sc_dt::uint64) portId << address_port_shift;
 	}
 
-	sc_dt::uint64 getAddressMask(unsigned int portId) {
-		return 0xfffffff;
+	sc_dt::uint64 getAddressMask(unsigned int /* portId */) {
+		return ((sc_dt::uint64) 1 << address_port_shift) - 1;
 	}
 
 	unsigned int decode(const sc_dt::uint64& address) {
@@ -129,9 +185,10 @@ public:
 	//
 
 	/**
-	 * Picks transactions out of the payload event queue, classifies
-	 * them according to the phase and calls appropriate functions
-	 * that handle requests and responses.
+	 * Picks transactions out of the payload event queue and passes them
+	 * to the arbiter. Gives the bus to the transaction granted by the arbiter,
+	 * and when its phase is transferred, classifies it according to the phase
+	 * and calls appropriate functions that handle requests and responses.
 	 */
 	void RequestThread(void);
 
@@ -141,17 +198,33 @@ public:
 	void output_load();
 
 private:
+	/// the routing state of a transaction, it is created on the first use of the payload
+	ConnectionInfo& connection(tlm_generic_payload& trans) {
+		ConnectionInfo* info = trans.get_extension<ConnectionInfo> ();
+		if (info == 0) {
+			info = new ConnectionInfo;
+			info->pending = false;
+			trans.set_extension(info);
+		}
+		return *info;
+	}
+
 	void addPendingTransaction(tlm_generic_payload& trans,
 			simple_initiator_socket_tagged<SimpleBusAT>* to, int initiatorId,
 			tlm::tlm_phase phase) {
-		const ConnectionInfo info = { &target_socket[initiatorId], to, phase };
-		assert(mPendingTransactions.find(&trans) == mPendingTransactions.end());
-		mPendingTransactions[&trans] = info;
+		ConnectionInfo& info = connection(trans);
+		assert(!info.pending);
+		info.from = &target_socket[initiatorId];
+		info.to = to;
+		info.phase = phase;
+		info.initiator = initiatorId;
+		info.cycles_left = trans.is_write() ? get_transfer_cycles(trans.get_data_length()) : 1;
+		info.queued = SC_ZERO_TIME;
+		info.pending = true;
 	}
 
-	inline sc_time get_transport_delay(unsigned int bytes) {
-		unsigned int n_cycles = bytes / m_bus_width + 1;
-		return CLK_CYCLE_BUS * n_cycles;
+	inline unsigned int get_transfer_cycles(unsigned int bytes) {
+		return bytes / m_bus_width + 1;
 	}
 
 	/**
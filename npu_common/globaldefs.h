@@ -10,6 +10,8 @@
 #define GLOBALDEFS_H_
 
 #include "systemc"
+#include <vector>
+#include <string>
 using namespace sc_core;
 
 // global varaible determines in which modules log information is output
@@ -46,12 +48,98 @@ extern unsigned int nMasters;
 /// width of bus in bytes
 extern unsigned int bus_width;
 
-/// number of packets that can be stored in the memory
+/// arbitration policies of the bus, see BusArbiter
+enum arbitration_policy {
+	ARBITRATION_ROUND_ROBIN, ARBITRATION_FIXED_PRIORITY, ARBITRATION_WEIGHTED
+};
+
+/// arbitration policy of the bus
+extern arbitration_policy bus_arbitration;
+
+/// max. number of bus cycles a transaction holds the bus, longer ones are split; 0: no limit
+extern unsigned int bus_max_burst;
+
+/// weight or priority of each bus master (1 if missing), see BusArbiter
+extern std::vector<unsigned int> bus_weights;
+
+/// number of bus transactions a DMA channel can have in flight at the same time
+extern unsigned int dma_outstanding_transactions;
+
+/// The DMA channels store the header of a received packet in a separate header buffer and
+/// the rest in the memory slot, see packet_descriptor. The processors only fetch the header.
+extern bool dma_header_split;
+
+/// Loosely-timed memory access: the DMA channels and the CPUs copy the data of their RAM
+/// transactions through the direct memory interface, and annotate the latencies of an
+/// uncontended bus instead of competing for it, see DmiCache.
+extern bool use_dmi;
+
+/// Loosely-timed simulation: the masters use b_transport and run ahead of the simulation
+/// time by up to lt_quantum (tlm_utils::tlm_quantumkeeper), the interconnect annotates
+/// the tenures of an uncontended bus. Much less context switches than the 2-phase AT
+/// protocol, but no bus contention and a timing error up to the quantum.
+extern bool loosely_timed;
+
+/// global quantum of the temporal decoupling in loosely_timed mode
+extern sc_time lt_quantum;
+
+/// size of a header buffer, it holds data_size, the reception time and the longest IP header
+extern const unsigned int HEADER_BUFFER_SIZE;
+
+/// Size of the packet memory in slots of IpPacket::PACKET_MAX_SIZE bytes, and the number
+/// of packets that can be stored in it unless it is divided into buffer_classes.
 extern unsigned int n_memory_slots;
 
+/// a size class of the packet buffers
+struct buffer_class {
+	/// bytes of a buffer
+	unsigned int size;
+	/// number of buffers
+	unsigned int count;
+};
+
+/// Size classes of the packet buffers, smallest first, see BufferPool. Empty: the packet
+/// memory is n_memory_slots fixed slots.
+extern std::vector<buffer_class> buffer_classes;
+
+/// Number of receive queues of the memory manager, each with an own interrupt line and
+/// descriptor read address. The DMA channels distribute the packets by flow hash
+/// (see flow_hash()), so the packets of a flow stay in order in one queue.
+extern unsigned int n_rx_queues;
+
+/// Number of descriptors the processors move in one bus transaction: a receive queue
+/// read, a transfer or a drop command write. 1: single descriptors, see
+/// descriptor_batch_size() for the batches.
+extern unsigned int cpu_descriptor_batch;
+
+/// Interrupt moderation of the receive queues: the interrupt of a queue is raised when
+/// rx_irq_packets packets are waiting, or rx_irq_time after the first of them arrived,
+/// whichever comes first. 1 packet or zero time: raised for every packet.
+extern unsigned int rx_irq_packets;
+extern sc_time rx_irq_time;
+
+/// NAPI-style polling: the processor disables the interrupt of its queue
+/// (rx_queue_irq_address()), handles up to napi_budget packets per poll, and enables the
+/// interrupt again when the queue is empty. 0: no polling, the interrupt stays enabled.
+extern unsigned int napi_budget;
+
+/// NIC-style descriptor rings: the receive queues and the transmit commands are rings of
+/// packet_descriptors in the RAM instead of FIFOs in the IO module, so every descriptor
+/// costs bus transactions to the RAM. See DescriptorRing for the protocol.
+extern bool descriptor_rings;
+
+/// with descriptor_rings, number of received descriptors a DMA channel writes back to a
+/// receive ring in one bus transaction; fewer when no more packets are coming
+extern unsigned int ring_writeback_batch;
+
+/// with descriptor_rings, number of descriptors a processor writes to a transmit ring
+/// before it rings the doorbell of the DMA channel, and it rings it before it waits for
+/// a packet in any case
+extern unsigned int ring_doorbell_batch;
+
 
 /// number of MACs, i.e.  Ports
-extern const unsigned int nMacs ;
+extern unsigned int nMacs ;
 
 
 //-------------------------------------------------------------------------------
@@ -69,32 +157,134 @@ extern unsigned int CPU_VERIFY_HEADER_CYCLES;
 extern unsigned int CPU_DECREMENT_TTL_CYCLES;
 extern unsigned int CPU_UPDATE_CHECKSUM_CYCLES;
 extern unsigned int CPU_IP_LOOKUP_CYCLES;
+/// accelerator cycles per routing table memory read
+extern unsigned int ACC_MEMORY_READ_CYCLES;
+/// accelerator cycles per routing table memory write
+extern unsigned int ACC_MEMORY_WRITE_CYCLES;
+
+/// number of pipeline stages of the accelerator lookup engine, a new lookup can start
+/// every 1/acc_pipeline_stages of the lookup time
+extern unsigned int acc_pipeline_stages;
+/// max. number of lookups in the accelerator pipeline at the same time
+extern unsigned int acc_lookups_in_flight;
+/// depth of the accelerator request FIFO
+extern unsigned int acc_request_depth;
+/// The accelerator pushes the lookup results into a mailbox of the processor instead of
+/// raising an interrupt and waiting for the processor to read the result on the bus.
+extern bool acc_result_push;
 
 
 /// speed of the Ethernet links in Mbps
 extern unsigned int ethernet_speed;
 
+/// simulation time at which the restored checkpoint was taken, see save_checkpoint()
+extern sc_time simulation_time_offset;
+
+/// Time since the start of the whole run, i.e. including the run of a restored checkpoint.
+/// Use it for time stamps that are stored in the model, e.g. IpPacket::received.
+sc_time simulation_time();
+
 //-------------------------------------------------------------------------------
 // addresses
 //-------------------------------------------------------------------------------
+/// the bus decodes the slave from the address bits above this one
+extern unsigned int address_port_shift;
 /// memory based address
 extern const soc_address_t MEMORY_BASE_ADDRESS;
 /// Address of the read-only register of the DMA module,
 /// packet descriptors can be read from here
-extern const soc_address_t PROCESSOR_QUEUE_ADDRESS;
+extern soc_address_t PROCESSOR_QUEUE_ADDRESS;
 /// Write-only DMA config register, post a packet_descriptor here to free a memory slot without
 /// transferring data.
-extern const soc_address_t DISCARD_QUEUE_ADDRESS;
+extern soc_address_t DISCARD_QUEUE_ADDRESS;
 /// DMA channel 0 write-only config register, write packet_descriptor here to transfer packet.
-extern const soc_address_t OUTPUT_0_ADDRESS;
+extern soc_address_t OUTPUT_0_ADDRESS;
 /// DMA channel 1 write-only config register, write packet_descriptor here to transfer packet.
-extern const soc_address_t OUTPUT_1_ADDRESS;
+extern soc_address_t OUTPUT_1_ADDRESS;
 /// DMA channel 2 write-only config register, write packet_descriptor here to transfer packet.
-extern const soc_address_t OUTPUT_2_ADDRESS;
+extern soc_address_t OUTPUT_2_ADDRESS;
 /// DMA channel 3 write-only config register, write packet_descriptor here to transfer packet.
-extern const soc_address_t OUTPUT_3_ADDRESS;
+extern soc_address_t OUTPUT_3_ADDRESS;
 /// The address of the accelerator int the system.
-extern const soc_address_t ACCELERATOR_ADDRESS;
+extern soc_address_t ACCELERATOR_ADDRESS;
+
+/// read-only result register of the accelerator for the processor with the given
+/// LookupRequest::processorId, the one of processor 0 is at ACCELERATOR_ADDRESS
+soc_address_t accelerator_result_address(unsigned int processor_id);
+
+/// write-only config register of DMA channel mac, write packet_descriptor here to transfer packet
+soc_address_t output_address(unsigned int mac);
+
+/// read-only register of a receive queue, the packet descriptors of the queue can be read
+/// from here; the one of queue 0 is PROCESSOR_QUEUE_ADDRESS
+soc_address_t rx_queue_address(unsigned int queue);
+
+/// the receive queue served by a processor, its interrupt line is the one of the queue
+unsigned int rx_queue_of_cpu(unsigned int cpu);
+
+/// offset of the interrupt enable registers in the address space of the memory manager
+extern const soc_address_t RX_IRQ_CONTROL_OFFSET;
+
+/// Write-only interrupt enable register of a receive queue, write an unsigned int: 0 masks
+/// the interrupt (polling), 1 enables it. The moderation starts again for the packets
+/// already waiting when the interrupt is enabled.
+soc_address_t rx_queue_irq_address(unsigned int queue);
+
+/// offset of the transmit doorbell registers in the address space of a DMA channel
+extern const soc_address_t TX_DOORBELL_OFFSET;
+
+/// number of entries of a descriptor ring, one per packet buffer, so a ring never overflows
+unsigned int ring_entries();
+
+/// address of the receive ring of a queue in the RAM, see descriptor_rings
+soc_address_t rx_ring_address(unsigned int queue);
+
+/// address of the transmit ring of a processor to a DMA channel in the RAM
+soc_address_t tx_ring_address(unsigned int mac, unsigned int cpu);
+
+/// Write-only doorbell register of the transmit ring of a processor to a DMA channel,
+/// write the unsigned int index after the last descriptor written to the ring, the index
+/// runs freely, see DescriptorRing.
+soc_address_t tx_doorbell_address(unsigned int mac, unsigned int cpu);
+
+/**
+ * Sets the number of MACs and generates the address map for it. The slaves are the RAM,
+ * the memory manager, the DMA channels and the accelerator, in this order, the bus decodes
+ * them from the upper address bits. Up to 13 MACs the slaves are 0x10000000 apart, as in
+ * the laboratory system, with more the address space of a slave is halved as needed.
+ * Call it before the modules are created.
+ */
+void init_address_map(unsigned int n_macs);
+
+/**
+ * Divides the packet memory of n_memory_slots slots among size classes of buffers.
+ * @param spec - comma separated <buffer size>:<percent of the packet memory> pairs, e.g.
+ * 			"128:20,640:30,2000:50"; the largest buffer must hold IpPacket::PACKET_MAX_SIZE
+ * 			bytes
+ * @return false if spec is invalid, buffer_classes is left empty then
+ */
+bool init_buffer_classes(const std::string& spec);
+
+/// the size classes of the packet buffers, a single class of the slots without buffer_classes
+std::vector<buffer_class> packet_buffer_classes();
+
+/// number of packet buffers in the packet memory
+unsigned int n_packet_buffers();
+
+/// index of the packet buffer at an address, the buffers are numbered from the start of
+/// the RAM up
+unsigned int packet_buffer_index(soc_address_t address);
+
+/// address of the packet buffer of an index
+soc_address_t packet_buffer_address(unsigned int index);
+
+/// address of the header buffer of a packet buffer (memory slot), the header buffers
+/// follow the packet memory
+soc_address_t header_buffer_address(soc_address_t slot_address);
+
+/// size of the RAM that holds the memory slots, with dma_header_split the header buffers,
+/// and with descriptor_rings the rings
+sc_dt::uint64 ram_size();
 
 //-------------------------------------------------------------------------------
 // struct to hold the important parameters of requesting routing table lookup
@@ -120,10 +310,16 @@ typedef struct LookupRequ {
 // config files
 //-------------------------------------------------------------------------------
 extern const char lutConfigFile[];
+extern const char lutUpdateFile[];
 extern const char pcapFile0[];
 extern const char pcapFile1[];
 extern const char pcapFile2[];
 extern const char pcapFile3[];
+/// PCAP files replayed by the ports, repeated if there are more ports, the sample files
+/// (pcapFile0 .. pcapFile3) if empty
+extern std::vector<std::string> pcap_files;
+/// keep the packet index of the PCAP files in sidecar files (<file>.idx)
+extern bool cache_pcap_index;
 
 //--------------------------------------------------------------------------------
 // statistics
@@ -1,5 +1,10 @@
 #include "systemc.h"
 #include "globaldefs.h"
+#include "IpPacket.h"
+#include "packet_descriptor.h"
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
 
 
 //----------------------------------------------------------------------
@@ -21,6 +26,13 @@ sc_time CLK_CYCLE_BUS = sc_time(20, SC_NS);
 sc_time CLK_CYCLE_CPU = sc_time(10, SC_NS);
 sc_time CLK_CYCLE_ACC; // no default value; if accelerator is used this value has to be specified
 
+/// simulation time at which the restored checkpoint was taken
+sc_time simulation_time_offset = SC_ZERO_TIME;
+
+sc_time simulation_time() {
+	return sc_time_stamp() + simulation_time_offset;
+}
+
 
 // control in which modules log information is output during simulation
 /* theses defines ar in globaldefs.h
@@ -46,48 +58,295 @@ unsigned int CPU_VERIFY_HEADER_CYCLES = 50;
 unsigned int CPU_DECREMENT_TTL_CYCLES = 5;
 unsigned int CPU_UPDATE_CHECKSUM_CYCLES = 30;
 unsigned int CPU_IP_LOOKUP_CYCLES = 350;
+unsigned int ACC_MEMORY_READ_CYCLES = 2;
+unsigned int ACC_MEMORY_WRITE_CYCLES = 2;
+
+/// accelerator pipeline: stages, lookups in flight and request FIFO depth
+unsigned int acc_pipeline_stages = 1;
+unsigned int acc_lookups_in_flight = 1;
+unsigned int acc_request_depth = 9;
+
+/// lookup results are pushed into the mailboxes of the processors
+bool acc_result_push = false;
 
 
-/// number of mac units, fix for the laboratory system
-const unsigned int nMacs = 4;
+/// number of mac units, 4 in the laboratory system, set with init_address_map()
+unsigned int nMacs = 4;
 
 /// number of packets that can be stored in the memory
 unsigned int n_memory_slots = 128;
 
+/// fixed slots by default
+std::vector<buffer_class> buffer_classes;
+
+/// number of receive queues, 1: all the processors share the packets
+unsigned int n_rx_queues = 1;
+
+/// descriptors per descriptor transaction of the processors
+unsigned int cpu_descriptor_batch = 1;
+
+/// interrupt moderation, by default an interrupt for every packet
+unsigned int rx_irq_packets = 1;
+sc_time rx_irq_time = SC_ZERO_TIME;
+
+/// packets per poll of the processors, 0: interrupt driven
+unsigned int napi_budget = 0;
+
+/// descriptor FIFOs in the IO module by default
+bool descriptor_rings = false;
+unsigned int ring_writeback_batch = 1;
+unsigned int ring_doorbell_batch = 1;
+
 /// width of bus in bytes
 unsigned int bus_width = 8;
 
+/// arbitration policy of the bus
+arbitration_policy bus_arbitration = ARBITRATION_ROUND_ROBIN;
+
+/// max. number of bus cycles a transaction holds the bus, 0: no limit
+unsigned int bus_max_burst = 0;
+
+/// weight or priority of each bus master
+std::vector<unsigned int> bus_weights;
+
+/// number of bus transactions a DMA channel can have in flight at the same time
+unsigned int dma_outstanding_transactions = 1;
+
+/// split received packets into a header and a payload segment
+bool dma_header_split = false;
+
+/// the DMA channels and the CPUs access the RAM through DMI
+bool use_dmi = false;
+
+/// blocking transactions with temporal decoupling instead of the 2-phase AT protocol
+bool loosely_timed = false;
 
+/// global quantum of the temporal decoupling
+sc_time lt_quantum = sc_time(1, SC_US);
 
-// slaves' addresses
+/// size of a header buffer
+const unsigned int HEADER_BUFFER_SIZE = 128;
+
+
+
+// slaves' addresses, the values for 4 MACs, see init_address_map()
+/// the bus decodes the slave from the address bits above this one
+unsigned int address_port_shift = 28;
 /// memory based address
 const soc_address_t MEMORY_BASE_ADDRESS = 0x00000000;
 /// Address of the read-only register of the DMA module,
 /// packet descriptors can be read from here
-const soc_address_t PROCESSOR_QUEUE_ADDRESS = 0x10000000;
+soc_address_t PROCESSOR_QUEUE_ADDRESS = 0x10000000;
 /// Write-only DMA config register, post a packet_descriptor here to free a memory slot without
 /// transferring data.
-const soc_address_t DISCARD_QUEUE_ADDRESS = PROCESSOR_QUEUE_ADDRESS;
+soc_address_t DISCARD_QUEUE_ADDRESS = 0x10000000;
 /// DMA channel 0 write-only config register, write packet_descriptor here to transfer packet.
-const soc_address_t OUTPUT_0_ADDRESS = 0x20000000;
+soc_address_t OUTPUT_0_ADDRESS = 0x20000000;
 /// DMA channel 1 write-only config register, write packet_descriptor here to transfer packet.
-const soc_address_t OUTPUT_1_ADDRESS = 0x30000000;
+soc_address_t OUTPUT_1_ADDRESS = 0x30000000;
 /// DMA channel 2 write-only config register, write packet_descriptor here to transfer packet.
-const soc_address_t OUTPUT_2_ADDRESS = 0x40000000;
+soc_address_t OUTPUT_2_ADDRESS = 0x40000000;
 /// DMA channel 3 write-only config register, write packet_descriptor here to transfer packet.
-const soc_address_t OUTPUT_3_ADDRESS = 0x50000000;
+soc_address_t OUTPUT_3_ADDRESS = 0x50000000;
 /// The address of the accelerator int the system.
-const soc_address_t ACCELERATOR_ADDRESS = 0x60000000;
+soc_address_t ACCELERATOR_ADDRESS = 0x60000000;
+
+soc_address_t output_address(unsigned int mac) {
+	return (soc_address_t) (2 + mac) << address_port_shift;
+}
+
+soc_address_t accelerator_result_address(unsigned int processor_id) {
+	return ACCELERATOR_ADDRESS + processor_id * sizeof(unsigned int);
+}
+
+soc_address_t rx_queue_address(unsigned int queue) {
+	return PROCESSOR_QUEUE_ADDRESS + queue * sizeof(packet_descriptor);
+}
+
+unsigned int rx_queue_of_cpu(unsigned int cpu) {
+	return cpu % n_rx_queues;
+}
+
+const soc_address_t RX_IRQ_CONTROL_OFFSET = 0x10000;
+
+soc_address_t rx_queue_irq_address(unsigned int queue) {
+	return PROCESSOR_QUEUE_ADDRESS + RX_IRQ_CONTROL_OFFSET + queue * sizeof(unsigned int);
+}
+
+const soc_address_t TX_DOORBELL_OFFSET = 0x10000;
+
+unsigned int ring_entries() {
+	return n_packet_buffers();
+}
+
+/// size of the packet memory and the header buffers, the rings follow them
+static sc_dt::uint64 packet_buffers_size() {
+	return (sc_dt::uint64) n_memory_slots * IpPacket::PACKET_MAX_SIZE + (dma_header_split
+			? (sc_dt::uint64) n_packet_buffers() * HEADER_BUFFER_SIZE : 0);
+}
+
+/// address of a ring, the receive rings come first, then the transmit rings per channel
+static soc_address_t ring_address(unsigned int ring) {
+	return MEMORY_BASE_ADDRESS + packet_buffers_size() + ring * ring_entries()
+			* sizeof(packet_descriptor);
+}
+
+soc_address_t rx_ring_address(unsigned int queue) {
+	return ring_address(queue);
+}
+
+soc_address_t tx_ring_address(unsigned int mac, unsigned int cpu) {
+	return ring_address(n_rx_queues + mac * n_cpus + cpu);
+}
+
+soc_address_t tx_doorbell_address(unsigned int mac, unsigned int cpu) {
+	return output_address(mac) + TX_DOORBELL_OFFSET + cpu * sizeof(unsigned int);
+}
+
+void init_address_map(unsigned int n_macs) {
+	assert(n_macs > 0);
+	nMacs = n_macs;
+
+	// RAM, memory manager, DMA channels and accelerator;
+	// at least 4 bits, so that 4 MACs keep the original addresses
+	unsigned int bits = 4;
+	while ((1u << bits) < n_macs + 3) {
+		bits++;
+	}
+	address_port_shift = 32 - bits;
+
+	PROCESSOR_QUEUE_ADDRESS = (soc_address_t) 1 << address_port_shift;
+	DISCARD_QUEUE_ADDRESS = PROCESSOR_QUEUE_ADDRESS;
+	OUTPUT_0_ADDRESS = output_address(0);
+	OUTPUT_1_ADDRESS = output_address(1);
+	OUTPUT_2_ADDRESS = output_address(2);
+	OUTPUT_3_ADDRESS = output_address(3);
+	ACCELERATOR_ADDRESS = output_address(n_macs);
+}
+
+/// orders the buffer classes by size
+static bool smaller_buffers(const buffer_class& a, const buffer_class& b) {
+	return a.size < b.size;
+}
+
+bool init_buffer_classes(const std::string& spec) {
+	unsigned int memory = n_memory_slots * IpPacket::PACKET_MAX_SIZE;
+	unsigned int percent_total = 0;
+	std::string::size_type begin = 0, end;
+	buffer_classes.clear();
+	do {
+		end = spec.find(',', begin);
+		std::string pair = spec.substr(begin, end == std::string::npos ? end : end - begin);
+		begin = end + 1;
+		std::string::size_type colon = pair.find(':');
+		if (colon == std::string::npos) {
+			buffer_classes.clear();
+			return false;
+		}
+		buffer_class c;
+		// whole bus words, so that the buffers stay aligned
+		c.size = (atoi(pair.substr(0, colon).c_str()) + 3) & ~3u;
+		unsigned int percent = atoi(pair.substr(colon + 1).c_str());
+		c.count = c.size > 0 ? (sc_dt::uint64) memory * percent / 100 / c.size : 0;
+		percent_total += percent;
+		if (c.count == 0) {
+			buffer_classes.clear();
+			return false;
+		}
+		buffer_classes.push_back(c);
+	} while (end != std::string::npos);
+
+	std::sort(buffer_classes.begin(), buffer_classes.end(), smaller_buffers);
+	if (percent_total > 100 || buffer_classes.back().size < IpPacket::PACKET_MAX_SIZE) {
+		buffer_classes.clear();
+		return false;
+	}
+	return true;
+}
+
+std::vector<buffer_class> packet_buffer_classes() {
+	if (!buffer_classes.empty()) {
+		return buffer_classes;
+	}
+	buffer_class slots = { IpPacket::PACKET_MAX_SIZE, n_memory_slots };
+	return std::vector<buffer_class>(1, slots);
+}
+
+unsigned int n_packet_buffers() {
+	if (buffer_classes.empty()) {
+		return n_memory_slots;
+	}
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < buffer_classes.size(); i++) {
+		n += buffer_classes[i].count;
+	}
+	return n;
+}
+
+unsigned int packet_buffer_index(soc_address_t address) {
+	unsigned int offset = address - MEMORY_BASE_ADDRESS;
+	if (buffer_classes.empty()) {
+		return offset / IpPacket::PACKET_MAX_SIZE;
+	}
+	unsigned int index = 0;
+	for (unsigned int i = 0; i < buffer_classes.size(); i++) {
+		const buffer_class& c = buffer_classes[i];
+		if (offset < c.size * c.count) {
+			return index + offset / c.size;
+		}
+		offset -= c.size * c.count;
+		index += c.count;
+	}
+	assert(0);
+	return index;
+}
+
+soc_address_t packet_buffer_address(unsigned int index) {
+	if (buffer_classes.empty()) {
+		return MEMORY_BASE_ADDRESS + index * IpPacket::PACKET_MAX_SIZE;
+	}
+	soc_address_t address = MEMORY_BASE_ADDRESS;
+	for (unsigned int i = 0; i < buffer_classes.size(); i++) {
+		const buffer_class& c = buffer_classes[i];
+		if (index < c.count) {
+			return address + index * c.size;
+		}
+		address += c.size * c.count;
+		index -= c.count;
+	}
+	assert(0);
+	return address;
+}
+
+soc_address_t header_buffer_address(soc_address_t slot_address) {
+	return MEMORY_BASE_ADDRESS + n_memory_slots * IpPacket::PACKET_MAX_SIZE
+			+ packet_buffer_index(slot_address) * HEADER_BUFFER_SIZE;
+}
+
+sc_dt::uint64 ram_size() {
+	if (!descriptor_rings) {
+		return packet_buffers_size();
+	}
+	return packet_buffers_size() + (sc_dt::uint64) (n_rx_queues + nMacs * n_cpus)
+			* ring_entries() * sizeof(packet_descriptor);
+}
 
 
 // files
 const char lutConfigFile[] = "../config/lut_entries";
+const char lutUpdateFile[] = "../config/lut_updates";
 
 const char pcapFile0[] = "../PCAP_samples/p0.pcap";
 const char pcapFile1[] = "../PCAP_samples/p1.pcap";
 const char pcapFile2[] = "../PCAP_samples/p2.pcap";
 const char pcapFile3[] = "../PCAP_samples/p3.pcap";
 
+/// PCAP files replayed by the ports, the sample files if empty
+std::vector<std::string> pcap_files;
+
+/// keep the packet index of the PCAP files in sidecar files (<file>.idx)
+bool cache_pcap_index = false;
+
 
 // statistics
 unsigned long long int n_packets_received = 0;
@@ -122,3 +381,4 @@ void initialize_statistics() {
 	min_latency = sc_core::sc_time(1000000000.0, SC_MS);
 	total_latency = SC_ZERO_TIME;
 }
+
@@ -97,9 +97,7 @@ void memory::operation(tlm::tlm_generic_payload &gp, sc_core::sc_time &delay_tim
 		///
 	case tlm::TLM_WRITE_COMMAND: {
 		if (response_status == tlm::TLM_OK_RESPONSE) {
-			for (unsigned int i = 0; i < length; i++) {
-				m_memory[address++] = data[i]; // move the data to memory
-			}
+			memcpy(&m_memory[address], data, length); // move the data to memory
 			delay_time = delay_time + m_write_delay;
 		}
 		break;
@@ -107,9 +105,7 @@ void memory::operation(tlm::tlm_generic_payload &gp, sc_core::sc_time &delay_tim
 
 	case tlm::TLM_READ_COMMAND: {
 		if (response_status == tlm::TLM_OK_RESPONSE) {
-			for (unsigned int i = 0; i < length; i++) {
-				data[i] = m_memory[address++]; // move the data to memory
-			}
+			memcpy(data, &m_memory[address], length); // move the data from memory
 			delay_time = delay_time + m_read_delay;
 		}
 		break;
@@ -134,6 +130,18 @@ unsigned char* memory::get_mem_ptr(void) {
 	return m_memory;
 }
 
+sc_dt::uint64 memory::get_size(void) const {
+	return m_memory_size;
+}
+
+sc_time memory::get_read_delay(void) const {
+	return m_read_delay;
+}
+
+sc_time memory::get_write_delay(void) const {
+	return m_write_delay;
+}
+
 //==============================================================================
 ///  @fn memory::get_delay
 //  
@@ -194,13 +202,13 @@ tlm::tlm_response_status memory::check_address(tlm::tlm_generic_payload &gp) {
 	std::ostringstream msg;
 	msg.str("");
 
-	if ((address < 0) || (address >= m_memory_size)) {
+	if (address >= m_memory_size) {
 		msg << name() << " address out-of-range";
 		REPORT_WARNING(filename, __FUNCTION__, msg.str());
 
 		return tlm::TLM_ADDRESS_ERROR_RESPONSE; // operation response
 	} else {
-		if ((address + length) >= m_memory_size) {
+		if ((address + length) > m_memory_size) {
 			msg << name() << " address will go out of bounds";
 			REPORT_WARNING(filename, __FUNCTION__, msg.str());
 
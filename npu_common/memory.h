@@ -87,6 +87,15 @@ public:
 
 	unsigned char* get_mem_ptr(void);
 
+	/// size of the memory in bytes
+	sc_dt::uint64 get_size(void) const;
+
+	/// delay of a read, e.g. the read latency of a DMI region
+	sc_time get_read_delay(void) const;
+
+	/// delay of a write, e.g. the write latency of a DMI region
+	sc_time get_write_delay(void) const;
+
 private:
 
 	/// Check the address vs. range passed at construction
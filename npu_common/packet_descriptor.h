@@ -8,16 +8,92 @@
 #ifndef PACKET_DESCRIPTOR_H_
 #define PACKET_DESCRIPTOR_H_
 
+/// a contiguous part of a packet in the RAM
+struct dma_segment {
+		soc_address_t address;
+		unsigned int size;
+	};
+
+/**
+ * Describes a packet in the RAM.
+ *
+ * The memory image of the packet (see IpPacket::DATA_OFFSET) is stored in n_segments
+ * scatter-gather segments, in order. baseAddress is the memory slot of the packet, it
+ * identifies the packet when the slot is freed, size is the sum of the segment sizes.
+ *
+ * Without header split (see dma_header_split) there is a single segment at baseAddress.
+ * With header split segment[0] is the header segment, which holds data_size, the reception
+ * time and the IP header, in the header buffer of the slot; segment[1] is the rest of the
+ * packet at baseAddress. The processors read and write back only segment[0].
+ */
 struct packet_descriptor {
+		/// max. number of segments of a packet
+		static const unsigned int MAX_SEGMENTS = 2;
+
 		soc_address_t baseAddress;
 		unsigned int size;
+		unsigned int n_segments;
+		dma_segment segment[MAX_SEGMENTS];
+
+		/// address of the part of the packet that the processors work on
+		soc_address_t header_address() const { return segment[0].address; }
+		/// size of the part of the packet that the processors work on
+		unsigned int header_size() const { return segment[0].size; }
 	};
 
+/*
+ * A batch of packet descriptors moves several descriptors in one bus transaction: a
+ * receive queue read returns up to the capacity of the batch, a transfer or discard
+ * write posts all of them. Its data is the number of descriptors in the batch, followed
+ * by the descriptors. A transaction of sizeof(packet_descriptor) is a single descriptor.
+ */
+/// size of the data of a batch of n descriptors
+inline unsigned int descriptor_batch_size(unsigned int n) {
+	return sizeof(unsigned int) + n * sizeof(packet_descriptor);
+}
+
+/// number of descriptors a batch of the given size holds, 0 if the size is not a batch
+inline unsigned int descriptor_batch_capacity(unsigned int length) {
+	if (length < descriptor_batch_size(1)
+			|| (length - sizeof(unsigned int)) % sizeof(packet_descriptor) != 0) {
+		return 0;
+	}
+	return (length - sizeof(unsigned int)) / sizeof(packet_descriptor);
+}
+
+/// the data length of a transaction is a single descriptor or a batch
+inline bool is_descriptor_length(unsigned int length) {
+	return length == sizeof(packet_descriptor) || descriptor_batch_capacity(length) > 0;
+}
+
+/// number of descriptors in the batch at data
+inline unsigned int& descriptor_batch_count(unsigned char* data) {
+	return *reinterpret_cast<unsigned int*> (data);
+}
+
+/// the descriptors of the batch at data
+inline packet_descriptor* descriptor_batch_entries(unsigned char* data) {
+	return reinterpret_cast<packet_descriptor*> (data + sizeof(unsigned int));
+}
+
+/**
+ * Data of a receive queue read with descriptor_rings: the processor sets count to the
+ * max. number of descriptors it takes, the memory manager answers with the RAM address of
+ * the first ring entry claimed and the number of entries claimed, which are contiguous.
+ */
+struct ring_claim {
+		soc_address_t address;
+		unsigned int count;
+	};
 
 inline std::ostream& operator<<(std::ostream& o,
 		const packet_descriptor& desc) {
 	o << "packet @" << std::hex << desc.baseAddress << ".." << desc.baseAddress
 			+ desc.size << std::dec;
+	for (unsigned int i = 0; desc.n_segments > 1 && i < desc.n_segments; i++) {
+		o << (i == 0 ? " [" : ", ") << std::hex << desc.segment[i].address << std::dec
+				<< "+" << desc.segment[i].size << (i + 1 == desc.n_segments ? "]" : "");
+	}
 	return o;
 }
 
@@ -0,0 +1,319 @@
+/**
+ * @file	Accelerator.cpp
+ *
+ * @date	Apr 18, 2011
+ * @author	Miklos Kirilly
+ */
+
+#include "Accelerator.h"
+#include "globaldefs.h"
+#include "reporting.h"
+
+using namespace sc_core;
+using namespace std;
+
+Accelerator::Accelerator(sc_module_name nm, unsigned int lookup_cycles) :
+	sc_module(nm),
+	target_socket("target_socket"),
+        // Initialize requests depth and call other constructors
+	 requests(acc_request_depth),
+         m_pipeline("pipeline"),
+         rt(RoutingTableRef::shared(lutConfigFile, '|', RoutingTable::DIR_24_8)),
+         transaction_queue("transaction_queue"),
+         n_lookups(0),
+         m_max_in_flight(0),
+         n_updates(0),
+         ACC_IP_LOOKUP_CYCLES(lookup_cycles)
+{
+
+	/// provide an interrupt line per CPU
+	irq = new sc_out<bool>[n_cpus];
+	mailbox = new sc_fifo_out<unsigned int>[n_cpus];
+
+	/// the result registers, and the lookups that can be in the pipeline
+	m_result.assign(n_cpus, 0);
+	m_result_valid.assign(n_cpus, false);
+	m_lookups.resize(acc_lookups_in_flight > 0 ? acc_lookups_in_flight : 1);
+	for (unsigned int i = 0; i < m_lookups.size(); i++) {
+		m_free_lookups.push_back(&m_lookups[i]);
+	}
+
+	/// register nonblocking callback with the target socket
+	target_socket.register_nb_transport_fw(this,&Accelerator::nb_transport_fw);
+	target_socket.register_b_transport(this,&Accelerator::b_transport);
+
+	/// register threads
+	SC_THREAD(accelerator_thread);
+	SC_THREAD(result_thread);
+	SC_METHOD(mailbox_read_method);
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		sensitive << mailbox[i].data_read();
+	}
+	dont_initialize();
+	SC_THREAD(transaction_thread);
+	SC_THREAD(update_thread);
+
+	/// report the memory traded for the lookup speed
+	cout << name() << " ";
+	rt->output_memory_usage();
+}
+
+
+void Accelerator::accelerator_thread() {
+	LookupRequest req;
+	sc_time processing_start_time;
+	unsigned int memory_reads;
+
+	while (true) {
+		// Get next request.
+		// Blocking call waits if none is present.
+		req = requests.read();
+
+		// wait until a lookup leaves the pipeline if it is full
+		while (m_free_lookups.empty()) {
+			wait(lookup_finished_event);
+		}
+		Lookup* lookup = m_free_lookups.back();
+		m_free_lookups.pop_back();
+		lookup->processorId = req.processorId;
+		unsigned int in_flight = m_lookups.size() - m_free_lookups.size();
+		if (in_flight > m_max_in_flight)
+			m_max_in_flight = in_flight;
+
+		// processing starts, log time
+		processing_start_time = sc_time_stamp();
+
+		// the table cannot be read while a route update is written
+		table_mutex.lock();
+		total_stall_time += (sc_time_stamp() - processing_start_time);
+
+		// do lookup, the DIR-24-8 pipeline needs one or two table reads
+		lookup->out_port_id = rt->getNextHop(req.destAddress, memory_reads);
+		unsigned int cycles = ACC_IP_LOOKUP_CYCLES + memory_reads * ACC_MEMORY_READ_CYCLES;
+
+		// the first stage takes its share of the cycles, then the next lookup can start
+		unsigned int stage_cycles = (cycles + acc_pipeline_stages - 1) / acc_pipeline_stages;
+		wait(stage_cycles * CLK_CYCLE_ACC);
+		table_mutex.unlock();
+
+		// the lookup finishes in the other stages
+		m_pipeline.notify(*lookup, (cycles - stage_cycles) * CLK_CYCLE_ACC);
+		n_lookups++;
+
+		// the first stage is free, increase total_processing_time
+		total_processing_time += (sc_time_stamp() - processing_start_time);
+	}
+}
+
+void Accelerator::result_thread() {
+	// interrupt lines cleared in this activation
+	std::vector<bool> cleared(n_cpus);
+
+	// initially clear all irq lines
+	for (unsigned i = 0; i < n_cpus ; i++){
+		irq[i].write(false);
+	}
+
+	while (true) {
+		wait(m_pipeline.get_event() | result_read_event);
+
+		// clear the interrupt lines of the results read
+		for (unsigned int i = 0; i < n_cpus; i++) {
+			cleared[i] = !m_result_valid[i] && irq[i].read();
+			if (cleared[i]) {
+				irq[i].write(false);
+
+				if(do_logging & LOG_ACC)
+					cout << sc_time_stamp()<<" "<<name() << " result of processor " << i << " was read." << endl;
+			}
+		}
+
+		Lookup* lookup;
+		while ((lookup = m_pipeline.get_next_transaction()) != 0) {
+			m_finished.push_back(lookup);
+		}
+
+		// Put the finished lookups into the free result registers. A line cleared now
+		// is set again a delta cycle later, so that the processor sees a new edge.
+		for (unsigned int i = 0; i < m_finished.size();) {
+			lookup = m_finished[i];
+			unsigned int id = lookup->processorId;
+			if (acc_result_push) {
+				// no interrupt, the processor takes the result from its mailbox
+				if (!mailbox[id]->nb_write(lookup->out_port_id)) {
+					i++;
+					continue;
+				}
+			} else {
+				if (m_result_valid[id] || cleared[id]) {
+					if (cleared[id])
+						result_read_event.notify(SC_ZERO_TIME);
+					i++;
+					continue;
+				}
+				m_result[id] = lookup->out_port_id;
+				m_result_valid[id] = true;
+				irq[id].write(true);
+			}
+
+			m_finished.erase(m_finished.begin() + i);
+			m_free_lookups.push_back(lookup);
+			lookup_finished_event.notify(SC_ZERO_TIME);
+		}
+	}
+}
+
+void Accelerator::mailbox_read_method() {
+	// a mailbox has room, a waiting result can be pushed
+	result_read_event.notify(SC_ZERO_TIME);
+}
+
+void Accelerator::update_thread() {
+	vector<RoutingTable::Update> updates = RoutingTable::readUpdates(lutUpdateFile, '|');
+	unsigned int memory_writes;
+	sc_time update_start_time;
+
+	for (unsigned int i = 0; i < updates.size(); i++) {
+		// wait for the scheduled time of the update,
+		// after a restored checkpoint the earlier updates are applied at once
+		sc_time update_time((double) updates[i].time, SC_NS);
+		if (update_time > simulation_time()) {
+			wait(update_time - simulation_time());
+		}
+
+		// a running lookup finishes first
+		table_mutex.lock();
+		update_start_time = sc_time_stamp();
+
+		// the first update detaches the table from other users (copy-on-write)
+		bool success = updates[i].withdraw
+				? rt.modify().removeRoute(updates[i].netAddress, updates[i].subnetMask,
+						memory_writes)
+				: rt.modify().addRoute(updates[i].netAddress, updates[i].subnetMask,
+						updates[i].nextHop, memory_writes);
+		wait(memory_writes * ACC_MEMORY_WRITE_CYCLES * CLK_CYCLE_ACC);
+
+		table_mutex.unlock();
+		total_update_time += (sc_time_stamp() - update_start_time);
+		n_updates++;
+
+		if(do_logging & LOG_ACC)
+			cout << sc_time_stamp() << " " << name()
+					<< (updates[i].withdraw ? " withdrew" : " announced") << " route, " << memory_writes << " table writes"
+					<< (success ? "" : ", failed") << endl;
+	}
+}
+
+void Accelerator::transaction_thread() {
+	// pointer to the payload from the PEQ
+	tlm_generic_payload* payload_ptr;
+
+	while (true) {
+		// wait until there's transaction received
+		wait(transaction_queue.get_event());
+
+		// read all transactions until the queue is empty
+		while ((payload_ptr = transaction_queue.get_next_transaction()) != 0) {
+
+			execute_transaction(*payload_ptr);
+
+			// call backward path to begin response
+			tlm_phase phase = BEGIN_RESP;
+			sc_time delay = SC_ZERO_TIME;
+			tlm_sync_enum sync; // return value of the bw call
+			sync = target_socket->nb_transport_bw(*payload_ptr, phase, delay);
+
+			// assert transaction completed
+			assert((sync == TLM_COMPLETED) && (phase == END_RESP));
+
+			// wait for the annotated time
+			wait( delay );
+		}
+	}
+}
+
+void Accelerator::execute_transaction(tlm_generic_payload& payload) {
+	if (payload.is_write()) {
+
+		// assert that the size of payload data is correct
+		assert(payload.get_data_length() == sizeof(LookupRequest));
+
+		// nonblocking write checks if the buffer is full
+		bool write_success = requests.nb_write(*(LookupRequest*) payload.get_data_ptr());
+
+		// set response status accordingly
+		write_success ? payload.set_response_status(TLM_OK_RESPONSE) // there's enough buffer left
+				: payload.set_response_status(TLM_INCOMPLETE_RESPONSE); // buffer full
+
+	} else if (payload.is_read()) {
+		// assert that the size of payload data is correct
+		assert(payload.get_data_length() == sizeof(unsigned int));
+
+		// the result register of the processor, see accelerator_result_address()
+		unsigned int processor = payload.get_address() / sizeof(unsigned int);
+		if (processor >= n_cpus) {
+			payload.set_response_status(TLM_ADDRESS_ERROR_RESPONSE);
+			return;
+		}
+
+		// copy result to payload data
+		*(unsigned int*)payload.get_data_ptr() = m_result[processor];
+		m_result_valid[processor] = false;
+
+		// set response status
+		payload.set_response_status(TLM_OK_RESPONSE);
+
+		// Signal to the result_thread with no delay.
+		result_read_event.notify(SC_ZERO_TIME);
+	}
+}
+
+sc_time Accelerator::get_accept_delay(const tlm_generic_payload& payload) const {
+	if (payload.is_write())
+		// data amount that has been written determines the delay
+		return (int)((payload.get_data_length()+bus_width-1)/bus_width)*CLK_CYCLE_BUS;
+	else
+		return CLK_CYCLE_BUS; // one cycle delay to acknowledge request to the bus
+}
+
+void Accelerator::b_transport(tlm_generic_payload& payload, sc_time& delay) {
+	if(do_logging & LOG_ACC)
+		cout << sc_time_stamp()<<" "<<name() << " received request, b_transport." << endl;
+
+	delay += get_accept_delay(payload);
+	execute_transaction(payload);
+}
+
+tlm_sync_enum Accelerator::nb_transport_fw(tlm_generic_payload& payload,
+		tlm_phase& phase, sc_time& delay) {
+
+	if(do_logging & LOG_ACC)
+		cout << sc_time_stamp()<<" "<<name() << " received request." << endl;
+
+	// update params
+	delay += get_accept_delay(payload);
+
+
+	transaction_queue.notify(payload, delay);
+
+	phase = END_REQ; // end of request phase
+
+	if(do_logging & LOG_ACC)
+		cout << "\t"<<name()<<": trans " << &payload << "received, phase " << report::print(
+		phase) << (payload.is_write()?" Read":" Write") <<", delay " << delay << std::endl;
+
+	return TLM_UPDATED; // parameters modified but transaction not yet finished
+
+}
+
+void Accelerator::output_load() const {
+	cout << name() << " total processing time: " << total_processing_time << endl;
+	cout << name() << fixed << setprecision(1) << " load: processing "
+			<< (total_processing_time) / (sc_time_stamp()) * 100 << "%." << endl;
+	cout << name() << " lookups: " << n_lookups << ", " << acc_pipeline_stages
+			<< " pipeline stages, max. " << m_max_in_flight << " of "
+			<< m_lookups.size() << " in flight, results "
+			<< (acc_result_push ? "pushed to the mailboxes" : "read on the bus") << endl;
+	cout << name() << " route updates: " << n_updates << ", writing the table: "
+			<< total_update_time << ", lookups stalled: " << total_stall_time << endl;
+}
@@ -0,0 +1,192 @@
+/**
+ * @file	Accelerator.h
+ *
+ * @date	Apr 18, 2011
+ * @author	Miklos Kirilly
+ */
+
+#ifndef ACCELERATOR_H_
+#define ACCELERATOR_H_
+
+#include <map>
+#include <vector>
+#include <tlm.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <tlm_utils/peq_with_get.h>
+
+#include "globaldefs.h"
+#include "RoutingTable.h"
+
+using namespace tlm;
+using namespace sc_core;
+using namespace tlm_utils;
+
+/**
+ * @class Accelerator
+ * HW accelerator module for packet routing.
+ * The Accelerator starts operation if a
+ *
+ * It is a slave module, and it accepts write commands with a LookupTable as payload
+ * and read commands with a single unsigned int as payload.
+ *
+ * The lookup engine is pipelined: a lookup takes ACC_IP_LOOKUP_CYCLES plus the table
+ * reads, but the next one can start after 1/acc_pipeline_stages of that, so up to
+ * acc_lookups_in_flight lookups are processed at the same time. Each processor has its
+ * own result register at accelerator_result_address(), so the engine does not wait
+ * for the processors to read the results. A finished lookup waits in the pipeline only
+ * if the previous result of its processor was not yet read.
+ *
+ * With acc_result_push the result is written into the mailbox of the processor instead,
+ * a local FIFO that it reads without a bus transaction, and no interrupt is raised.
+ */
+SC_MODULE(Accelerator) {
+/*
+public:
+	//
+	// struct to hold the important parameters of requesting
+	// routing table lookup
+	//
+	struct LookupRequest {
+		/// destination address of the IP packet
+		unsigned int destAddress;
+
+		/// Unique ID identifying the processor, it has to be the same number as
+		/// the index of IRQ line of the processor in Accelerator::irq.
+		unsigned int processorId;
+	};
+*/
+public:
+	/// target socket
+	simple_target_socket<Accelerator> target_socket;
+
+	/// Interrupt lines to the processors. Array size is defined by global variable @ref n_cpus.
+	sc_out<bool> *irq;
+
+	/// Mailboxes of the processors, used with acc_result_push. Array size is @ref n_cpus.
+	sc_fifo_out<unsigned int> *mailbox;
+private:
+
+	/// buffer for requests, acc_request_depth deep
+	sc_fifo<LookupRequest> requests;
+
+	/// a lookup in the pipeline
+	struct Lookup {
+		/// the processor that requested it
+		unsigned int processorId;
+		/// its result
+		unsigned int out_port_id;
+	};
+
+	/// acc_lookups_in_flight lookups, for the pipeline
+	std::vector<Lookup> m_lookups;
+
+	/// lookups not in the pipeline
+	std::vector<Lookup*> m_free_lookups;
+
+	/// lookups leave the pipeline at the time they finish
+	peq_with_get<Lookup> m_pipeline;
+
+	/// finished lookups waiting for the result register of their processor
+	std::vector<Lookup*> m_finished;
+
+	/// result register of each processor
+	std::vector<unsigned int> m_result;
+
+	/// the result register of the processor holds a result not read yet
+	std::vector<bool> m_result_valid;
+
+	/// routing table, direct indexed (DIR-24-8) like in lookup hardware
+	RoutingTableRef rt;
+
+	peq_with_get<tlm_generic_payload> transaction_queue;
+
+	/// Event signalled from the transaction_thread to the result_thread
+	/// when the result of a lookup is read by a processor.
+	sc_event result_read_event;
+
+	/// Event signalled by the result_thread when a lookup leaves the pipeline.
+	sc_event lookup_finished_event;
+
+	/// number of lookups done
+	unsigned int n_lookups;
+
+	/// max. number of lookups in the pipeline at the same time
+	unsigned int m_max_in_flight;
+
+	/// Time spent with computation.
+	sc_time total_processing_time;
+
+	/// Held while the routing table is read by a lookup or written by an update.
+	sc_mutex table_mutex;
+
+	/// Time spent writing route updates into the table.
+	sc_time total_update_time;
+
+	/// Time lookups waited for route updates to finish.
+	sc_time total_stall_time;
+
+	/// number of route updates applied
+	unsigned int n_updates;
+
+	/// Time spent for accelerator lookup, without the table reads.
+	/// Each table read adds ACC_MEMORY_READ_CYCLES.
+	unsigned int ACC_IP_LOOKUP_CYCLES;
+
+
+private:
+	/// the first pipeline stage, starts the lookups of the requests
+	void accelerator_thread();
+
+	/// Thread that puts the finished lookups into the result registers and drives
+	/// the interrupt lines, or pushes them into the mailboxes.
+	void result_thread();
+
+	/// wakes the result_thread when a processor takes a result from its mailbox
+	void mailbox_read_method();
+
+	/// Thread that applies the route updates of @ref lutUpdateFile at their
+	/// scheduled times. Lookups stall while the table is written.
+	void update_thread();
+
+	/// Thread that takes transactions from the PEQ, answers them and puts the payload data
+	/// into the FIFO.
+	void transaction_thread();
+
+	/// nonblocking forward path callback
+	tlm_sync_enum nb_transport_fw(tlm_generic_payload& payload, tlm_phase& phase,
+			sc_time& delay);
+
+	/// blocking forward path callback, used in loosely_timed mode
+	void b_transport(tlm_generic_payload& payload, sc_time& delay);
+
+	/// the time the accelerator takes to accept the data of a transaction
+	sc_time get_accept_delay(const tlm_generic_payload& payload) const;
+
+	/// puts a request into the FIFO or returns the result, sets the response status
+	void execute_transaction(tlm_generic_payload& payload);
+public:
+	/**
+	 * print the load of the module
+	 */
+	void output_load() const;
+
+	SC_HAS_PROCESS(Accelerator);
+
+	/**
+	 * @param nm - name of the module
+	 * @param lookup_cycles - accelerator cycles of a lookup, see ACC_IP_LOOKUP_CYCLES
+	 */
+	Accelerator(sc_module_name nm, unsigned int lookup_cycles);
+
+	/** Destructor, frees memory allocated for irq. */
+	~Accelerator(){ delete[] irq; delete[] mailbox; }
+};
+/**
+ * outstream operator required to compile
+
+inline std::ostream& operator<<(std::ostream& o, const Accelerator::LookupRequest& req) {
+	o << "processor: " << req.processorId << ", address: " << req.destAddress;
+	return o;
+}
+*/
+#endif /* ACCELERATOR_H_ */
@@ -0,0 +1,361 @@
+/**
+ * @file	Cpu.cpp
+ * Reference implementation of the processor of ex_8_9.
+ *
+ * It supports every option of the system: the accelerator with interrupt or mailbox
+ * results, DMI, the loosely-timed mode, descriptor batches, NAPI polling and descriptor
+ * rings. The measurements of the sweep files and of ex_8_9/lt_drift.sh are taken with
+ * it: build it here with make, and pass ../solution/processing_acc.x to sweep.x or
+ * lt_drift.sh with -x.
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ */
+
+#include "Cpu.h"
+#include "IoModule.h"
+#include "reporting.h"                              // Reporting convenience macros
+#include <algorithm>
+
+using namespace sc_core;
+using namespace tlm;
+using namespace std;
+
+///  filename for reporting
+static const char *filename = "Cpu.cpp";
+
+
+void Cpu::processor_thread(void) {
+	// the receive queue served by the processor
+	const unsigned int queue = rx_queue_of_cpu(m_id);
+
+	m_received.resize(cpu_descriptor_batch);
+	m_outgoing.resize(nMacs + 1);
+	m_batch_data.resize(descriptor_batch_size(cpu_descriptor_batch));
+	m_tx_index.assign(nMacs, 0);
+	m_tx_doorbell.assign(nMacs, 0);
+
+	while (true) {
+
+		//******************************************************
+		// wait for packets, the DMA channels get the
+		// transfer commands written so far meanwhile
+		//******************************************************
+		if (loosely_timed && !packetReceived_interrupt.read()) {
+			m_qk.sync();
+		}
+		if (!packetReceived_interrupt.read()) {
+			MEASURE_TRANSFER_TIME(
+				ringDoorbells(1);
+			)
+			waitForInterrupt(packetReceived_interrupt);
+		}
+
+		//******************************************************
+		// a read of the receive queue per interrupt
+		//******************************************************
+		if (napi_budget == 0) {
+			if (handleDescriptors(queue, cpu_descriptor_batch) == 0) {
+				// another processor of the queue was quicker
+				if (loosely_timed) {
+					m_qk.sync();
+				} else {
+					wait(CLK_CYCLE_CPU);
+				}
+			}
+			continue;
+		}
+
+		//******************************************************
+		// NAPI: poll the queue with the interrupt disabled,
+		// napi_budget packets per poll, until it is empty
+		//******************************************************
+		MEASURE_TRANSFER_TIME(
+			setInterruptEnable(queue, false);
+		)
+		unsigned int n;
+		do {
+			unsigned int polled = 0;
+			do {
+				n = handleDescriptors(queue,
+						min(cpu_descriptor_batch, napi_budget - polled));
+				polled += n;
+			} while (n > 0 && polled < napi_budget);
+			MEASURE_TRANSFER_TIME(
+				ringDoorbells(1);
+			)
+		} while (n > 0);
+		// a packet that came after the last read raises the interrupt at once
+		MEASURE_TRANSFER_TIME(
+			setInterruptEnable(queue, true);
+		)
+	}
+}
+
+unsigned int Cpu::handleDescriptors(unsigned int queue, unsigned int max) {
+	unsigned int n = readDescriptors(queue, max);
+
+	for (unsigned int i = 0; i < n; i++) {
+		m_packet_descriptor = m_received[i];
+		m_outgoing[processPacket()].push_back(m_packet_descriptor);
+	}
+
+	//*********************************************************
+	// Forward the packet descriptors to the output ports,
+	// drop the invalid packets
+	//*********************************************************
+	MEASURE_TRANSFER_TIME(
+		for (unsigned int port = 0; port < nMacs; port++) {
+			if (descriptor_rings) {
+				writeTxRing(port, m_outgoing[port]);
+			} else {
+				postDescriptors(output_address(port), m_outgoing[port]);
+			}
+			m_outgoing[port].clear();
+		}
+		postDescriptors(DISCARD_QUEUE_ADDRESS, m_outgoing[nMacs]);
+		m_outgoing[nMacs].clear();
+		if (descriptor_rings) {
+			ringDoorbells(ring_doorbell_batch);
+		}
+	)
+	return n;
+}
+
+unsigned int Cpu::readDescriptors(unsigned int queue, unsigned int max) {
+	unsigned int n = 0;
+
+	if (descriptor_rings) {
+		// claim ring entries, and read them from the RAM
+		ring_claim claim;
+		claim.address = 0;
+		claim.count = max;
+		MEASURE_TRANSFER_TIME(
+			startTransaction(TLM_READ_COMMAND, rx_queue_address(queue),
+					(unsigned char*) &claim, sizeof(ring_claim));
+			if (payload.get_response_status() == TLM_OK_RESPONSE && claim.count > 0) {
+				startTransaction(TLM_READ_COMMAND, claim.address,
+						(unsigned char*) &m_received[0],
+						claim.count * sizeof(packet_descriptor));
+				assert(payload.get_response_status() == TLM_OK_RESPONSE);
+				n = claim.count;
+			}
+		)
+	} else if (cpu_descriptor_batch > 1) {
+		MEASURE_TRANSFER_TIME(
+			startTransaction(TLM_READ_COMMAND, rx_queue_address(queue),
+					&m_batch_data[0], descriptor_batch_size(max));
+		)
+		if (payload.get_response_status() == TLM_OK_RESPONSE) {
+			n = descriptor_batch_count(&m_batch_data[0]);
+			copy(descriptor_batch_entries(&m_batch_data[0]),
+					descriptor_batch_entries(&m_batch_data[0]) + n, m_received.begin());
+		}
+	} else {
+		MEASURE_TRANSFER_TIME(
+			startTransaction(TLM_READ_COMMAND, rx_queue_address(queue),
+					(unsigned char*) &m_received[0], sizeof(packet_descriptor));
+		)
+		// the queue is empty if the read fails
+		n = payload.get_response_status() == TLM_OK_RESPONSE ? 1 : 0;
+	}
+	return n;
+}
+
+unsigned int Cpu::processPacket() {
+	// the header of the packet, or as much of it as the IpPacket holds
+	unsigned int header_size = min<unsigned int>(m_packet_descriptor.header_size(),
+			sizeof(IpPacket));
+
+	MEASURE_TRANSFER_TIME(
+		startTransaction(TLM_READ_COMMAND, m_packet_descriptor.header_address(),
+				(unsigned char*) &m_packet_header, header_size);
+	)
+
+	bool valid;
+	MEASURE_PROCESSING_TIME(
+		cpuWait(CPU_VERIFY_HEADER_CYCLES);
+		valid = verifyHeaderIntegrity(m_packet_header);
+	)
+	if (!valid) {
+		return nMacs;
+	}
+
+	unsigned int port = nMacs;
+	if (use_accelerator) {
+		m_lookup_request.destAddress = m_packet_header.getDestAddress();
+		m_lookup_request.processorId = m_id;
+		MEASURE_TRANSFER_TIME(
+			postCommand(ACCELERATOR_ADDRESS, (unsigned char*) &m_lookup_request,
+					sizeof(LookupRequest));
+		)
+		if (acc_result_push) {
+			if (loosely_timed) {
+				m_qk.sync();
+			}
+			MEASURE_TRANSFER_TIME(
+				port = lookupResult_mailbox.read();
+			)
+		} else {
+			MEASURE_TRANSFER_TIME(
+				waitForInterrupt(lookupReady_interrupt);
+				startTransaction(TLM_READ_COMMAND, accelerator_result_address(m_id),
+						(unsigned char*) &port, sizeof(unsigned int));
+			)
+		}
+	} else {
+		MEASURE_PROCESSING_TIME(
+			cpuWait(CPU_IP_LOOKUP_CYCLES);
+			port = makeNHLookup(m_packet_header);
+		)
+	}
+
+	MEASURE_PROCESSING_TIME(
+		cpuWait(CPU_DECREMENT_TTL_CYCLES + CPU_UPDATE_CHECKSUM_CYCLES);
+		decrementTTL(m_packet_header);
+		updateChecksum(m_packet_header);
+	)
+
+	MEASURE_TRANSFER_TIME(
+		startTransaction(TLM_WRITE_COMMAND, m_packet_descriptor.header_address(),
+				(unsigned char*) &m_packet_header, header_size);
+	)
+	return port < nMacs ? port : nMacs;
+}
+
+void Cpu::postDescriptors(soc_address_t address, std::vector<packet_descriptor>& descriptors) {
+	for (unsigned int i = 0; i < descriptors.size(); i += cpu_descriptor_batch) {
+		if (cpu_descriptor_batch == 1) {
+			postCommand(address, (unsigned char*) &descriptors[i], sizeof(packet_descriptor));
+			continue;
+		}
+		unsigned int n = min((unsigned int) descriptors.size() - i, cpu_descriptor_batch);
+		descriptor_batch_count(&m_batch_data[0]) = n;
+		copy(descriptors.begin() + i, descriptors.begin() + i + n,
+				descriptor_batch_entries(&m_batch_data[0]));
+		postCommand(address, &m_batch_data[0], descriptor_batch_size(n));
+	}
+}
+
+void Cpu::writeTxRing(unsigned int port, std::vector<packet_descriptor>& descriptors) {
+	// the ring has an entry per packet buffer, so it cannot overflow
+	for (unsigned int i = 0; i < descriptors.size();) {
+		// contiguous entries, up to the end of the ring
+		unsigned int entry = m_tx_index[port] % ring_entries();
+		unsigned int n = min((unsigned int) descriptors.size() - i, ring_entries() - entry);
+		startTransaction(TLM_WRITE_COMMAND,
+				tx_ring_address(port, m_id) + entry * sizeof(packet_descriptor),
+				(unsigned char*) &descriptors[i], n * sizeof(packet_descriptor));
+		assert(payload.get_response_status() == TLM_OK_RESPONSE);
+		m_tx_index[port] += n;
+		i += n;
+	}
+}
+
+void Cpu::ringDoorbells(unsigned int min_pending) {
+	for (unsigned int port = 0; port < m_tx_index.size(); port++) {
+		if (m_tx_index[port] - m_tx_doorbell[port] >= max(min_pending, 1u)) {
+			m_tx_doorbell[port] = m_tx_index[port];
+			startTransaction(TLM_WRITE_COMMAND, tx_doorbell_address(port, m_id),
+					(unsigned char*) &m_tx_doorbell[port], sizeof(unsigned int));
+		}
+	}
+}
+
+void Cpu::setInterruptEnable(unsigned int queue, bool enable) {
+	unsigned int value = enable ? 1 : 0;
+	startTransaction(TLM_WRITE_COMMAND, rx_queue_irq_address(queue),
+			(unsigned char*) &value, sizeof(unsigned int));
+}
+
+void Cpu::postCommand(soc_address_t address, unsigned char *data, unsigned int dataSize) {
+	do {
+		startTransaction(TLM_WRITE_COMMAND, address, data, dataSize);
+	} while (payload.get_response_status() == TLM_INCOMPLETE_RESPONSE);
+
+	if (payload.get_response_status() != TLM_OK_RESPONSE) {
+		REPORT_ERROR(filename, __FUNCTION__, "command refused by the target.");
+	}
+}
+
+void Cpu::waitForInterrupt(sc_in<bool>& line) {
+	// the line is only up to date at the simulation time
+	if (loosely_timed && !line.read()) {
+		m_qk.sync();
+	}
+	if (!line.read()) {
+		wait(line.posedge_event());
+	}
+}
+
+void Cpu::cpuWait(unsigned int cycles) {
+	if (loosely_timed) {
+		m_qk.inc(cycles * CLK_CYCLE_CPU);
+		if (m_qk.need_sync()) {
+			m_qk.sync();
+		}
+	} else {
+		wait(cycles * CLK_CYCLE_CPU);
+	}
+}
+
+
+//**********************************************************************
+// transactions
+//**********************************************************************
+void Cpu::startTransaction(tlm_command command, soc_address_t address,
+		unsigned char *data, unsigned int dataSize) {
+	payload.set_command(command);
+	payload.set_address(address);
+	payload.set_data_ptr(data);
+	payload.set_data_length(dataSize);
+	payload.set_streaming_width(dataSize);
+	payload.set_byte_enable_ptr(0);
+	payload.set_dmi_allowed(false);
+	payload.set_response_status(TLM_INCOMPLETE_RESPONSE);
+
+	if (loosely_timed) {
+		// blocking transport, the processor runs ahead by the annotated delay
+		sc_time delay = m_qk.get_local_time();
+		if (!(use_dmi && m_dmi.transport(initiator_socket, payload, delay))) {
+			initiator_socket->b_transport(payload, delay);
+		}
+		m_qk.set(delay);
+		if (m_qk.need_sync()) {
+			m_qk.sync();
+		}
+		return;
+	}
+
+	sc_time delay_time = SC_ZERO_TIME;
+	if (use_dmi && m_dmi.transport(initiator_socket, payload, delay_time)) {
+		wait(delay_time);
+		return;
+	}
+
+	tlm_phase phase = BEGIN_REQ;
+	tlm_sync_enum transResult = initiator_socket->nb_transport_fw(payload, phase, delay_time);
+	if (transResult == TLM_COMPLETED) {
+		wait(delay_time);
+	} else {
+		// the response comes on the backward path
+		wait(transactionFinished_event);
+	}
+}
+
+
+//**********************************************************************
+// nb_transport_bw: implementation of the backward path callback
+//**********************************************************************
+tlm_sync_enum Cpu::nb_transport_bw(tlm_generic_payload&, tlm_phase& phase,
+		sc_time& delay_time) {
+	if (phase != BEGIN_RESP) {
+		REPORT_FATAL(filename, __FUNCTION__, "Cpu received a phase other than BEGIN_RESP on the bw path");
+		exit(1);
+	}
+	transactionFinished_event.notify(delay_time);
+	phase = END_RESP;
+	return TLM_COMPLETED;
+}
+
+unsigned int Cpu::instances = 0;
@@ -0,0 +1,360 @@
+/**
+ * @file	Cpu.h
+ * Processor of the SoC
+ *
+ * @date	Apr 14, 2011
+ * @author	Miklos Kirilly
+ */
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include <tlm.h>
+#include <string>
+#include <vector>
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+
+#include "globaldefs.h"
+#include "IpPacket.h"
+#include "packet_descriptor.h"
+#include "DmiCache.h"
+#include "Accelerator.h"
+#include "RoutingTable.h"
+
+using namespace tlm;
+using namespace tlm_utils;
+using namespace sc_core;
+
+
+SC_MODULE(Cpu) {
+
+	// *******===============================================================******* //
+	// *******                         sockets, ports                        ******* //
+	// *******===============================================================******* //
+public:
+	/// bus master socket
+	simple_initiator_socket<Cpu> initiator_socket;
+
+	/// Interrupt line that is used by the DMA when it
+	/// finishes the transfer of a received packet into the RAM.
+	/// It is the line of the receive queue rx_queue_of_cpu(m_id), read the
+	/// descriptors at rx_queue_address() of that queue.
+	/// With napi_budget > 0 the processor polls instead: it disables the interrupt at
+	/// rx_queue_irq_address() of its queue, reads up to napi_budget descriptors, and
+	/// enables the interrupt again when the queue is empty. The line stays high while
+	/// packets are waiting, so a packet that comes after the last read is not lost.
+	sc_in<bool> packetReceived_interrupt;
+
+	/////////////////////////////////////////
+        // additional declarations for exercise 8
+	/////////////////////////////////////////
+	/// Interrupt line used by the accelerator to signal when lookup is ready.
+	/// The result is read from accelerator_result_address(m_id), that clears it.
+	sc_in<bool> lookupReady_interrupt;
+
+	/// With acc_result_push the accelerator writes the lookup result into this mailbox
+	/// instead of raising lookupReady_interrupt. lookupResult_mailbox.read() waits for it
+	/// locally, without a bus transaction.
+	sc_fifo_in<unsigned int> lookupResult_mailbox;
+
+
+	// *******===============================================================******* //
+	// *******                  member objects, variables                    ******* //
+	// *******===============================================================******* //
+
+private:
+	/// Unique processor ID.
+	/// Assigned at construction time. It is used to access an Accelerator.
+	/// This member is used in Accelerator::LookupRequest::processorId.
+	const unsigned int m_id;
+
+	/// packet descriptor sent to or read from the IO module
+	/// With cpu_descriptor_batch > 1 the descriptors are read and written in batches of
+	/// descriptor_batch_size(cpu_descriptor_batch) bytes instead.
+	/// With descriptor_rings the processor claims receive ring entries instead: it reads a
+	/// ring_claim from rx_queue_address() and then the claimed entries from the RAM. It
+	/// writes its transfer commands to its transmit ring of the channel (tx_ring_address())
+	/// and writes tx_doorbell_address() every ring_doorbell_batch descriptors.
+	packet_descriptor m_packet_descriptor;
+
+	/// transaction payload used by the CPU for making transaction, only one instance
+	/// as only one transaction at a time
+	tlm_generic_payload payload;
+
+	/// event to signal when the return path returns the read data
+	sc_event transactionFinished_event;
+
+	/// DMI regions of the RAM. With use_dmi, startTransaction() first tries
+	/// m_dmi.transport(initiator_socket, payload, delay), and only sends the
+	/// transaction on the bus if it returns false.
+	DmiCache m_dmi;
+
+	/// Local time of the processor in loosely_timed mode. startTransaction() then calls
+	/// initiator_socket->b_transport(payload, delay) with delay = m_qk.get_local_time(),
+	/// sets the local time to the returned delay, and calls m_qk.sync() if
+	/// m_qk.need_sync() or before waiting for an interrupt.
+	tlm_utils::tlm_quantumkeeper m_qk;
+
+
+	/////////////////////////////////////////
+        // additional declarations for exercise 6
+	/////////////////////////////////////////
+
+	/// header of the IP packet that the processor works on (wrapper).
+	/// Read the header_size() bytes at m_packet_descriptor.header_address() into it.
+	IpPacket m_packet_header;
+
+	/// Routing table, shared by all Cpu instances.
+	/// Not used if the system contains accelerator(s)
+	RoutingTableRef m_rt;
+
+
+	/////////////////////////////////////////
+        // additional declarations for exercise 7
+	/////////////////////////////////////////
+public:    // we need access from sc_main
+	// load estimation	// variables for load evaluation
+	/// Time spent with computation.
+	/// Only modify its value using the MEASURE_PROCESSING_TIME macro.
+	sc_time total_processing_time;
+
+	/// Time spent waiting for transaction completion.
+	/// Only modify its value using the MEASURE_TRANSFER_TIME macro.
+	sc_time total_transfer_time;
+
+      // start of a measured time period
+        sc_time period_start_time; 
+
+	/////////////////////////////////////////
+        // additional declarations for exercise 8
+	/////////////////////////////////////////
+	LookupRequest m_lookup_request;
+
+
+	// *******===============================================================******* //
+	// *******                   member functions, processes                 ******* //
+	// *******===============================================================******* //
+private:
+	/**
+	 * Implementation for the initiator socket backward interface. This is the
+	 * only function that is overridden for the simple_initiator_socket.
+	 *
+	 * It is called by the interconnect when the target responds in the second
+	 * phase of the transaction.
+	 */
+	tlm_sync_enum nb_transport_bw( // nb_transport
+			tlm_generic_payload& transaction, // transaction
+			tlm_phase& phase, // transaction phase
+			sc_time& time); // elapsed time
+
+	/// a DMI region was revoked by the target
+	void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+		m_dmi.invalidate(start_range, end_range);
+	}
+
+	/**
+	 * Main thread, this does all the processing.
+	 */
+	void processor_thread(void);
+
+	/**
+	 * Start a 2-phase transaction with the given arguments.
+	 *
+	 * @param command - TLM_READ_COMMAND or TLM_WRITE_COMMAND
+	 * @param address - the address of the destination/source of the data
+	 * @param data    - pointer to the data that is written or pointer to a
+	 *                  buffer where the data is going to be stored
+	 * @param dataSize - size of the data in bytes
+	 *
+	 * With use_dmi the RAM is accessed through m_dmi, then the function only
+	 * waits the annotated delay. In loosely_timed mode the transaction is blocking,
+	 * see m_qk.
+	 */
+	void startTransaction(tlm_command command, soc_address_t address,
+		unsigned char *data, unsigned int dataSize);
+
+	
+	///////////////////////////////////////////////////////////////////////////////////
+        // additional declarations for exercise 6
+	// functions for packet processing implementations in $HOME/npu_common/Cpu_proc.cpp
+	///////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Calculates checksum of the IP v4 packet header.
+	 * @param header - Pointer to an IP packet, the checksum is calculated for
+	 * 					the packets' header.
+	 * @return the 16-bit checksum
+	 */
+	unsigned short int calculateChecksum(const IpPacket& header) const;
+
+	/**
+	 * Verifies the integrity of an IP v4 packet.
+	 * -	First, the header length is checked (the standard
+	 * 		requires each header to be at least 20 bytes long).
+	 * -	Second, the Time To Live value is checked. Packets with
+	 * 		TTL = 0 are considered corrupted.
+	 * -	Third, header the checksum is controlled.
+	 * @param header - Pointer to an IP packet, which is checked.
+	 * @retval true - if the header is valid
+	 * @retval false - if the header is corrupted
+	 */
+	bool verifyHeaderIntegrity(const IpPacket& header) const;
+
+	/**
+	 * perfom the next-hop lookup for the destination IP address the IP v4 packet header.
+	 * @param header - Reference to an IP packet, the destination IP address is taken
+	 * 					from the packets' header.
+	 * @return port ID (range 0 to 3)
+	 */
+	unsigned int makeNHLookup( const IpPacket& header) ;
+
+	/**
+	 * Decrements the Time To Live value in the header.
+	 * @param header - Pointer to an IP packet.
+	 */
+	void decrementTTL(IpPacket& header);
+
+	/**
+	 * Updates the checksum of the IP packet after processing.
+	 * @note	The laboratory example only decrements the TTL value,
+	 * 			if other parts are changed (e.g. due to NAT), then
+	 * 			this function should be changed, so that the
+	 * 			checksum is properly recomputed. ::calculateChecksum
+	 * 			could be used for this purpose.
+	 * @pre	::decrementTTL was called exactly once on this packet.
+	 * @param header - Pointer to an IP packet.
+	 */
+	void updateChecksum(IpPacket& header);
+
+	///////////////////////////////////////////////////////////////////////////////////
+        // end additional declarations for exercise 6
+	///////////////////////////////////////////////////////////////////////////////////
+
+	/////////////////////////////////////////
+	// steps of the processor_thread
+	/////////////////////////////////////////
+
+	/// local processing time of the given CPU cycles, see m_qk in loosely_timed mode
+	void cpuWait(unsigned int cycles);
+
+	/// waits until the interrupt line is high, syncs the local time first in loosely_timed mode
+	void waitForInterrupt(sc_in<bool>& line);
+
+	/// writes a command to a target that refuses it while it is full
+	/// (TLM_INCOMPLETE_RESPONSE), and sends it again until it is accepted
+	void postCommand(soc_address_t address, unsigned char *data, unsigned int dataSize);
+
+	/**
+	 * Reads up to max descriptors from a receive queue into m_received: a single
+	 * descriptor, a batch, or a ring claim and the claimed ring entries.
+	 * @return the number of descriptors read, 0 if the queue was empty
+	 */
+	unsigned int readDescriptors(unsigned int queue, unsigned int max);
+
+	/**
+	 * Processes the packet of m_packet_descriptor: reads its header, verifies it, looks up
+	 * the next hop, and writes the modified header back.
+	 * @return the output port, or nMacs if the packet is dropped
+	 */
+	unsigned int processPacket();
+
+	/**
+	 * Reads up to max descriptors from a receive queue, processes their packets, and
+	 * passes the packets on to the DMA channels or to the discard queue.
+	 * @return the number of packets processed
+	 */
+	unsigned int handleDescriptors(unsigned int queue, unsigned int max);
+
+	/// posts transfer or drop commands, in batches of up to cpu_descriptor_batch
+	void postDescriptors(soc_address_t address, std::vector<packet_descriptor>& descriptors);
+
+	/// writes transfer commands to the transmit ring to a port, see descriptor_rings
+	void writeTxRing(unsigned int port, std::vector<packet_descriptor>& descriptors);
+
+	/// rings the doorbell of each transmit ring with at least min_pending new descriptors
+	void ringDoorbells(unsigned int min_pending);
+
+	/// enables or disables the interrupt of a receive queue, see napi_budget
+	void setInterruptEnable(unsigned int queue, bool enable);
+
+	/// the descriptors of the last receive queue read, cpu_descriptor_batch of them
+	std::vector<packet_descriptor> m_received;
+
+	/// the handled packets of a read, per output port, the dropped ones at index nMacs
+	std::vector<std::vector<packet_descriptor> > m_outgoing;
+
+	/// data of a batch of descriptors, see descriptor_batch_size()
+	std::vector<unsigned char> m_batch_data;
+
+	/// with descriptor_rings, the free running index of the next entry of the transmit
+	/// ring to each port, and the index written to its doorbell last
+	std::vector<unsigned int> m_tx_index;
+	std::vector<unsigned int> m_tx_doorbell;
+
+
+
+public:
+	/**
+	 * print the load of the module
+	 */
+	void output_load() const;
+
+	// *******===============================================================******* //
+	// *******                             constructor                       ******* //
+	// *******===============================================================******* //
+public:
+
+	SC_CTOR(Cpu):
+		initiator_socket("initiator_socket"), 
+		m_id(Cpu::instances++), 
+		m_rt(RoutingTableRef::shared(lutConfigFile, '|'))
+	{
+		SC_THREAD(processor_thread);
+		initiator_socket.register_nb_transport_bw(this, &Cpu::nb_transport_bw);
+		initiator_socket.register_invalidate_direct_mem_ptr(this,
+				&Cpu::invalidate_direct_mem_ptr);
+		m_qk.reset();
+
+		total_processing_time = SC_ZERO_TIME;
+		total_transfer_time = SC_ZERO_TIME;
+
+	}
+
+private:
+
+	/// number of instantiated Cpu objects, used to automatically set the m_id field
+	static unsigned int instances;
+};
+
+
+
+/////////////////////////////////////////
+// additional declarations for exercise 7
+/////////////////////////////////////////
+
+/// Wrapper macro to record the time used for the transfer.
+/// usage: Put the transaction code inside the parentheses, and
+///        the total_transfer_time member variable will be increased
+///        according to the consumed time.
+/// prerequisite: declared members sc_time period_start_time and
+///               sc_time total_transfer_time
+/// @see MEASURE_PROCESSING_TIME
+#define MEASURE_TRANSFER_TIME(code)                                 \
+		period_start_time = sc_time_stamp();                        \
+		code                                                        \
+		total_transfer_time += sc_time_stamp() - period_start_time;
+
+/// Wrapper macro to record the time used for processing.
+/// usage: Put the processing code inside the parentheses, and
+///        the total_processing_time member variable will be increased
+///        according to the consumed time.
+/// prerequisite: declared members sc_time period_start_time and
+///               sc_time total_processing_time
+/// @see MEASURE_TRANSFER_TIME
+#define MEASURE_PROCESSING_TIME(code)                               \
+		period_start_time = sc_time_stamp();                        \
+		code                                                        \
+		total_processing_time += sc_time_stamp() - period_start_time;
+
+#endif /* __CPU_H__ */
@@ -0,0 +1,486 @@
+/**
+ * @file	main.cpp
+ *
+ * @date	Apr 12, 2011
+ * @author	Miklos Kirilly
+ */
+
+#include <tlm.h>
+#include <string>
+#include <sys/time.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include "reporting.h"
+
+#include "globaldefs.h"
+#include "RAM.h"
+#include "IoModule.h"
+#include "Checkpoint.h"
+#include "SimpleBusAT.h"
+#include "CrossbarAT.h"
+#include "Cpu.h"
+#include "Accelerator.h"
+
+using namespace sc_core;
+
+//  command line parsing
+#include "argvparser.h"
+using namespace CommandLineProcessing;
+
+int sc_main(int argc, char *argv[]);
+
+/**
+ * Simulation main function
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return error code
+ * @retval 0 if finishes without error
+ */
+
+int sc_main(int argc, char *argv[]) {
+
+
+///////////////////////////////////// Parsing the command line.... /////////////
+// you can ignore this section, it is used to read in the required parameters //
+// from the command line                                                      //
+////////////////////////////////////////////////////////////////////////////////
+ArgvParser cmd;
+
+// init
+cmd.setIntroductoryDescription("You can set the simulation parameters on the command line with the following switches.");
+
+//define error codes
+cmd.addErrorCode(0, "Success");
+cmd.addErrorCode(1, "Error");
+
+cmd.setHelpOption("h", "help", "Print this help");
+
+cmd.defineOption("verbose", "Output log infomration", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("verbose","v");
+
+cmd.defineOption("n_proc", "# of processor in system. Default value: 1", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("n_proc","n");
+
+cmd.defineOption("c", "CPU clock period [ns]. Default value: 10", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("c","cpu");
+
+cmd.defineOption("b", "Bus and memory clock period [ns]. Default value: 20", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("b","bus");
+
+cmd.defineOption("a", "Accelerator clock period [ns]. If option is omitted accel will not be instanitated", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("a","accel");
+
+cmd.defineOption("acc_stages", "# of pipeline stages of the accelerator lookup engine. Default value: 1", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("acc_in_flight", "Max. # of lookups in the accelerator pipeline at the same time. Default value: 1", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("acc_push", "The accelerator pushes the lookup results into mailboxes of the CPUs instead of raising an interrupt for a bus read", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("acc_requests", "Depth of the accelerator request FIFO. Default value: 9", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("packets", "# of packets to be simulated. Default value: 100", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("packets","p");
+
+cmd.defineOption("ports", "# of Ethernet ports (MACs). Default value: 4", ArgvParser::OptionRequiresValue);
+cmd.defineOptionAlternative("ports","m");
+
+cmd.defineOption("pcap", "Comma separated list of PCAP files replayed by the ports, repeated if shorter. Default: the sample files", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("pcap_index", "Cache the packet index of the PCAP files in <file>.idx sidecar files", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("rx_queues", "# of receive queues, the packets are distributed by flow hash, CPU i serves queue i % rx_queues. Default value: 1", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("batch", "# of packet descriptors the CPUs read or write in one bus transaction. Default value: 1", ArgvParser::OptionRequiresValue);
+cmd.defineOption("irq_packets", "# of waiting packets that raise the interrupt of a receive queue. Default value: 1", ArgvParser::OptionRequiresValue);
+cmd.defineOption("irq_time", "max. time in ns a packet waits for its interrupt. Default value: 0 (no waiting), 10000 if irq_packets is given", ArgvParser::OptionRequiresValue);
+cmd.defineOption("napi", "# of packets a CPU handles per poll with its interrupt disabled, 0: interrupt per packet. Default value: 0", ArgvParser::OptionRequiresValue);
+cmd.defineOption("rings", "Descriptor rings in the RAM instead of the descriptor FIFOs of the IO module", ArgvParser::NoOptionAttribute);
+cmd.defineOption("writeback", "# of received descriptors a DMA channel writes back to a ring in one transaction. Default value: 1", ArgvParser::OptionRequiresValue);
+cmd.defineOption("doorbell", "# of descriptors a CPU writes to a transmit ring per doorbell. Default value: 1", ArgvParser::OptionRequiresValue);
+cmd.defineOption("buffers", "Divide the packet memory into size classes of buffers: comma separated <bytes>:<percent of the memory> pairs, the largest holding 2000 bytes, e.g. 128:20,640:30,2000:50. Default: 128 slots of 2000 bytes", ArgvParser::OptionRequiresValue);
+cmd.defineOption("slots", "Size of the packet memory in slots of 2000 bytes. Default value: 128", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("dma_depth", "# of outstanding bus transactions per DMA channel. Default value: 1", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("dmi", "Loosely-timed RAM access: the DMA channels (and CPUs) copy through DMI with annotated latencies instead of bus transactions", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("lt", "Loosely-timed simulation: blocking transactions with temporal decoupling instead of the 2-phase AT protocol", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("quantum", "Global quantum of the loosely-timed mode [ns]. Default value: 1000", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("save", "Save the state of the system to <file> at the end of the run", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("restore", "Continue from the state saved to <file> with the same ports, memory and PCAP files, --packets counts both runs", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("header_split", "DMA stores the packet headers in separate header buffers, the CPUs only fetch those", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("crossbar", "Connect the masters and slaves with a crossbar instead of the shared bus", ArgvParser::NoOptionAttribute);
+
+cmd.defineOption("arbitration", "Bus arbitration: rr (round robin), fixed (fixed priority) or weighted (weighted round robin). Default value: rr", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("burst", "Max. # of bus cycles of a transfer, longer ones are split. Default value: 0 (no limit)", ArgvParser::OptionRequiresValue);
+
+cmd.defineOption("weights", "Comma separated weights (priorities with fixed) of the bus masters: DMA channels, then CPUs. Default: 1, with fixed the CPUs 2", ArgvParser::OptionRequiresValue);
+
+
+
+// finally parse and handle return codes (display help etc...)
+int result = cmd.parse(argc, argv);
+
+if (result != ArgvParser::NoParserError){
+   cout << cmd.parseErrorDescription(result)<<endl;
+   cout << "Use "<< argv[0] << " --help    to get on the command line parameters"<<endl;
+   exit(1);
+}
+
+if(cmd.foundOption("verbose")){
+	//unsigned short int do_logging = 0x17;
+	//do_logging = 0x10;
+	do_logging = (unsigned int) strtol(cmd.optionValue("verbose").c_str(), NULL, 16);
+}
+else
+	//unsigned short int do_logging = 0;
+	do_logging = 0;
+
+if(cmd.foundOption("n_proc"))
+	n_cpus = atoi(cmd.optionValue("n_proc").c_str());
+else
+	n_cpus = 1;
+
+if(cmd.foundOption("ports"))
+	init_address_map(atoi(cmd.optionValue("ports").c_str()));
+else
+	init_address_map(4);
+
+if(cmd.foundOption("pcap")){
+	std::string files = cmd.optionValue("pcap");
+	std::string::size_type begin = 0, end;
+	do {
+		end = files.find(',', begin);
+		pcap_files.push_back(files.substr(begin, end == std::string::npos ? end : end - begin));
+		begin = end + 1;
+	} while (end != std::string::npos);
+}
+
+unsigned int nMasters = n_cpus + nMacs;
+
+if(cmd.foundOption("p"))
+	MAX_PACKETS = atoi(cmd.optionValue("p").c_str());
+else
+	MAX_PACKETS = 100;
+
+cache_pcap_index = cmd.foundOption("pcap_index");
+
+dma_header_split = cmd.foundOption("header_split");
+
+use_dmi = cmd.foundOption("dmi");
+
+loosely_timed = cmd.foundOption("lt");
+if(cmd.foundOption("quantum"))
+	lt_quantum = sc_time(atoi(cmd.optionValue("quantum").c_str()), SC_NS);
+// the quantum keepers of the modules start with it
+tlm_utils::tlm_quantumkeeper::set_global_quantum(lt_quantum);
+
+bool use_crossbar = cmd.foundOption("crossbar");
+
+if(cmd.foundOption("arbitration")){
+	std::string policy = cmd.optionValue("arbitration");
+	if(policy == "fixed")
+		bus_arbitration = ARBITRATION_FIXED_PRIORITY;
+	else if(policy == "weighted")
+		bus_arbitration = ARBITRATION_WEIGHTED;
+	else if(policy == "rr")
+		bus_arbitration = ARBITRATION_ROUND_ROBIN;
+	else {
+		cout << "Unknown arbitration policy: " << policy << endl;
+		exit(1);
+	}
+}
+
+if(cmd.foundOption("burst"))
+	bus_max_burst = atoi(cmd.optionValue("burst").c_str());
+
+if(cmd.foundOption("weights")){
+	std::string weights = cmd.optionValue("weights");
+	std::string::size_type begin = 0, end;
+	do {
+		end = weights.find(',', begin);
+		bus_weights.push_back(atoi(weights.substr(begin, end == std::string::npos ? end : end - begin).c_str()));
+		begin = end + 1;
+	} while (end != std::string::npos);
+}
+else if(bus_arbitration == ARBITRATION_FIXED_PRIORITY){
+	// CPUs first, so that their descriptor reads preempt the DMA bursts
+	bus_weights.assign(nMacs, 1);
+	bus_weights.resize(nMasters, 2);
+}
+
+// a queue without a CPU would never be served
+if(cmd.foundOption("rx_queues"))
+	n_rx_queues = atoi(cmd.optionValue("rx_queues").c_str());
+if(n_rx_queues == 0)
+	n_rx_queues = 1;
+if(n_rx_queues > n_cpus)
+	n_rx_queues = n_cpus;
+
+if(cmd.foundOption("batch"))
+	cpu_descriptor_batch = atoi(cmd.optionValue("batch").c_str());
+if(cpu_descriptor_batch == 0)
+	cpu_descriptor_batch = 1;
+
+if(cmd.foundOption("irq_packets")){
+	rx_irq_packets = atoi(cmd.optionValue("irq_packets").c_str());
+	rx_irq_time = sc_time(10000, SC_NS);
+}
+if(rx_irq_packets == 0)
+	rx_irq_packets = 1;
+if(cmd.foundOption("irq_time"))
+	rx_irq_time = sc_time(atoi(cmd.optionValue("irq_time").c_str()), SC_NS);
+if(cmd.foundOption("napi"))
+	napi_budget = atoi(cmd.optionValue("napi").c_str());
+
+descriptor_rings = cmd.foundOption("rings");
+if(cmd.foundOption("writeback"))
+	ring_writeback_batch = atoi(cmd.optionValue("writeback").c_str());
+if(ring_writeback_batch == 0)
+	ring_writeback_batch = 1;
+if(cmd.foundOption("doorbell"))
+	ring_doorbell_batch = atoi(cmd.optionValue("doorbell").c_str());
+if(ring_doorbell_batch == 0)
+	ring_doorbell_batch = 1;
+
+if(cmd.foundOption("slots"))
+	n_memory_slots = atoi(cmd.optionValue("slots").c_str());
+if(n_memory_slots == 0)
+	n_memory_slots = 1;
+
+if(cmd.foundOption("buffers") && !init_buffer_classes(cmd.optionValue("buffers"))){
+	cout << "Invalid buffer classes: " << cmd.optionValue("buffers") << endl;
+	exit(1);
+}
+
+if(cmd.foundOption("dma_depth"))
+	dma_outstanding_transactions = atoi(cmd.optionValue("dma_depth").c_str());
+if(dma_outstanding_transactions == 0)
+	dma_outstanding_transactions = 1;
+
+if(cmd.foundOption("cpu"))
+	CLK_CYCLE_CPU = sc_time(atoi(cmd.optionValue("c").c_str()), SC_NS);
+else
+	CLK_CYCLE_CPU = sc_time(10, SC_NS);
+
+if(cmd.foundOption("bus"))
+	CLK_CYCLE_BUS = sc_time(atoi(cmd.optionValue("b").c_str()), SC_NS);
+else
+	CLK_CYCLE_BUS = sc_time(20, SC_NS);
+
+unsigned int nSlaves ;
+
+if(cmd.foundOption("accel")){
+	use_accelerator = true;
+	nSlaves = nMacs + 1/*IO module mem. manager*/ + 1/*RAM*/ + 1/*acc*/;
+	CLK_CYCLE_ACC = sc_time(atoi(cmd.optionValue("a").c_str()), SC_NS);
+cout << "use accel = "<<use_accelerator<<", CLK_CYCLE_ACC= "<<CLK_CYCLE_ACC<<endl;
+}
+else{
+	use_accelerator = false;
+	nSlaves = nMacs + 1/*IO module mem. manager*/ + 1/*RAM*/ + 0/*acc*/;
+	CLK_CYCLE_ACC = sc_time(10, SC_NS);
+}
+
+if(cmd.foundOption("acc_stages"))
+	acc_pipeline_stages = atoi(cmd.optionValue("acc_stages").c_str());
+if(acc_pipeline_stages == 0)
+	acc_pipeline_stages = 1;
+if(cmd.foundOption("acc_in_flight"))
+	acc_lookups_in_flight = atoi(cmd.optionValue("acc_in_flight").c_str());
+if(acc_lookups_in_flight == 0)
+	acc_lookups_in_flight = 1;
+if(cmd.foundOption("acc_requests"))
+	acc_request_depth = atoi(cmd.optionValue("acc_requests").c_str());
+if(acc_request_depth == 0)
+	acc_request_depth = 1;
+acc_result_push = cmd.foundOption("acc_push");
+
+
+///////////////////////////////////// end command line parsing ////////////////
+
+
+
+	/*********************************************************************/
+	/*                           modules                                 */
+	/*********************************************************************/
+
+	// system interconnect, a shared bus or a crossbar with the same sockets
+	SimpleBusAT* bus = 0;
+	CrossbarAT* crossbar = 0;
+	std::vector<tlm_target_socket<> *> master_socket;
+	std::vector<tlm_initiator_socket<> *> slave_socket;
+	if (use_crossbar) {
+		crossbar = new CrossbarAT("crossbar", nMasters, nSlaves, bus_width);
+		for (unsigned int i = 0; i < nMasters; i++)
+			master_socket.push_back(&crossbar->target_socket[i]);
+		for (unsigned int i = 0; i < nSlaves; i++)
+			slave_socket.push_back(&crossbar->initiator_socket[i]);
+	} else {
+		bus = new SimpleBusAT("bus", nMasters, nSlaves, bus_width);
+		for (unsigned int i = 0; i < nMasters; i++)
+			master_socket.push_back(&bus->target_socket[i]);
+		for (unsigned int i = 0; i < nSlaves; i++)
+			slave_socket.push_back(&bus->initiator_socket[i]);
+	}
+
+	// system memory (RAM)
+	RAM target("memory", ram_size(), 4);
+
+	// Ethernet MAC + DMA
+	IoModule mac_io_module("io_module");
+
+	// an array of Cpu pointers
+	Cpu* cpus[n_cpus];
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		cpus[i] = new Cpu(cpu_names[i]);
+	}
+
+
+	Accelerator *accelerator;
+	if(use_accelerator) {
+		// Accelerator module with IP Lookup time as parameter
+		accelerator = new Accelerator("accelerator", 10);
+	}
+
+
+
+	/**********************************************************************/
+	/*                           wiring                                   */
+	/**********************************************************************/
+
+	// interrupt lines
+	sc_signal<bool> dma_irq[n_rx_queues]; // one per receive queue
+	sc_signal<bool> acc_irq[n_cpus];
+
+	// accelerator result mailboxes, one result each
+	sc_fifo<unsigned int>* acc_mailbox[n_cpus];
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		acc_mailbox[i] = new sc_fifo<unsigned int>(1);
+	}
+
+	// --------------- BUS MASTERS -------------------
+	// DMA engine to bus
+	for (unsigned int i = 0; i < nMacs; i++) {
+		mac_io_module.dma_ch[i]->initiator_socket(*master_socket[i]);
+	}
+
+	// processors to bus and interrupt
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		// connect master socket to the bus
+		cpus[i]->initiator_socket(*master_socket[i + nMacs]);
+		// connect IRQ lines
+		cpus[i]->packetReceived_interrupt(dma_irq[rx_queue_of_cpu(i)]);
+		cpus[i]->lookupReady_interrupt(acc_irq[i]);
+		cpus[i]->lookupResult_mailbox(*acc_mailbox[i]);
+	}
+
+	// --------------- BUS SLAVES --------------------
+	// RAM to bus
+	(*slave_socket[0])(target.m_memory_socket);
+	// DMA to bus
+	(*slave_socket[1])(mac_io_module.memory_manager.target_socket);
+	for (unsigned int i = 0; i < nMacs; i++) {
+		(*slave_socket[2 + i])(mac_io_module.dma_ch[i]->target_socket);
+	}
+
+	// Accelerator to bus
+	if(use_accelerator)
+		(*slave_socket[2 + nMacs])(accelerator->target_socket);
+
+	// DMA to interrupt line
+	for (unsigned int i = 0; i < n_rx_queues; i++) {
+		mac_io_module.dma_irq[i](dma_irq[i]);
+	}
+
+	// accelerator to interrupt lines
+	if(use_accelerator)
+		for (unsigned int i = 0; i < n_cpus; i++) {
+			accelerator->irq[i](acc_irq[i]);
+			accelerator->mailbox[i](*acc_mailbox[i]);
+		}
+
+	initialize_statistics();
+	if (cmd.foundOption("restore")
+			&& !restore_checkpoint(cmd.optionValue("restore").c_str(), target, mac_io_module))
+		exit(1);
+	/**********************************************************************/
+	/*                       start simulation                             */
+	/**********************************************************************/
+	timeval host_start, host_end;
+	gettimeofday(&host_start, NULL);
+	sc_start(); // run as long as needed for the specified number of packets
+	gettimeofday(&host_end, NULL);
+	double host_time = (host_end.tv_sec - host_start.tv_sec) + (host_end.tv_usec
+			- host_start.tv_usec) * 1e-6;
+
+	/**********************************************************************/
+	/*                       print statistics                             */
+	/**********************************************************************/
+	cout << "===================================================================="
+	     << "\n\tload statistics\n"
+	     << "===================================================================="
+	     << endl;
+	sc_time ref_time = sc_time_stamp();
+	double mean_proc = 0.0;
+	double mean_trans = 0.0;
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		cpus[i]->output_load();
+		mean_proc += (cpus[i]->total_processing_time)/ref_time *100.0;
+		mean_trans += (cpus[i]->total_transfer_time)/ref_time *100.0;
+	}
+	cout << "mean CPU processing load: "<< mean_proc/n_cpus << " %"<<endl;
+	cout << "mean CPU transfer load: "<< mean_trans/n_cpus << " %"<<endl;
+	if(use_accelerator)
+		accelerator->output_load();
+	if(use_crossbar)
+		crossbar->output_load();
+	else
+		bus->output_load();
+	mac_io_module.output_descriptor_statistics();
+
+	cout << "===================================================================="
+	     << "\n\tpacket statistics\n"
+	     << "===================================================================="
+  	     << endl;
+	cout << "n_packets_received = " << n_packets_received
+	     << "\nn_packets_dropped_input_mac = " << n_packets_dropped_input_mac
+	     << "\nn_packets_sent = " << n_packets_sent << endl
+	     << "packet rate = "<< n_packets_sent /(simulation_time().to_seconds()*1e3)<<" kpps"<< endl;
+
+	cout << "latency:\n\tmin: " << min_latency << "\n\tmax: " << max_latency
+			<< "\n\tavg: " << total_latency / n_packets_sent << endl;
+
+	cout << "simulation mode: ";
+	if (loosely_timed)
+		cout << "LT, quantum " << lt_quantum;
+	else
+		cout << "AT";
+	cout << (use_dmi ? ", DMI" : "") << "\nhost time: " << host_time << " s" << endl;
+
+	// drains the queues, so it is done after the statistics
+	if (cmd.foundOption("save"))
+		save_checkpoint(cmd.optionValue("save").c_str(), target, mac_io_module);
+
+	/**********************************************************************/
+	/*                            cleanup                                 */
+	/**********************************************************************/
+	// delete dynamically allocated processors
+	for (unsigned int i = 0; i < n_cpus; i++) {
+		delete cpus[i];
+		delete acc_mailbox[i];
+	}
+	if(use_accelerator)
+		delete accelerator;
+	delete bus;
+	delete crossbar;
+
+	return 0;
+}
+
+
@@ -0,0 +1,342 @@
+/**
+ * @file	main.cpp
+ *
+ * @date	Oct 17, 2026
+ * @author	Miklos Kirilly
+ *
+ * Sweep driver for the architecture exploration. SystemC runs one kernel per
+ * process, so the parameter sets are simulated by independent instances of the
+ * simulator, as many at the same time as there are host cores, and their packet,
+ * latency and load statistics are merged into one CSV file.
+ *
+ * Each line of the sweep file holds the command line options of one run, # starts
+ * a comment. Alternatives in braces, separated by |, are expanded into all their
+ * combinations, e.g. the CPU count x CPU clock x accelerator sweep of Experiment 9:
+ *
+ *     -n {1|2|3} -c {10|5|4|3|2} {|-a 10}
+ *
+ * The options after the sweep file are added to every run. The simulator is started
+ * in the current directory, which must be a sibling of PCAP_samples and config. It is
+ * ../ex_8_9/processing_acc.x by default, -x ../solution/processing_acc.x runs the
+ * reference processor, which the sweep files were measured with.
+ *
+ * usage: sweep.x [-j jobs] [-o results.csv] [-x simulator] sweep_file [options of every run]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+
+using namespace std;
+
+/// wall clock time in seconds
+static double now() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/// a statistic printed by the simulator, the value follows the prefix at the start of a line
+struct Statistic {
+	/// CSV column
+	const char* column;
+	const char* prefix;
+	/// an sc_time with its unit, converted to ns
+	bool time;
+};
+
+static const Statistic statistics[] = {
+		{ "packets_received", "n_packets_received = ", false },
+		{ "packets_dropped_input_mac", "n_packets_dropped_input_mac = ", false },
+		{ "packets_sent", "n_packets_sent = ", false },
+		{ "packet_rate_kpps", "packet rate = ", false },
+		{ "min_latency_ns", "\tmin: ", true },
+		{ "max_latency_ns", "\tmax: ", true },
+		{ "avg_latency_ns", "\tavg: ", true },
+		{ "cpu_processing_load_percent", "mean CPU processing load: ", false },
+		{ "cpu_transfer_load_percent", "mean CPU transfer load: ", false },
+		{ "bus_load_percent", "bus load: transferring ", false },
+		{ "max_packets_buffered", "io_module.memory_manager max. packets buffered: ", false },
+		{ "host_time_s", "host time: ", false } };
+
+static const unsigned int N_STATISTICS = sizeof(statistics) / sizeof(statistics[0]);
+
+/// a simulation run
+struct Run {
+	/// the command line options
+	string options;
+	/// the process, 0 if not started
+	pid_t pid;
+	/// the output of the simulator is collected here
+	string output_file;
+	/// exit status of the simulator
+	int status;
+	double start_time;
+	double wall_time;
+	/// the statistics in the order of the statistics table
+	string value[N_STATISTICS];
+};
+
+/**
+ * Expands the alternatives in braces into all combinations.
+ * @param line - the options of a line of the sweep file, without comment
+ * @param options - the expanded option strings are appended to it
+ */
+static void expand(const string& line, vector<string>& options) {
+	string::size_type open = line.find('{');
+	if (open == string::npos) {
+		options.push_back(line);
+		return;
+	}
+	string::size_type close = line.find('}', open);
+	if (close == string::npos) {
+		cerr << "missing } in: " << line << endl;
+		exit(1);
+	}
+	string alternatives = line.substr(open + 1, close - open - 1);
+	string::size_type begin = 0, end;
+	do {
+		end = alternatives.find('|', begin);
+		string alternative = alternatives.substr(begin, end == string::npos ? end : end - begin);
+		expand(line.substr(0, open) + alternative + line.substr(close + 1), options);
+		begin = end + 1;
+	} while (end != string::npos);
+}
+
+/// starts the simulator with the options of the run, its output goes to a temporary file
+static void start(Run& run, const string& simulator) {
+	char file[] = "/tmp/sweep.XXXXXX";
+	int fd = mkstemp(file);
+	if (fd < 0) {
+		perror("mkstemp");
+		exit(1);
+	}
+	run.output_file = file;
+
+	// the arguments are separated by white space
+	vector<string> args;
+	args.push_back(simulator);
+	istringstream words(run.options);
+	string word;
+	while (words >> word) {
+		args.push_back(word);
+	}
+
+	run.start_time = now();
+	run.pid = fork();
+	if (run.pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (run.pid == 0) {
+		vector<char*> argv;
+		for (unsigned int i = 0; i < args.size(); i++) {
+			argv.push_back(const_cast<char*> (args[i].c_str()));
+		}
+		argv.push_back(0);
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+		execv(simulator.c_str(), &argv[0]);
+		perror(simulator.c_str());
+		_exit(127);
+	}
+	close(fd);
+}
+
+/// nanoseconds of an sc_time printed with its unit
+static double nanoseconds(double value, const string& unit) {
+	if (unit == "s")
+		return value * 1e9;
+	if (unit == "ms")
+		return value * 1e6;
+	if (unit == "us")
+		return value * 1e3;
+	if (unit == "ps")
+		return value * 1e-3;
+	if (unit == "fs")
+		return value * 1e-6;
+	return value;
+}
+
+/// reads the statistics from the output of a finished run, the last one printed counts
+static void collect(Run& run) {
+	ifstream output(run.output_file.c_str());
+	string line;
+	while (getline(output, line)) {
+		for (unsigned int i = 0; i < N_STATISTICS; i++) {
+			string::size_type length = strlen(statistics[i].prefix);
+			if (line.compare(0, length, statistics[i].prefix) != 0) {
+				continue;
+			}
+			istringstream in(line.substr(length));
+			double value;
+			string unit;
+			if (!(in >> value)) {
+				continue;
+			}
+			ostringstream text;
+			text << setprecision(10);
+			if (statistics[i].time && in >> unit) {
+				text << nanoseconds(value, unit);
+			} else {
+				text << value;
+			}
+			run.value[i] = text.str();
+		}
+	}
+	output.close();
+	unlink(run.output_file.c_str());
+}
+
+/// quotes a CSV field
+static string quote(const string& field) {
+	string quoted = "\"";
+	for (unsigned int i = 0; i < field.size(); i++) {
+		quoted += field[i];
+		if (field[i] == '"')
+			quoted += '"';
+	}
+	return quoted + "\"";
+}
+
+static void write_csv(ostream& out, const vector<Run>& runs) {
+	out << "run,options,exit_status,wall_time_s";
+	for (unsigned int i = 0; i < N_STATISTICS; i++) {
+		out << "," << statistics[i].column;
+	}
+	out << ",loss_rate_percent" << endl;
+
+	for (unsigned int r = 0; r < runs.size(); r++) {
+		const Run& run = runs[r];
+		out << r << "," << quote(run.options) << "," << run.status << "," << run.wall_time;
+		for (unsigned int i = 0; i < N_STATISTICS; i++) {
+			out << "," << run.value[i];
+		}
+		// packets lost at the input MACs, in percent of the received ones
+		out << ",";
+		double received = atof(run.value[0].c_str());
+		if (!run.value[1].empty() && received > 0) {
+			out << atof(run.value[1].c_str()) / received * 100;
+		}
+		out << endl;
+	}
+}
+
+static void usage(const char* name) {
+	cerr << "usage: " << name << " [-j jobs] [-o results.csv] [-x simulator] sweep_file"
+			<< " [options of every run]" << endl;
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	const char* csv_file = 0;
+	string simulator = "../ex_8_9/processing_acc.x";
+	int opt;
+	// + : the options after the sweep file belong to the simulator
+	while ((opt = getopt(argc, argv, "+j:o:x:")) != -1) {
+		switch (opt) {
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'o':
+			csv_file = optarg;
+			break;
+		case 'x':
+			simulator = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || jobs < 1) {
+		usage(argv[0]);
+	}
+
+	string common;
+	for (int i = optind + 1; i < argc; i++) {
+		common += string(" ") + argv[i];
+	}
+
+	// one run per combination of each line
+	ifstream sweep(argv[optind]);
+	if (!sweep) {
+		cerr << "unable to open sweep file " << argv[optind] << endl;
+		return 1;
+	}
+	vector<string> options;
+	string line;
+	while (getline(sweep, line)) {
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") != string::npos) {
+			expand(line, options);
+		}
+	}
+	vector<Run> runs(options.size());
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		runs[i].options = options[i] + common;
+		runs[i].pid = 0;
+		runs[i].status = -1;
+		runs[i].wall_time = 0;
+	}
+	cerr << runs.size() << " runs, " << jobs << " at a time" << endl;
+
+	// keep jobs simulators running
+	double start_time = now();
+	unsigned int next = 0, running = 0, finished = 0;
+	while (next < runs.size() || running > 0) {
+		while (running < (unsigned long) jobs && next < runs.size()) {
+			start(runs[next++], simulator);
+			running++;
+		}
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0) {
+			perror("wait");
+			return 1;
+		}
+		for (unsigned int i = 0; i < next; i++) {
+			Run& run = runs[i];
+			if (run.pid != pid) {
+				continue;
+			}
+			run.wall_time = now() - run.start_time;
+			run.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+			run.pid = 0;
+			collect(run);
+			running--;
+			finished++;
+			cerr << "[" << finished << "/" << runs.size() << "] " << run.options << ": "
+					<< (run.status == 0 ? "" : "failed, ") << run.wall_time << " s" << endl;
+		}
+	}
+	cerr << runs.size() << " runs in " << now() - start_time << " s" << endl;
+
+	if (csv_file != 0) {
+		ofstream csv(csv_file);
+		if (!csv) {
+			cerr << "unable to write " << csv_file << endl;
+			return 1;
+		}
+		write_csv(csv, runs);
+	} else {
+		write_csv(cout, runs);
+	}
+
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		if (runs[i].status != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}